@@ -0,0 +1,96 @@
+/*
+	Stencil Probe active tiles
+	The changed-tile map and skip statistics.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "active.h"
+#include "scratch.h"
+
+static int override = -1;
+static long total_computed, total_skipped;
+
+int active_enabled() {
+  const char *s = getenv("STENCILPROBE_ACTIVE");
+
+  if (override >= 0)
+    return override;
+  return s != NULL && atoi(s) != 0;
+}
+
+void ActiveSet(int on) {
+  override = on;
+}
+
+/* whether A and B differ on any ghost point a 7-point stencil reads */
+static int ghosts_differ(const double *A, const double *B, int nx, int ny, int nz) {
+  long plane = (long) nx * ny, p;
+  int i, j, k;
+
+  for (k = 0; k < nz; k++)
+    for (j = 0; j < ny; j++)
+      for (i = 0; i < nx; i++) {
+	int gi = i == 0 || i == nx - 1, gj = j == 0 || j == ny - 1, gk = k == 0 || k == nz - 1;
+
+	// faces only: edges and corners feed no interior point
+	if (gi + gj + gk != 1)
+	  continue;
+	p = plane * k + (long) nx * j + i;
+	if (A[p] != B[p])
+	  return 1;
+	if (!gk && !gj && i == 0)
+	  i = nx - 2;
+      }
+  return 0;
+}
+
+void ActiveInit(active_map *m, const double *A0, const double *Anext, int nx, int ny, int nz,
+		int tx, int ty, int bc) {
+  long n, i;
+
+  memset(m, 0, sizeof(*m));
+  m->on = active_enabled();
+  if (!m->on)
+    return;
+  m->nz = nz;
+  m->ntx = (nx - 2 + tx - 1) / tx;
+  m->nty = (ny - 2 + ty - 1) / ty;
+  m->bc = bc;
+  m->ghosts = bc == BC_DIRICHLET && ghosts_differ(A0, Anext, nx, ny, nz);
+  n = (long) nz * m->ntx * m->nty;
+  m->mark = scratch_mark();
+  m->stamp = (int *) scratch_alloc(n * sizeof(int));
+  // "changed in step -1", so the first step computes everything
+  for (i = 0; i < n; i++)
+    m->stamp[i] = -1;
+}
+
+void ActiveFree(active_map *m) {
+  if (m->stamp != NULL)
+    scratch_release(m->mark);
+  m->stamp = NULL;
+}
+
+void ActiveCount(long computed, long skipped) {
+  __atomic_fetch_add(&total_computed, computed, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&total_skipped, skipped, __ATOMIC_RELAXED);
+}
+
+void ActiveReset() {
+  total_computed = total_skipped = 0;
+}
+
+void ActiveTotals(long *computed, long *skipped) {
+  *computed = total_computed;
+  *skipped = total_skipped;
+}
+
+void ActiveReport() {
+  long all = total_computed + total_skipped;
+
+  if (all == 0)
+    return;
+  printf("active tiles: %ld computed, %ld skipped (%.1f%% skipped)\n",
+	 total_computed, total_skipped, 100.0 * total_skipped / all);
+}
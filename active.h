@@ -0,0 +1,88 @@
+#ifndef _ACTIVE_H_
+#define _ACTIVE_H_
+
+#include <stddef.h>
+#include "boundary.h"
+
+/*
+  Active-tile execution.  With STENCILPROBE_ACTIVE=1 the blocked kernel
+  keeps, for every tile column of every plane, the last timestep in which
+  its values changed, and skips a tile whose own values and whose face
+  neighbors' (the 7-point stencil's inputs) did not change in the
+  previous step: its new values would equal the old ones, which the
+  destination array already holds.  A computed tile compares its output
+  with its input to update its entry, so the map is maintained as a side
+  effect of the sweep.
+
+  Each kernel call has its own map, taken from the calling thread's
+  scratch arena (scratch.h, which ScratchInit sizes for it), so calls
+  running side by side (the batch driver runs one per thread) do not see
+  each other's stamps and the timed call does not malloc.
+  Every entry has one writer, the thread owning the plane, and is read
+  by the owners of the planes next to it, which the pool's neighbor sync
+  or barriers already order.  Under periodic boundaries the neighbors
+  wrap around, since ghosts come from the far side of the grid.  Fixed
+  (Dirichlet) ghosts alternate between the two arrays' values as they
+  swap, so tiles on the boundary can only be skipped when those agree.
+*/
+
+typedef struct {
+  int on;			/* skipping enabled for the current call */
+  int nz, ntx, nty, bc;
+  int ghosts;			/* Dirichlet ghosts differ between the arrays */
+  int *stamp;			/* [k][tj][ti]: last step the tile changed */
+  size_t mark;			/* scratch mark to release it to */
+} active_map;
+
+/* STENCILPROBE_ACTIVE, unless ActiveSet(on >= 0) overrides it */
+int active_enabled();
+void ActiveSet(int on);
+
+/*
+  Starts a kernel call's map m: every tile of tx*ty columns counts as
+  changed.  ActiveFree gives its scratch back when the call returns.
+*/
+void ActiveInit(active_map *m, const double *A0, const double *Anext, int nx, int ny, int nz,
+		int tx, int ty, int bc);
+void ActiveFree(active_map *m);
+
+/* adds a slab's tile counts to the totals */
+void ActiveCount(long computed, long skipped);
+
+/* totals since the last ActiveReset */
+void ActiveReset();
+void ActiveTotals(long *computed, long *skipped);
+void ActiveReport();
+
+static inline int *active_stamp(const active_map *m, int k, int ti, int tj) {
+  return &m->stamp[((long) k * m->nty + tj) * m->ntx + ti];
+}
+
+/*
+  Whether tile (ti,tj,k), possibly a ghost position, changed in step
+  last.  Periodic ghosts change with the tile one period away; zero-flux
+  ghosts copy the tile itself; fixed ones change every step if the
+  arrays disagree on them.
+*/
+static inline int active_changed(const active_map *m, int k, int ti, int tj, int last) {
+  if (k == 0 || k == m->nz - 1 || ti < 0 || ti == m->ntx || tj < 0 || tj == m->nty) {
+    if (m->bc != BC_PERIODIC)
+      return m->bc == BC_DIRICHLET && m->ghosts;
+    k = k == 0 ? m->nz - 2 : k == m->nz - 1 ? 1 : k;
+    ti = ti < 0 ? m->ntx - 1 : ti == m->ntx ? 0 : ti;
+    tj = tj < 0 ? m->nty - 1 : tj == m->nty ? 0 : tj;
+  }
+  return *active_stamp(m, k, ti, tj) >= last;
+}
+
+/* whether tile (ti,tj,k) must be computed in step */
+static inline int active_needed(const active_map *m, int k, int ti, int tj, int step) {
+  int last = step - 1;
+
+  return active_changed(m, k, ti, tj, last) ||
+    active_changed(m, k - 1, ti, tj, last) || active_changed(m, k + 1, ti, tj, last) ||
+    active_changed(m, k, ti - 1, tj, last) || active_changed(m, k, ti + 1, tj, last) ||
+    active_changed(m, k, ti, tj - 1, last) || active_changed(m, k, ti, tj + 1, last);
+}
+
+#endif
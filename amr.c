@@ -0,0 +1,189 @@
+/*
+	Stencil Probe nested-grid (AMR-style) driver
+	Coarse/fine interpolation and restriction around the probe kernels.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "amr.h"
+#include "util.h"
+#include "cycle.h"
+
+static double *alloc_level(int nx, int ny, int nz) {
+  double *A = (double *) malloc(sizeof(double) * nx * ny * nz);
+
+  if (A == NULL) {
+    printf("Error on AMR level malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  return A;
+}
+
+/* trilinear interpolation of parent p at fine point (i,j,k) of level f */
+static double interp_point(const amr_level *p, const amr_level *f,
+			   int i, int j, int k) {
+  double x = f->ox + 0.5 * (i - 1) - 0.25;
+  double y = f->oy + 0.5 * (j - 1) - 0.25;
+  double z = f->oz + 0.5 * (k - 1) - 0.25;
+  int x0 = (int) floor(x), y0 = (int) floor(y), z0 = (int) floor(z);
+  double wx = x - x0, wy = y - y0, wz = z - z0;
+  const double *c = &p->A0[Index3D (p->nx, p->ny, x0, y0, z0)];
+  int sy = p->nx, sz = p->nx * p->ny;
+
+  return (1-wz) * ((1-wy) * ((1-wx) * c[0]       + wx * c[1])
+		   +   wy  * ((1-wx) * c[sy]      + wx * c[sy+1]))
+    +       wz  * ((1-wy) * ((1-wx) * c[sz]      + wx * c[sz+1])
+		   +   wy  * ((1-wx) * c[sz+sy]   + wx * c[sz+sy+1]));
+}
+
+/* fills the ghost faces of f from its parent; returns points written.
+   Edges and corners are never read by the 7-point stencil and are left
+   alone, which also keeps the kernels' A0[0] coefficient intact. */
+static long fill_ghosts(const amr_level *p, amr_level *f) {
+  int nx = f->nx, ny = f->ny, nz = f->nz;
+  int i, j, k;
+  long n = 0;
+
+  for (k = 0; k < nz; k++) {
+    for (j = 1; j < ny-1; j++) {
+      if (k == 0 || k == nz-1) {
+	for (i = 1; i < nx-1; i++)
+	  f->A0[Index3D (nx, ny, i, j, k)] = interp_point(p, f, i, j, k);
+	n += nx-2;
+      }
+      else {
+	f->A0[Index3D (nx, ny, 0, j, k)] = interp_point(p, f, 0, j, k);
+	f->A0[Index3D (nx, ny, nx-1, j, k)] = interp_point(p, f, nx-1, j, k);
+	n += 2;
+      }
+    }
+    if (k > 0 && k < nz-1) {
+      for (i = 1; i < nx-1; i++) {
+	f->A0[Index3D (nx, ny, i, 0, k)] = interp_point(p, f, i, 0, k);
+	f->A0[Index3D (nx, ny, i, ny-1, k)] = interp_point(p, f, i, ny-1, k);
+      }
+      n += 2*(nx-2);
+    }
+  }
+  return n;
+}
+
+/* averages the interior of f onto the parent cells it covers; returns cells written */
+static long restrict_down(amr_level *p, const amr_level *f) {
+  int fnx = f->nx, fny = f->ny;
+  int cwx = (f->nx - 2) / 2, cwy = (f->ny - 2) / 2, cwz = (f->nz - 2) / 2;
+  int sy = fnx, sz = fnx * fny;
+  int ci, cj, ck;
+
+  for (ck = 0; ck < cwz; ck++) {
+    for (cj = 0; cj < cwy; cj++) {
+      double *out = &p->A0[Index3D (p->nx, p->ny, f->ox, f->oy + cj, f->oz + ck)];
+      for (ci = 0; ci < cwx; ci++) {
+	const double *c = &f->A0[Index3D (fnx, fny, 1 + 2*ci, 1 + 2*cj, 1 + 2*ck)];
+	out[ci] = 0.125 * (c[0] + c[1] + c[sy] + c[sy+1]
+			   + c[sz] + c[sz+1] + c[sz+sy] + c[sz+sy+1]);
+      }
+    }
+  }
+  return (long) cwx * cwy * cwz;
+}
+
+long AmrInterpolate(const amr_level *p, amr_level *f) {
+  int i, j, k;
+
+  for (k = 1; k < f->nz-1; k++)
+    for (j = 1; j < f->ny-1; j++)
+      for (i = 1; i < f->nx-1; i++)
+	f->A0[Index3D (f->nx, f->ny, i, j, k)] = interp_point(p, f, i, j, k);
+  return (long) (f->nx-2) * (f->ny-2) * (f->nz-2);
+}
+
+long AmrRestrict(amr_level *p, const amr_level *f) {
+  return restrict_down(p, f);
+}
+
+void AmrInit(amr_level *levels, int nlevels, int nx, int ny, int nz) {
+  int l;
+
+  for (l = 0; l < nlevels; l++) {
+    amr_level *lev = &levels[l];
+
+    if (l == 0) {
+      lev->nx = nx;  lev->ny = ny;  lev->nz = nz;
+      lev->ox = lev->oy = lev->oz = 0;
+    }
+    else {
+      const amr_level *p = &levels[l-1];
+      // refine the middle half of the parent interior
+      lev->ox = 1 + (p->nx - 2) / 4;
+      lev->oy = 1 + (p->ny - 2) / 4;
+      lev->oz = 1 + (p->nz - 2) / 4;
+      lev->nx = 2 * ((p->nx - 2) / 2) + 2;
+      lev->ny = 2 * ((p->ny - 2) / 2) + 2;
+      lev->nz = 2 * ((p->nz - 2) / 2) + 2;
+    }
+    lev->A0 = alloc_level(lev->nx, lev->ny, lev->nz);
+    lev->Anext = alloc_level(lev->nx, lev->ny, lev->nz);
+    StencilInit(lev->nx, lev->ny, lev->nz, lev->A0);
+    StencilInit(lev->nx, lev->ny, lev->nz, lev->Anext);
+    // only the faces of A0 are read; they are refilled after every step
+    if (l > 0)
+      fill_ghosts(&levels[l-1], lev);
+  }
+}
+
+void AmrFree(amr_level *levels, int nlevels) {
+  int l;
+
+  for (l = 0; l < nlevels; l++) {
+    free(levels[l].A0);
+    free(levels[l].Anext);
+  }
+}
+
+void StencilProbe_amr(amr_level *levels, int nlevels, stencil_fn kernel,
+		      int tx, int ty, int tz, int timesteps, amr_stats *stats) {
+  amr_stats s = {0, 0, 0, 0, 0, 0};
+  double *temp_ptr;
+  ticks t0, t1;
+  int l, t;
+
+  for (t = 0; t < timesteps; t++) {
+    t0 = getticks();
+    for (l = 0; l < nlevels; l++) {
+      amr_level *lev = &levels[l];
+      kernel(lev->A0, lev->Anext, lev->nx, lev->ny, lev->nz, tx, ty, tz, 1);
+      temp_ptr = lev->A0;
+      lev->A0 = lev->Anext;
+      lev->Anext = temp_ptr;
+      // 7 loads and 1 store per interior point
+      s.stencil_bytes += 8.0 * sizeof(double)
+	* (lev->nx - 2) * (lev->ny - 2) * (lev->nz - 2);
+    }
+    t1 = getticks();
+    s.stencil_ticks += elapsed(t1, t0);
+
+    t0 = getticks();
+    for (l = nlevels - 1; l > 0; l--)
+      // 8 loads and 1 store per covered parent cell
+      s.restrict_bytes += 9.0 * sizeof(double) * restrict_down(&levels[l-1], &levels[l]);
+    t1 = getticks();
+    s.restrict_ticks += elapsed(t1, t0);
+
+    t0 = getticks();
+    for (l = 1; l < nlevels; l++)
+      // 8 loads and 1 store per ghost point
+      s.interp_bytes += 9.0 * sizeof(double) * fill_ghosts(&levels[l-1], &levels[l]);
+    t1 = getticks();
+    s.interp_ticks += elapsed(t1, t0);
+  }
+
+  if (stats != NULL) {
+    stats->stencil_ticks += s.stencil_ticks;
+    stats->interp_ticks += s.interp_ticks;
+    stats->restrict_ticks += s.restrict_ticks;
+    stats->stencil_bytes += s.stencil_bytes;
+    stats->interp_bytes += s.interp_bytes;
+    stats->restrict_bytes += s.restrict_bytes;
+  }
+}
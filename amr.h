@@ -0,0 +1,59 @@
+#ifndef _AMR_H_
+#define _AMR_H_
+
+#include "common.h"
+
+/*
+  Nested-grid (AMR-style) probe.  Level 0 is the coarse grid; each finer
+  level refines the middle half of the previous level's interior by a
+  factor of 2 in every dimension.  Every level stores a one point ghost
+  shell, so the interior of each level is advanced by an ordinary
+  StencilProbe kernel.
+*/
+
+#define AMR_MAX_LEVELS 3
+
+typedef struct {
+  double *A0, *Anext;	/* current and next values, including the ghost shell */
+  int nx, ny, nz;	/* size including the ghost shell */
+  int ox, oy, oz;	/* first parent interior cell covered (levels > 0) */
+} amr_level;
+
+typedef struct {
+  double stencil_ticks, interp_ticks, restrict_ticks;
+  /* bytes referenced by each phase (loads + stores, no cache reuse) */
+  double stencil_bytes, interp_bytes, restrict_bytes;
+} amr_stats;
+
+/*
+  Allocates nlevels (1..AMR_MAX_LEVELS) nested levels over a coarse grid of
+  nx*ny*nz, initializes them with StencilInit and fills the fine ghost
+  faces from their parents.
+ */
+void AmrInit(amr_level *levels, int nlevels, int nx, int ny, int nz);
+
+void AmrFree(amr_level *levels, int nlevels);
+
+/*
+  The transfers between a parent p and its child f, on A0.  AmrInterpolate
+  fills the interior of f by trilinear interpolation from p; AmrRestrict
+  averages the interior of f onto the parent cells it covers.  Both are
+  exact for fields linear in i, j and k, so restricting an interpolated
+  field gives the parent back.  They return the points written.
+ */
+long AmrInterpolate(const amr_level *p, amr_level *f);
+long AmrRestrict(amr_level *p, const amr_level *f);
+
+/*
+  Advances all levels by timesteps steps (no subcycling).  Each step:
+    1. updates the interior of every level with kernel,
+    2. averages each fine level down onto the parent cells it covers,
+    3. fills each fine level's ghost faces by trilinear interpolation
+       from its parent.
+  Phase ticks and referenced bytes are accumulated into stats, which may
+  be NULL.
+ */
+void StencilProbe_amr(amr_level *levels, int nlevels, stencil_fn kernel,
+		      int tx, int ty, int tz, int timesteps, amr_stats *stats);
+
+#endif
@@ -0,0 +1,44 @@
+/*
+	Stencil Probe arena allocator
+	One aligned block, handed out front to back.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "arena.h"
+
+void arena_init(arena *a, size_t size) {
+  void *p = NULL;
+
+  size = ARENA_SIZE(size);
+  if (size > 0 && posix_memalign(&p, ARENA_ALIGN, size) != 0) {
+    printf("Error on arena malloc (%lu bytes).\n", (unsigned long) size);
+    exit(EXIT_FAILURE);
+  }
+  a->base = (char *) p;
+  a->size = size;
+  a->used = 0;
+}
+
+void *arena_alloc(arena *a, size_t bytes) {
+  void *p;
+
+  bytes = ARENA_SIZE(bytes);
+  if (a->used + bytes > a->size) {
+    printf("Error: arena exhausted (%lu of %lu bytes used, %lu requested).\n",
+	   (unsigned long) a->used, (unsigned long) a->size, (unsigned long) bytes);
+    exit(EXIT_FAILURE);
+  }
+  p = a->base + a->used;
+  a->used += bytes;
+  return p;
+}
+
+void arena_reset(arena *a) {
+  a->used = 0;
+}
+
+void arena_free(arena *a) {
+  free(a->base);
+  a->base = NULL;
+  a->size = a->used = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+/*
+  Bump allocator for buffers that live for a whole run.  Everything is
+  carved out of one block allocated up front, so the timed code never
+  calls malloc; arena_reset() releases all allocations at once.
+*/
+
+#define ARENA_ALIGN 64
+
+typedef struct {
+  char *base;
+  size_t size, used;
+} arena;
+
+void arena_init(arena *a, size_t size);
+
+/* returns ARENA_ALIGN-aligned memory; exits if the arena is exhausted */
+void *arena_alloc(arena *a, size_t bytes);
+
+void arena_reset(arena *a);
+
+/* stack-style release: arena_release(a, m) frees everything allocated
+   since m = arena_mark(a) */
+#define arena_mark(_a) ((_a)->used)
+#define arena_release(_a,_mark) ((_a)->used = (_mark))
+
+void arena_free(arena *a);
+
+/* bytes an allocation of size bytes takes from an arena */
+#define ARENA_SIZE(_bytes) ((((size_t) (_bytes)) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+
+#endif
@@ -0,0 +1,149 @@
+/*
+	Stencil Probe batched small-grid driver
+	Work-stealing scheduler for advancing many independent patches.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "batch.h"
+#include "trace.h"
+#include "util.h"
+#include "cycle.h"
+
+/*
+  Each thread owns a run [head, tail) of bundle indices packed into one
+  64-bit word so that the owner (taking from the head) and thieves (taking
+  from the tail) can both claim work with a single compare-and-swap.
+  Padded to a cache line to avoid false sharing between owners.
+*/
+typedef struct {
+  uint64_t range;
+  char pad[64 - sizeof(uint64_t)];
+} work_run;
+
+#define RUN(_head,_tail) (((uint64_t) (_head) << 32) | (uint32_t) (_tail))
+#define RUN_HEAD(_r) ((int) ((_r) >> 32))
+#define RUN_TAIL(_r) ((int) ((_r) & 0xffffffffu))
+
+/* claims one bundle from the head (owner) or tail (thief); -1 when empty */
+static int take_bundle(work_run *run, int from_tail) {
+  uint64_t old, new;
+  int head, tail;
+
+  old = __atomic_load_n(&run->range, __ATOMIC_ACQUIRE);
+  do {
+    head = RUN_HEAD(old);
+    tail = RUN_TAIL(old);
+    if (head >= tail)
+      return -1;
+    new = from_tail ? RUN(head, tail - 1) : RUN(head + 1, tail);
+  } while (!__atomic_compare_exchange_n(&run->range, &old, new, 0,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+  return from_tail ? tail - 1 : head;
+}
+
+/* groups consecutive patches into bundles of at most budget bytes */
+static int make_bundles(grid_desc *grids, int ngrids, long budget, int *first) {
+  long bytes = 0, patch;
+  int g, n = 0;
+
+  for (g = 0; g < ngrids; g++) {
+    patch = 2 * sizeof(double) * (long) grids[g].nx * grids[g].ny * grids[g].nz;
+    if (g == 0 || bytes + patch > budget) {
+      first[n++] = g;
+      bytes = 0;
+    }
+    bytes += patch;
+  }
+  first[n] = ngrids;
+  return n;
+}
+
+void StencilProbe_batch(grid_desc *grids, int ngrids, stencil_fn kernel,
+			int tx, int ty, int tz, int timesteps,
+			batch_stats *stats) {
+  work_run *runs;
+  int *first;
+  int nbundles, nthreads = 1;
+  long budget, steals = 0;
+  double compute = 0;
+  ticks t0, t1;
+  int b, g;
+
+#ifdef _OPENMP
+  nthreads = omp_get_max_threads();
+#endif
+  budget = probe_param("BATCH_BYTES", 0);
+  if (budget <= 0)
+    budget = cache_size(2) / 2;
+  if (budget <= 0)
+    budget = 256 * 1024;
+
+  // the schedule's storage is not scheduling work, so it is taken before
+  // the clock starts and given back after it stops
+  first = (int *) malloc((ngrids + 1) * sizeof(int));
+  runs = (work_run *) malloc(nthreads * sizeof(work_run));
+  if (first == NULL || runs == NULL) {
+    printf("Error on batch schedule malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  t0 = getticks();
+  nbundles = make_bundles(grids, ngrids, budget, first);
+
+  for (b = 0; b < nthreads; b++)
+    runs[b].range = RUN((long) nbundles * b / nthreads,
+			(long) nbundles * (b + 1) / nthreads);
+
+#pragma omp parallel num_threads(nthreads) private(b, g) reduction(+:steals, compute)
+  {
+    int me = 0, victim, v, stolen;
+    ticks p0, p1;
+    trace_tsc tt;
+
+#ifdef _OPENMP
+    me = omp_get_thread_num();
+#endif
+    for (;;) {
+      b = take_bundle(&runs[me], 0);
+      stolen = b < 0;
+      if (b < 0) {
+	// own run exhausted: steal from the tail of the next non-empty run
+	for (v = 1; v < nthreads && b < 0; v++) {
+	  victim = (me + v) % nthreads;
+	  b = take_bundle(&runs[victim], 1);
+	}
+	if (b < 0)
+	  break;
+	steals++;
+      }
+      TRACE_START(tt);
+      for (g = first[b]; g < first[b+1]; g++) {
+	p0 = getticks();
+	kernel(grids[g].A0, grids[g].Anext, grids[g].nx, grids[g].ny, grids[g].nz,
+	       tx, ty, tz, timesteps);
+	p1 = getticks();
+	grids[g].ticks = elapsed(p1, p0);
+	compute += grids[g].ticks;
+      }
+      // step 1 marks stolen bundles
+      TRACE_TILE("batch", b, stolen, tt);
+    }
+  }
+
+  t1 = getticks();
+
+  if (stats != NULL) {
+    stats->nbundles = nbundles;
+    stats->nthreads = nthreads;
+    stats->steals = steals;
+    stats->compute_ticks = compute;
+    stats->wall_ticks = elapsed(t1, t0);
+  }
+
+  free(first);
+  free(runs);
+}
@@ -0,0 +1,40 @@
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include "common.h"
+
+/*
+  Batched execution of many small independent grids (e.g. the patches of
+  one AMR level).  Each patch is advanced by an ordinary StencilProbe
+  kernel; the batch layer only decides which thread runs which patches.
+  A bundle's patches run one after the other, each through all of its
+  timesteps: no cache tile spans two patches.
+*/
+
+typedef struct {
+  double *A0, *Anext;	/* same meaning as for StencilProbe */
+  int nx, ny, nz;
+  double ticks;		/* filled in: ticks spent in the kernel for this patch */
+} grid_desc;
+
+typedef struct {
+  int nbundles;		/* number of scheduling units the patches were grouped into */
+  int nthreads;
+  long steals;		/* bundles run by a thread other than their owner */
+  double compute_ticks;	/* sum of grid_desc.ticks */
+  double wall_ticks;	/* elapsed ticks for the whole batch */
+} batch_stats;
+
+/*
+  Advances every grid by timesteps steps with kernel.  Consecutive patches
+  are grouped into bundles whose two-array footprint fits in half of L2
+  (or STENCILPROBE_BATCH_BYTES); bundles are dealt out to the threads in
+  contiguous runs and idle threads steal from the tail of other threads'
+  runs.  stats may be NULL; its wall time covers the bundling and the
+  runs, not the schedule's allocation.
+ */
+void StencilProbe_batch(grid_desc *grids, int ngrids, stencil_fn kernel,
+			int tx, int ty, int tz, int timesteps,
+			batch_stats *stats);
+
+#endif
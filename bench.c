@@ -0,0 +1,164 @@
+/*
+	Stencil Probe regression baselines
+	Baseline files and the rank test that compares runs against them.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+double mann_whitney_p(const double *x, int m, const double *y, int n) {
+  double u = 0, total = 0, tail = 0, *prev, *cur, *tmp;
+  int i, j, v, umax = m * n, obs;
+
+  for (i = 0; i < m; i++)
+    for (j = 0; j < n; j++)
+      u += x[i] > y[j] ? 1 : x[i] == y[j] ? 0.5 : 0;
+  obs = (int) (u + 0.5);
+
+  /*
+    cur[j][v]: orderings of i x's and j y's with U = v.  The largest of
+    them is either an x, which beats all j y's, or a y, which beats nothing.
+  */
+  prev = (double *) calloc((size_t) (n + 1) * (umax + 1), sizeof(double));
+  cur = (double *) calloc((size_t) (n + 1) * (umax + 1), sizeof(double));
+  if (prev == NULL || cur == NULL) {
+    printf("Error on rank test malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (j = 0; j <= n; j++)
+    prev[j * (umax + 1)] = 1;
+  for (i = 1; i <= m; i++) {
+    for (j = 0; j <= n; j++)
+      for (v = 0; v <= umax; v++)
+	cur[j * (umax + 1) + v] = (v >= j ? prev[j * (umax + 1) + v - j] : 0)
+	  + (j > 0 ? cur[(j - 1) * (umax + 1) + v] : 0);
+    tmp = prev;
+    prev = cur;
+    cur = tmp;
+  }
+  for (v = 0; v <= umax; v++) {
+    total += prev[n * (umax + 1) + v];
+    if (v >= obs)
+      tail += prev[n * (umax + 1) + v];
+  }
+  free(prev);
+  free(cur);
+  return tail / total;
+}
+
+/* the string value of "key": "..." in line */
+static int json_string(const char *line, const char *key, char *out, int len) {
+  char pat[40];
+  const char *p;
+  int i;
+
+  snprintf(pat, sizeof(pat), "\"%s\": \"", key);
+  if ((p = strstr(line, pat)) == NULL)
+    return -1;
+  p += strlen(pat);
+  for (i = 0; i < len - 1 && p[i] != '"' && p[i] != '\0'; i++)
+    out[i] = p[i];
+  out[i] = '\0';
+  return 0;
+}
+
+static int json_int(const char *line, const char *key, int *out) {
+  char pat[40];
+  const char *p;
+
+  snprintf(pat, sizeof(pat), "\"%s\": ", key);
+  if ((p = strstr(line, pat)) == NULL)
+    return -1;
+  return sscanf(p + strlen(pat), "%d", out) == 1 ? 0 : -1;
+}
+
+int BenchLoad(const char *path, bench_entry **out) {
+  FILE *f = fopen(path, "r");
+  bench_entry *e = NULL, *t;
+  char line[4096], *p, *end;
+  int n = 0, cap = 0;
+
+  *out = NULL;
+  if (f == NULL)
+    return -1;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (strstr(line, "\"kernel\"") == NULL)
+      continue;
+    if (n == cap) {
+      cap = cap ? 2 * cap : 32;
+      if ((t = (bench_entry *) realloc(e, cap * sizeof(bench_entry))) == NULL) {
+	printf("Error on baseline malloc.\n");
+	exit(EXIT_FAILURE);
+      }
+      e = t;
+    }
+    memset(&e[n], 0, sizeof(bench_entry));
+    if (json_string(line, "kernel", e[n].kernel, sizeof(e[n].kernel)) < 0 ||
+	json_string(line, "grid", e[n].grid, sizeof(e[n].grid)) < 0 ||
+	json_int(line, "n", &e[n].n) < 0 || json_int(line, "threads", &e[n].threads) < 0 ||
+	json_int(line, "steps", &e[n].steps) < 0 || (p = strstr(line, "\"samples\": [")) == NULL)
+      continue;
+    p += strlen("\"samples\": [");
+    while (e[n].count < BENCH_MAX_SAMPLES) {
+      e[n].samples[e[n].count] = strtod(p, &end);
+      if (end == p)
+	break;
+      e[n].count++;
+      for (p = end; *p == ',' || *p == ' '; p++)
+	;
+    }
+    if (e[n].count > 0)
+      n++;
+  }
+  fclose(f);
+  *out = e;
+  return n;
+}
+
+int BenchSave(const char *path, const char *host, const bench_entry *e, int n) {
+  FILE *f = fopen(path, "w");
+  int i, s;
+
+  if (f == NULL)
+    return -1;
+  fprintf(f, "{\n  \"host\": \"%s\",\n  \"entries\": [\n", host);
+  for (i = 0; i < n; i++) {
+    fprintf(f, "    {\"kernel\": \"%s\", \"grid\": \"%s\", \"n\": %d, \"threads\": %d, \"steps\": %d, \"samples\": [",
+	    e[i].kernel, e[i].grid, e[i].n, e[i].threads, e[i].steps);
+    for (s = 0; s < e[i].count; s++)
+      fprintf(f, "%s%.6g", s ? ", " : "", e[i].samples[s]);
+    fprintf(f, "]}%s\n", i < n - 1 ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+  return fclose(f) == 0 ? 0 : -1;
+}
+
+const bench_entry *bench_find(const bench_entry *e, int n, const bench_entry *key) {
+  int i;
+
+  for (i = 0; i < n; i++)
+    if (strcmp(e[i].kernel, key->kernel) == 0 && strcmp(e[i].grid, key->grid) == 0 &&
+	e[i].n == key->n && e[i].threads == key->threads && e[i].steps == key->steps)
+      return &e[i];
+  return NULL;
+}
+
+int bench_merge(const bench_entry *base, int nbase, const bench_entry *run, int nrun,
+		int replace, bench_entry **out) {
+  bench_entry *m = (bench_entry *) malloc((nbase + nrun + 1) * sizeof(bench_entry));
+  const bench_entry *r;
+  int i, n = 0;
+
+  if (m == NULL) {
+    printf("Error on baseline merge malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < nbase; i++)
+    m[n++] = replace && (r = bench_find(run, nrun, &base[i])) != NULL ? *r : base[i];
+  for (i = 0; i < nrun; i++)
+    if (bench_find(base, nbase, &run[i]) == NULL)
+      m[n++] = run[i];
+  *out = m;
+  return n;
+}
@@ -0,0 +1,57 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+/*
+  Regression baselines for make bench.  A baseline is a JSON file per
+  host holding, for every point of the benchmark matrix, the throughput
+  samples (Mpoints/s) of the run that recorded it:
+
+    {
+      "host": "<hostname>",
+      "entries": [
+        {"kernel": "naive", "grid": "L2", "n": 50, "threads": 1, "steps": 4, "samples": [812.4, ...]},
+        ...
+      ]
+    }
+
+  BenchLoad only reads what BenchSave writes (one entry per line); it is
+  not a general JSON parser.
+*/
+
+#define BENCH_MAX_SAMPLES 32
+
+typedef struct {
+  char kernel[32];
+  char grid[8];		/* L2, LLC or DRAM */
+  int n, threads, steps;	/* cubic grid edge, threads, timesteps per call */
+  int count;
+  double samples[BENCH_MAX_SAMPLES];
+} bench_entry;
+
+/*
+  One-sided Mann-Whitney U test: the probability, if x and y come from
+  the same distribution, of x beating y at least as often as it did
+  (pairs with x[i] > y[j], ties counting half).  Exact, from the
+  distribution of U over all orderings of the m + n samples, so it holds
+  for the handful of samples a benchmark takes.
+ */
+double mann_whitney_p(const double *x, int m, const double *y, int n);
+
+/* entries of the baseline at path; returns the count, or -1 if there is no file */
+int BenchLoad(const char *path, bench_entry **out);
+
+/* writes n entries to path; returns 0, or -1 if the file cannot be written */
+int BenchSave(const char *path, const char *host, const bench_entry *e, int n);
+
+/* the entry of e[0..n-1] for the same kernel, grid, edge, threads and steps as key */
+const bench_entry *bench_find(const bench_entry *e, int n, const bench_entry *key);
+
+/*
+  The baseline after a run: every entry of base, replaced by the run's
+  measurement of the same point if replace is set, then the points of run
+  the baseline did not have.  Returns the count; *out is malloc'ed.
+*/
+int bench_merge(const bench_entry *base, int nbase, const bench_entry *run, int nrun,
+		int replace, bench_entry **out);
+
+#endif
@@ -0,0 +1,151 @@
+/*
+	Stencil Probe boundary conditions
+	Periodic and zero-flux ghost updates, timed per call.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "common.h"
+#include "boundary.h"
+
+static const char *names[BC_KINDS] = { "dirichlet", "periodic", "neumann" };
+
+static int override = -1;
+static unsigned long long ticks_spent;
+static long calls;
+
+static inline unsigned long long bc_now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return 0;
+#endif
+}
+
+const char *bc_name(int kind) {
+  return kind >= 0 && kind < BC_KINDS ? names[kind] : "?";
+}
+
+void BoundarySet(int kind) {
+  override = kind;
+}
+
+int bc_kind() {
+  const char *s = getenv("STENCILPROBE_BC");
+  int k;
+
+  if (override >= 0)
+    return override;
+  if (s != NULL)
+    for (k = 0; k < BC_KINDS; k++)
+      if (strcmp(s, names[k]) == 0)
+	return k;
+  return BC_DIRICHLET;
+}
+
+/* x and y ghosts of plane k */
+static void faces(double *A, int nx, int ny, int k, int kind) {
+  double *p = A + (long) nx * ny * k, *row;
+  int j;
+
+  for (j = 1; j < ny - 1; j++) {
+    row = p + (long) nx * j;
+    if (kind == BC_PERIODIC) {
+      row[0] = row[nx - 2];
+      row[nx - 1] = row[1];
+    }
+    else {
+      row[0] = row[1];
+      row[nx - 1] = row[nx - 2];
+    }
+  }
+  if (kind == BC_PERIODIC) {
+    memcpy(p + 1, p + (long) nx * (ny - 2) + 1, (nx - 2) * sizeof(double));
+    memcpy(p + (long) nx * (ny - 1) + 1, p + nx + 1, (nx - 2) * sizeof(double));
+  }
+  else {
+    memcpy(p + 1, p + nx + 1, (nx - 2) * sizeof(double));
+    memcpy(p + (long) nx * (ny - 1) + 1, p + (long) nx * (ny - 2) + 1, (nx - 2) * sizeof(double));
+  }
+}
+
+/* interior rows of plane src into ghost plane dst */
+static void copy_plane(double *A, int nx, int ny, int dst, int src) {
+  long plane = (long) nx * ny;
+  int j;
+
+  for (j = 1; j < ny - 1; j++)
+    memcpy(A + dst * plane + (long) nx * j + 1, A + src * plane + (long) nx * j + 1,
+	   (nx - 2) * sizeof(double));
+}
+
+static void fill(double *A, int nx, int ny, int nz, int k, int kind) {
+  faces(A, nx, ny, k, kind);
+  if (kind == BC_PERIODIC) {
+    if (k == nz - 2)
+      copy_plane(A, nx, ny, 0, k);
+    if (k == 1)
+      copy_plane(A, nx, ny, nz - 1, k);
+  }
+  else {
+    if (k == 1)
+      copy_plane(A, nx, ny, 0, k);
+    if (k == nz - 2)
+      copy_plane(A, nx, ny, nz - 1, k);
+  }
+}
+
+static void charge(unsigned long long t0) {
+  __atomic_fetch_add(&ticks_spent, bc_now() - t0, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&calls, 1, __ATOMIC_RELAXED);
+}
+
+void boundary_plane(double *A, int nx, int ny, int nz, int k, int kind) {
+  unsigned long long t0;
+
+  if (kind == BC_DIRICHLET)
+    return;
+  t0 = bc_now();
+  fill(A, nx, ny, nz, k, kind);
+  charge(t0);
+}
+
+void boundary_slab(double *A, int nx, int ny, int nz, int k0, int k1, int kind) {
+  unsigned long long t0;
+  int k;
+
+  if (kind == BC_DIRICHLET)
+    return;
+  t0 = bc_now();
+  for (k = k0; k < k1; k++)
+    fill(A, nx, ny, nz, k, kind);
+  charge(t0);
+}
+
+void BoundaryApply(double *A, int nx, int ny, int nz, int kind) {
+  boundary_slab(A, nx, ny, nz, 1, nz - 1, kind);
+}
+
+void BoundaryReset() {
+  ticks_spent = 0;
+  calls = 0;
+}
+
+void BoundaryReport(double spt, double wall) {
+  int kind = bc_kind(), threads = 1;
+
+  if (kind == BC_DIRICHLET)
+    return;
+  if (calls == 0) {
+    printf("boundary %s: not applied by this kernel (Dirichlet)\n", bc_name(kind));
+    return;
+  }
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+  printf("boundary %s: %.3g s in ghost updates, %.1f%% of %d thread(s) x wall\n", bc_name(kind),
+	 spt * ticks_spent, wall > 0 ? 100 * spt * ticks_spent / (wall * threads) : 0, threads);
+}
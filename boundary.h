@@ -0,0 +1,60 @@
+#ifndef _BOUNDARY_H_
+#define _BOUNDARY_H_
+
+/*
+  Boundary conditions on the ghost shell.  The kernels normally leave the
+  shell at its initial values (fixed Dirichlet); STENCILPROBE_BC selects
+
+    dirichlet  the shell is never written (the default)
+    periodic   a ghost point takes the interior point one period away:
+               A(0) = A(n-2), A(n-1) = A(1) in each direction
+    neumann    zero flux: a ghost point takes its interior neighbor,
+               A(0) = A(1), A(n-1) = A(n-2)
+
+  Only the ghost faces are filled (the interior range of the other two
+  indices): a 7-point stencil never reads the edges or corners of the
+  shell, and the corner A[0] keeps the kernels' scale factor.
+
+  Kernels apply the condition to the array they just wrote, inside their
+  time loop: boundary_plane() fills the x and y ghosts of an interior
+  plane and any z ghost plane that plane feeds, so a kernel that finishes
+  whole planes calls it while the plane is still in cache.  The naive
+  kernel does so per plane, the Rivera kernel once its slab is done and
+  the plane-streaming kernel in a separate parallel pass per step; the
+  temporally blocked kernels fuse several steps per pass and stay
+  Dirichlet.  Under periodic the z ghosts of one end come from the slab
+  at the other end, so the pool (pool.h) closes its neighbor ring.
+
+  Ghost updates are timed and BoundaryReport() prints their cost apart
+  from the sweep.
+*/
+
+#define BC_DIRICHLET 0
+#define BC_PERIODIC  1
+#define BC_NEUMANN   2
+#define BC_KINDS     3
+
+/* the condition from STENCILPROBE_BC, unless BoundarySet(kind >= 0) overrides it */
+int bc_kind();
+void BoundarySet(int kind);
+const char *bc_name(int kind);
+
+/* ghosts fed by interior plane k (1 <= k <= nz-2) of A */
+void boundary_plane(double *A, int nx, int ny, int nz, int k, int kind);
+
+/* ghosts fed by interior planes k0..k1-1 */
+void boundary_slab(double *A, int nx, int ny, int nz, int k0, int k1, int kind);
+
+/* the whole shell of A, e.g. the initial grid before the first step */
+void BoundaryApply(double *A, int nx, int ny, int nz, int kind);
+
+/*
+  Ticks spent in ghost updates (summed over threads) since the last
+  BoundaryReset; BoundaryReport prints them as seconds and as a share of
+  threads * wall, the time the instrumented call took, or notes that the
+  kernel ignored a non-Dirichlet condition.
+ */
+void BoundaryReset();
+void BoundaryReport(double spt, double wall);
+
+#endif
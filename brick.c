@@ -0,0 +1,267 @@
+/*
+	Stencil Probe bricked grids
+	Space-filling-curve brick orders, conversion to and from the
+	Index3D layout, and the naive and blocked bricked kernels.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "brick.h"
+#include "arena.h"
+#define MIN(x,y) (x < y ? x : y)
+#define D BRICK_DIM
+
+typedef struct {
+  unsigned long key;
+  int lex;
+} brick_key;
+
+static unsigned long morton_key(unsigned x, unsigned y, unsigned z, int bits) {
+  unsigned long key = 0;
+  int b;
+
+  for (b = bits - 1; b >= 0; b--)
+    key = (key << 3) | (((z >> b) & 1) << 2) | (((y >> b) & 1) << 1) | ((x >> b) & 1);
+  return key;
+}
+
+/* Skilling's transpose form of the Hilbert index (AIP Conf. Proc. 707, 2004) */
+static unsigned long hilbert_key(unsigned x, unsigned y, unsigned z, int bits) {
+  unsigned X[3], M = 1u << (bits - 1), P, Q, t;
+  unsigned long key = 0;
+  int b, i;
+
+  X[0] = z; X[1] = y; X[2] = x;
+  // inverse undo
+  for (Q = M; Q > 1; Q >>= 1) {
+    P = Q - 1;
+    for (i = 0; i < 3; i++)
+      if (X[i] & Q)
+	X[0] ^= P;
+      else {
+	t = (X[0] ^ X[i]) & P;
+	X[0] ^= t;
+	X[i] ^= t;
+      }
+  }
+  // Gray encode
+  for (i = 1; i < 3; i++)
+    X[i] ^= X[i-1];
+  t = 0;
+  for (Q = M; Q > 1; Q >>= 1)
+    if (X[2] & Q)
+      t ^= Q - 1;
+  for (i = 0; i < 3; i++)
+    X[i] ^= t;
+
+  for (b = bits - 1; b >= 0; b--)
+    for (i = 0; i < 3; i++)
+      key = (key << 1) | ((X[i] >> b) & 1);
+  return key;
+}
+
+static int by_key(const void *a, const void *b) {
+  const brick_key *x = a, *y = b;
+
+  if (x->key != y->key)
+    return x->key < y->key ? -1 : 1;
+  return x->lex - y->lex;
+}
+
+void BrickAlloc(brick_grid *g, int order, int nx, int ny, int nz) {
+  brick_key *keys;
+  void *p = NULL;
+  int n, s, bx, by, bz, bits;
+
+  g->nx = nx;
+  g->ny = ny;
+  g->nz = nz;
+  g->nbx = (nx + D - 1) / D;
+  g->nby = (ny + D - 1) / D;
+  g->nbz = (nz + D - 1) / D;
+  g->order = order;
+  n = g->nbx * g->nby * g->nbz;
+
+  g->slot = (int *) malloc(n * sizeof(int));
+  g->brick = (int *) malloc(n * sizeof(int));
+  keys = (brick_key *) malloc(n * sizeof(brick_key));
+  if (g->slot == NULL || g->brick == NULL || keys == NULL ||
+      posix_memalign(&p, ARENA_ALIGN, brick_bytes(g)) != 0) {
+    printf("Error on brick grid malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  g->data = (double *) p;
+  memset(g->data, 0, brick_bytes(g));
+
+  // the curves are defined on the power-of-two cube around the brick grid
+  for (bits = 1; (1 << bits) < g->nbx || (1 << bits) < g->nby || (1 << bits) < g->nbz; bits++)
+    ;
+  for (bz = 0; bz < g->nbz; bz++)
+    for (by = 0; by < g->nby; by++)
+      for (bx = 0; bx < g->nbx; bx++) {
+	s = Index3D (g->nbx, g->nby, bx, by, bz);
+	keys[s].lex = s;
+	if (order == BRICK_MORTON)
+	  keys[s].key = morton_key(bx, by, bz, bits);
+	else if (order == BRICK_HILBERT)
+	  keys[s].key = hilbert_key(bx, by, bz, bits);
+	else
+	  keys[s].key = s;
+      }
+  qsort(keys, n, sizeof(brick_key), by_key);
+  for (s = 0; s < n; s++) {
+    g->brick[s] = keys[s].lex;
+    g->slot[keys[s].lex] = s;
+  }
+  free(keys);
+}
+
+void BrickFree(brick_grid *g) {
+  free(g->data);
+  free(g->slot);
+  free(g->brick);
+  g->data = NULL;
+}
+
+long brick_bytes(const brick_grid *g) {
+  return (long) g->nbx * g->nby * g->nbz * BRICK_CELLS * sizeof(double);
+}
+
+const char *brick_order_name(int order) {
+  switch (order) {
+  case BRICK_MORTON:  return "morton";
+  case BRICK_HILBERT: return "hilbert";
+  default:            return "lex";
+  }
+}
+
+/* the first cell of brick (bx, by, bz), NULL outside the brick grid */
+static double *brick_base(const brick_grid *g, int bx, int by, int bz) {
+  if (bx < 0 || by < 0 || bz < 0 || bx >= g->nbx || by >= g->nby || bz >= g->nbz)
+    return NULL;
+  return &g->data[(long) g->slot[Index3D (g->nbx, g->nby, bx, by, bz)] * BRICK_CELLS];
+}
+
+void BrickFromLinear(brick_grid *g, const double *A) {
+  int bx, by, bz, j, k, w;
+
+  for (bz = 0; bz < g->nbz; bz++)
+    for (by = 0; by < g->nby; by++)
+      for (bx = 0; bx < g->nbx; bx++) {
+	double *b = brick_base(g, bx, by, bz);
+
+	w = MIN(D, g->nx - bx * D);
+	for (k = 0; k < MIN(D, g->nz - bz * D); k++)
+	  for (j = 0; j < MIN(D, g->ny - by * D); j++)
+	    memcpy(&b[(k * D + j) * D],
+		   &A[Index3D (g->nx, g->ny, bx * D, by * D + j, bz * D + k)],
+		   w * sizeof(double));
+      }
+}
+
+void BrickToLinear(const brick_grid *g, double *A) {
+  int bx, by, bz, j, k, w;
+
+  for (bz = 0; bz < g->nbz; bz++)
+    for (by = 0; by < g->nby; by++)
+      for (bx = 0; bx < g->nbx; bx++) {
+	const double *b = brick_base(g, bx, by, bz);
+
+	w = MIN(D, g->nx - bx * D);
+	for (k = 0; k < MIN(D, g->nz - bz * D); k++)
+	  for (j = 0; j < MIN(D, g->ny - by * D); j++)
+	    memcpy(&A[Index3D (g->nx, g->ny, bx * D, by * D + j, bz * D + k)],
+		   &b[(k * D + j) * D], w * sizeof(double));
+      }
+}
+
+/*
+  Updates the grid-interior cells of brick lex.  Rows on a brick face take
+  their y/z neighbor rows from the adjacent bricks and the two end cells
+  of every row take their x neighbors from the bricks on either side;
+  the middle of each row is a plain unit-stride loop.
+*/
+static void brick_update(const brick_grid *A, brick_grid *B, int lex, double fac) {
+  int bx = lex % A->nbx, by = (lex / A->nbx) % A->nby, bz = lex / (A->nbx * A->nby);
+  const double *c = brick_base(A, bx, by, bz);
+  const double *xm = brick_base(A, bx - 1, by, bz), *xp = brick_base(A, bx + 1, by, bz);
+  const double *ym = brick_base(A, bx, by - 1, bz), *yp = brick_base(A, bx, by + 1, bz);
+  const double *zm = brick_base(A, bx, by, bz - 1), *zp = brick_base(A, bx, by, bz + 1);
+  double *out = brick_base(B, bx, by, bz);
+  int i0 = bx == 0 ? 1 : 0, i1 = MIN(D, A->nx - 1 - bx * D);
+  int j0 = by == 0 ? 1 : 0, j1 = MIN(D, A->ny - 1 - by * D);
+  int k0 = bz == 0 ? 1 : 0, k1 = MIN(D, A->nz - 1 - bz * D);
+  int i, j, k, r;
+
+  // bricks made only of boundary cells and padding
+  if (i1 <= i0 || j1 <= j0 || k1 <= k0)
+    return;
+  for (k = k0; k < k1; k++) {
+    for (j = j0; j < j1; j++) {
+      const double *row = &c[(k * D + j) * D];
+      const double *kp = k < D - 1 ? row + D * D : &zp[j * D];
+      const double *km = k > 0 ? row - D * D : &zm[((D - 1) * D + j) * D];
+      const double *jp = j < D - 1 ? row + D : &yp[k * D * D];
+      const double *jm = j > 0 ? row - D : &ym[(k * D + D - 1) * D];
+      double *o = &out[(k * D + j) * D];
+
+      r = (k * D + j) * D;
+      if (i0 == 0)
+	o[0] = kp[0] + km[0] + jp[0] + jm[0] + row[1] + xm[r + D - 1]
+	  - 6.0 * row[0] / (fac*fac);
+      for (i = i0 > 1 ? i0 : 1; i < MIN(i1, D - 1); i++) {
+	o[i] =
+	  kp[i] +
+	  km[i] +
+	  jp[i] +
+	  jm[i] +
+	  row[i + 1] +
+	  row[i - 1]
+	  - 6.0 * row[i] / (fac*fac);
+      }
+      if (i1 == D)
+	o[D-1] = kp[D-1] + km[D-1] + jp[D-1] + jm[D-1] + xp[r] + row[D-2]
+	  - 6.0 * row[D-1] / (fac*fac);
+    }
+  }
+}
+
+void StencilProbe_brick_naive(brick_grid *A0, brick_grid *Anext, int tx, int ty, int tz,
+			      int timesteps) {
+  // Fool compiler so it doesn't insert a constant here
+  double fac = *brick_base(A0, 0, 0, 0);
+  int n = A0->nbx * A0->nby * A0->nbz;
+  brick_grid *temp_ptr;
+  int s, t;
+
+  for (t = 0; t < timesteps; t++) {
+    for (s = 0; s < n; s++)
+      brick_update(A0, Anext, A0->brick[s], fac);
+    temp_ptr = A0;
+    A0 = Anext;
+    Anext = temp_ptr;
+  }
+}
+
+void StencilProbe_brick_blocked(brick_grid *A0, brick_grid *Anext, int tx, int ty, int tz,
+				int timesteps) {
+  // Fool compiler so it doesn't insert a constant here
+  double fac = *brick_base(A0, 0, 0, 0);
+  int tbx = (tx + D - 1) / D, tby = (ty + D - 1) / D;
+  brick_grid *temp_ptr;
+  int bii, bjj, bx, by, bz, t;
+
+  if (tbx < 1) tbx = 1;
+  if (tby < 1) tby = 1;
+  for (t = 0; t < timesteps; t++) {
+    for (bjj = 0; bjj < A0->nby; bjj += tby)
+      for (bii = 0; bii < A0->nbx; bii += tbx)
+	for (bz = 0; bz < A0->nbz; bz++)
+	  for (by = bjj; by < MIN(bjj + tby, A0->nby); by++)
+	    for (bx = bii; bx < MIN(bii + tbx, A0->nbx); bx++)
+	      brick_update(A0, Anext, Index3D (A0->nbx, A0->nby, bx, by, bz), fac);
+    temp_ptr = A0;
+    A0 = Anext;
+    Anext = temp_ptr;
+  }
+}
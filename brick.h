@@ -0,0 +1,67 @@
+#ifndef _BRICK_H_
+#define _BRICK_H_
+
+#include "common.h"
+
+/*
+  Bricked grids.  The nx*ny*nz grid (ghost cells included) is cut into
+  BRICK_DIM^3 bricks, each stored contiguously in [k][j][i] order, and the
+  bricks themselves are laid out along a space-filling curve:
+
+    BRICK_LEX      brick (bx, by, bz) in lexicographic order
+    BRICK_MORTON   Z-order: the bits of bz, by, bx interleaved
+    BRICK_HILBERT  3D Hilbert curve; consecutive bricks share a face
+
+  The k+-1 neighbor of a cell is BRICK_DIM^2 doubles away instead of
+  nx*ny, and a brick's face neighbors are near it along the curve, so the
+  footprint of a sweep no longer depends on the grid's row and plane
+  strides.  The brick counts are rounded up, the padding is never updated.
+*/
+
+#define BRICK_LEX     0
+#define BRICK_MORTON  1
+#define BRICK_HILBERT 2
+
+/* brick edge in cells; 8 makes a brick 4 KB, one page */
+#ifndef BRICK_DIM
+#define BRICK_DIM 8
+#endif
+#define BRICK_CELLS (BRICK_DIM*BRICK_DIM*BRICK_DIM)
+
+typedef struct {
+  double *data;
+  int nx, ny, nz;
+  int nbx, nby, nbz;	/* bricks per dimension */
+  int order;
+  int *slot;		/* lexicographic brick number -> storage position */
+  int *brick;		/* storage position -> lexicographic brick number */
+} brick_grid;
+
+/* allocates the bricks and the curve tables; order is one of BRICK_* */
+void BrickAlloc(brick_grid *g, int order, int nx, int ny, int nz);
+void BrickFree(brick_grid *g);
+
+/* bytes of brick storage, including the padding of partial bricks */
+long brick_bytes(const brick_grid *g);
+
+/* name of a BRICK_* order */
+const char *brick_order_name(int order);
+
+/* copies from / to an nx*ny*nz Index3D grid, one brick row at a time */
+void BrickFromLinear(brick_grid *g, const double *A);
+void BrickToLinear(const brick_grid *g, double *A);
+
+/*
+  The 7-point update of probe_heat.c on bricked grids.  The naive kernel
+  visits the bricks in storage (curve) order; the blocked one visits
+  columns of tx x ty cells, rounded up to whole bricks, sweeping z inside
+  each column as StencilProbe_rivera does.  The grids are swapped after
+  every step, so the result is in A0 for an even number of timesteps and
+  in Anext otherwise.
+ */
+void StencilProbe_brick_naive(brick_grid *A0, brick_grid *Anext, int tx, int ty, int tz,
+			      int timesteps);
+void StencilProbe_brick_blocked(brick_grid *A0, brick_grid *Anext, int tx, int ty, int tz,
+				int timesteps);
+
+#endif
@@ -0,0 +1,46 @@
+/*  Circular queue stencil code
+ *  Kaushik Datta (kdatta@cs.berkeley.edu)
+ *  University of California Berkeley
+ *
+ *  Queue plane storage shared by the circular queue kernels.
+ */
+
+#include "circqueue.h"
+#include "scratch.h"
+
+double *queuePlanes, *queuePlane0, *queuePlane1, *queuePlane2;
+int *queuePlanesIndices;
+
+/* the queues live in the scratch arena of the thread that created them;
+   each call releases the previous trial's queues before taking new ones */
+static arena *queueArena = NULL;
+static size_t queueMark;
+
+/* This method creates the circular queues that will be needed for the
+   circular_queue() method.  It is only called when more than one iteration
+   is being performed. */
+void CircularQueueInit(int nx, int ty, int timesteps) {
+  int numPointsInQueuePlane, t;
+  
+  if (queueArena != NULL) {
+    arena_release(queueArena, queueMark);
+  }
+  queueArena = scratch_arena();
+  queueMark = arena_mark(queueArena);
+
+  queuePlanesIndices = (int *) arena_alloc(queueArena, (timesteps-1) * sizeof(int));
+  
+  int queuePlanesIndexPtr = 0;
+  
+  for (t=1; t < timesteps; t++) {
+    queuePlanesIndices[t-1] = queuePlanesIndexPtr;
+    numPointsInQueuePlane = (ty+2*(timesteps-t)) * nx;
+    queuePlanesIndexPtr += numPointsInQueuePlane;
+  }
+
+  queuePlanes = (double *) arena_alloc(queueArena, 3 * queuePlanesIndexPtr * sizeof(double));
+  
+  queuePlane0 = queuePlanes;
+  queuePlane1 = &queuePlanes[queuePlanesIndexPtr];
+  queuePlane2 = &queuePlanes[2 * queuePlanesIndexPtr];
+}
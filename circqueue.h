@@ -0,0 +1,16 @@
+#ifndef _CIRCQUEUE_H_
+#define _CIRCQUEUE_H_
+
+/*
+  Queue planes for the circular queue kernels.  Each of the timesteps-1
+  intermediate queues has three revolving planes; queuePlanesIndices[t-1]
+  is the offset of the queue for timestep t within each plane array.
+*/
+extern double *queuePlanes, *queuePlane0, *queuePlane1, *queuePlane2;
+extern int *queuePlanesIndices;
+
+/* Allocates the queues for a run from the scratch arenas (see scratch.h),
+   replacing those of the previous call; only needed when timesteps > 1. */
+void CircularQueueInit(int nx, int ty, int timesteps);
+
+#endif
@@ -0,0 +1,95 @@
+/*
+	Stencil Probe coefficient grids
+	Storage and initialization for the variable-coefficient kernels.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "coef.h"
+#include "util.h"
+
+coef_set stencil_coefs;
+
+int coef_bytes(const coef_set *cs) {
+  switch (cs->precision) {
+  case COEF_FLOAT:   return sizeof(float);
+  case COEF_FIXED16: return sizeof(uint16_t);
+  default:           return sizeof(double);
+  }
+}
+
+void CoefInit(int nx, int ny, int nz) {
+  int ncoef, precision;
+
+  ncoef = probe_param("COEFS", 4);
+  if (ncoef < 1) ncoef = 1;
+  if (ncoef > COEF_MAX) ncoef = COEF_MAX;
+  switch (probe_param("COEF_BYTES", 8)) {
+  case 4:  precision = COEF_FLOAT; break;
+  case 2:  precision = COEF_FIXED16; break;
+  default: precision = COEF_DOUBLE; break;
+  }
+  CoefAlloc(nx, ny, nz, ncoef, precision);
+}
+
+void CoefAlloc(int nx, int ny, int nz, int ncoef, int precision) {
+  coef_set *cs = &stencil_coefs;
+  long last = (long) nx * ny * nz;
+  long p;
+  int g, i, j, k, bytes;
+  double lo, hi, v;
+
+  // a re-alloc (next trial or grid size) replaces the previous grids
+  CoefFree();
+  cs->ncoef = ncoef;
+  cs->precision = precision;
+  bytes = coef_bytes(cs);
+
+  for (g = 0; g < cs->ncoef; g++) {
+    cs->c[g].data = malloc(bytes * last);
+    if (cs->c[g].data == NULL) {
+      printf("Error on coefficient grid malloc.\n");
+      exit(EXIT_FAILURE);
+    }
+
+    // the A coefficient of ncoef 2 and 4 stays near 1; diffusion
+    // coefficients stay below the explicit stability limit of 1/6
+    if (g == 0 && (cs->ncoef == 2 || cs->ncoef == 4)) {
+      lo = 0.5;  hi = 1.0;
+    }
+    else {
+      lo = 0.0;  hi = 1.0 / 12.0;
+    }
+    cs->c[g].offset = lo;
+    cs->c[g].scale = (hi - lo) / 65535.0;
+
+    for (k = 0; k < nz; k++) {
+      for (j = 0; j < ny; j++) {
+	for (i = 0; i < nx; i++) {
+	  p = Index3D (nx, ny, i, j, k);
+	  v = lo + (hi - lo) * ((i*7 + j*13 + k*29 + g*17) % 61) / 60.0;
+	  switch (cs->precision) {
+	  case COEF_FLOAT:
+	    ((float *) cs->c[g].data)[p] = v;
+	    break;
+	  case COEF_FIXED16:
+	    ((uint16_t *) cs->c[g].data)[p] = (uint16_t) ((v - lo) / cs->c[g].scale + 0.5);
+	    break;
+	  default:
+	    ((double *) cs->c[g].data)[p] = v;
+	    break;
+	  }
+	}
+      }
+    }
+  }
+}
+
+void CoefFree() {
+  int g;
+
+  for (g = 0; g < stencil_coefs.ncoef; g++) {
+    free(stencil_coefs.c[g].data);
+    stencil_coefs.c[g].data = NULL;
+  }
+  stencil_coefs.ncoef = 0;
+}
@@ -0,0 +1,129 @@
+#ifndef _COEF_H_
+#define _COEF_H_
+
+#include <stdint.h>
+#include "common.h"
+
+/*
+  Per-cell coefficient grids for the variable-coefficient kernels
+  (probe_heat_varcoef*.c).  With c0..c3 the coefficient grids and
+  Lx = A[i+1] - 2A[i] + A[i-1] (likewise Ly, Lz), the update is
+
+    ncoef 1:  Anext = A        + c0 (Lx + Ly + Lz)
+    ncoef 2:  Anext = c0 A     + c1 (Lx + Ly + Lz)
+    ncoef 3:  Anext = A        + c0 Lx + c1 Ly + c2 Lz
+    ncoef 4:  Anext = c0 A     + c1 Lx + c2 Ly + c3 Lz
+
+  Coefficients can be stored as doubles, floats, or 16-bit fixed point
+  (value = offset + scale * q), which changes the bytes streamed per
+  point update from 8 to 2 per coefficient grid.
+*/
+
+#define COEF_MAX 4
+
+#define COEF_DOUBLE  0
+#define COEF_FLOAT   1
+#define COEF_FIXED16 2
+
+typedef struct {
+  void *data;
+  double offset, scale;	/* COEF_FIXED16 only */
+} coef_grid;
+
+typedef struct {
+  int ncoef;		/* 1..COEF_MAX */
+  int precision;	/* COEF_DOUBLE, COEF_FLOAT or COEF_FIXED16 */
+  coef_grid c[COEF_MAX];
+} coef_set;
+
+/* the coefficients used by the variable-coefficient kernels */
+extern coef_set stencil_coefs;
+
+/*
+  Allocates and fills stencil_coefs for an nx*ny*nz grid.  The number of
+  grids and the storage come from STENCILPROBE_COEFS (1..4, default 4) and
+  STENCILPROBE_COEF_BYTES (8, 4 or 2, default 8).
+ */
+void CoefInit(int nx, int ny, int nz);
+
+/* the same with explicit settings; ncoef 1..COEF_MAX, precision COEF_*.
+   Frees the grids of an earlier call first. */
+void CoefAlloc(int nx, int ny, int nz, int ncoef, int precision);
+
+void CoefFree();
+
+/* bytes per coefficient value */
+int coef_bytes(const coef_set *cs);
+
+static inline double coef_load(const coef_grid *g, int precision, long p) {
+  switch (precision) {
+  case COEF_FLOAT:   return ((const float *) g->data)[p];
+  case COEF_FIXED16: return g->offset + g->scale * ((const uint16_t *) g->data)[p];
+  default:           return ((const double *) g->data)[p];
+  }
+}
+
+/* one row for a fixed ncoef/precision; the callers below pass constants */
+static inline void varcoef_row_impl(double *out, const double *below,
+				    const double *center, const double *above,
+				    int sy, const coef_set *cs, long p0, int n,
+				    const int ncoef, const int precision) {
+  double a, bx, by, bz, c;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    long p = p0 + i;
+
+    a = 1.0;
+    switch (ncoef) {
+    case 1:
+      bx = by = bz = coef_load(&cs->c[0], precision, p);
+      break;
+    case 2:
+      a = coef_load(&cs->c[0], precision, p);
+      bx = by = bz = coef_load(&cs->c[1], precision, p);
+      break;
+    case 3:
+      bx = coef_load(&cs->c[0], precision, p);
+      by = coef_load(&cs->c[1], precision, p);
+      bz = coef_load(&cs->c[2], precision, p);
+      break;
+    default:
+      a = coef_load(&cs->c[0], precision, p);
+      bx = coef_load(&cs->c[1], precision, p);
+      by = coef_load(&cs->c[2], precision, p);
+      bz = coef_load(&cs->c[3], precision, p);
+      break;
+    }
+
+    c = center[i];
+    out[i] = a * c
+      + bx * (center[i+1] - 2.0*c + center[i-1])
+      + by * (center[i+sy] - 2.0*c + center[i-sy])
+      + bz * (above[i] - 2.0*c + below[i]);
+  }
+}
+
+#define VARCOEF_CASE(_n,_p)						\
+  case (_n)*4 + (_p):							\
+    varcoef_row_impl(out, below, center, above, sy, cs, p0, n, (_n), (_p)); \
+    break;
+
+/*
+  Updates n points of a row.  below/center/above point at the first point
+  of the row in planes k-1, k and k+1, sy is the row stride within a plane
+  and p0 is the linear grid index of the first point (used to index the
+  coefficient grids).
+*/
+static inline void varcoef_row(double *out, const double *below,
+			       const double *center, const double *above,
+			       int sy, const coef_set *cs, long p0, int n) {
+  switch (cs->ncoef*4 + cs->precision) {
+    VARCOEF_CASE(1, COEF_DOUBLE) VARCOEF_CASE(1, COEF_FLOAT) VARCOEF_CASE(1, COEF_FIXED16)
+    VARCOEF_CASE(2, COEF_DOUBLE) VARCOEF_CASE(2, COEF_FLOAT) VARCOEF_CASE(2, COEF_FIXED16)
+    VARCOEF_CASE(3, COEF_DOUBLE) VARCOEF_CASE(3, COEF_FLOAT) VARCOEF_CASE(3, COEF_FIXED16)
+    VARCOEF_CASE(4, COEF_DOUBLE) VARCOEF_CASE(4, COEF_FLOAT) VARCOEF_CASE(4, COEF_FIXED16)
+  }
+}
+
+#endif
@@ -2,4 +2,8 @@
 #define _COMMON_H_
 #define Index3D(_nx,_ny,_i,_j,_k) ((_i)+_nx*((_j)+_ny*(_k)))
 
+/* signature shared by all of the StencilProbe kernels */
+typedef void (*stencil_fn)(double* A0, double* Anext, int nx, int ny, int nz,
+			   int tx, int ty, int tz, int timesteps);
+
 #endif
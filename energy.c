@@ -0,0 +1,248 @@
+/*
+	Stencil Probe energy
+	RAPL energy from powercap and APERF/MPERF core frequency.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "energy.h"
+
+#define MSR_MPERF 0xe7
+#define MSR_APERF 0xe8
+
+#define FREQ_NONE 0
+#define FREQ_MSR  1
+#define FREQ_PERF 2
+
+static const char *freq_names[] = { "none", "msr", "perf" };
+
+/* energy_uj files of the package zones and their dram subzones (NULL if none) */
+static char *pkg_path[ENERGY_MAX_ZONES], *dram_path[ENERGY_MAX_ZONES];
+static double pkg_range[ENERGY_MAX_ZONES], dram_range[ENERGY_MAX_ZONES];
+static int zones, drams, inited;
+
+static int freq_source, ncpus;
+/* per cpu: msr file, or the cycles and ref-cycles events */
+static int fd_a[ENERGY_MAX_CPUS], fd_m[ENERGY_MAX_CPUS];
+static double tsc;
+
+/* reads a number from a sysfs file; -1 if it cannot */
+static double read_number(const char *path) {
+  FILE *f = fopen(path, "r");
+  double v = -1;
+
+  if (f == NULL)
+    return -1;
+  if (fscanf(f, "%lf", &v) != 1)
+    v = -1;
+  fclose(f);
+  return v;
+}
+
+static int read_name(const char *dir, char *name, int len) {
+  char path[640];
+  FILE *f;
+
+  snprintf(path, sizeof(path), "%s/name", dir);
+  if ((f = fopen(path, "r")) == NULL)
+    return 0;
+  if (fgets(name, len, f) == NULL)
+    name[0] = '\0';
+  name[strcspn(name, "\n")] = '\0';
+  fclose(f);
+  return 1;
+}
+
+/* the zone's energy_uj if it is readable, with its wraparound range */
+static char *zone(const char *dir, double *range) {
+  char path[640];
+
+  snprintf(path, sizeof(path), "%s/max_energy_range_uj", dir);
+  *range = read_number(path);
+  snprintf(path, sizeof(path), "%s/energy_uj", dir);
+  return read_number(path) < 0 ? NULL : strdup(path);
+}
+
+static void find_rapl() {
+  const char *root = getenv("STENCILPROBE_POWERCAP");
+  char dir[512], sub[600], name[64];
+  int p, s;
+
+  if (root == NULL)
+    root = "/sys/class/powercap";
+  for (p = 0; p < ENERGY_MAX_ZONES; p++) {
+    snprintf(dir, sizeof(dir), "%s/intel-rapl:%d", root, p);
+    if (!read_name(dir, name, sizeof(name)))
+      break;
+    if (strncmp(name, "package", 7) != 0 || (pkg_path[zones] = zone(dir, &pkg_range[zones])) == NULL)
+      continue;
+    for (s = 0; s < ENERGY_MAX_ZONES; s++) {
+      snprintf(sub, sizeof(sub), "%s/intel-rapl:%d:%d", dir, p, s);
+      if (!read_name(sub, name, sizeof(name)))
+	break;
+      if (strcmp(name, "dram") == 0 && (dram_path[zones] = zone(sub, &dram_range[zones])) != NULL) {
+	drams++;
+	break;
+      }
+    }
+    zones++;
+  }
+}
+
+static int perf_open(int cpu, unsigned long long config) {
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  return (int) syscall(SYS_perf_event_open, &attr, -1, cpu, -1, 0);
+}
+
+static void close_cpus(int n) {
+  int c;
+
+  for (c = 0; c < n; c++) {
+    close(fd_a[c]);
+    if (fd_m[c] != fd_a[c])
+      close(fd_m[c]);
+  }
+}
+
+/* every cpu must have a source, or the sums mean nothing */
+static void find_freq() {
+  unsigned long long v;
+  char path[64];
+  int c, fd;
+
+  ncpus = (int) sysconf(_SC_NPROCESSORS_CONF);
+  if (ncpus > ENERGY_MAX_CPUS)
+    ncpus = ENERGY_MAX_CPUS;
+
+  for (c = 0; c < ncpus; c++) {
+    snprintf(path, sizeof(path), "/dev/cpu/%d/msr", c);
+    fd = open(path, O_RDONLY);
+    if (fd >= 0 && pread(fd, &v, sizeof(v), MSR_APERF) == sizeof(v) && v != 0) {
+      fd_a[c] = fd_m[c] = fd;
+      continue;
+    }
+    if (fd >= 0)
+      close(fd);
+    close_cpus(c);
+    break;
+  }
+  if (c == ncpus) {
+    freq_source = FREQ_MSR;
+    return;
+  }
+
+  for (c = 0; c < ncpus; c++) {
+    fd_a[c] = perf_open(c, PERF_COUNT_HW_CPU_CYCLES);
+    fd_m[c] = fd_a[c] < 0 ? -1 : perf_open(c, PERF_COUNT_HW_REF_CPU_CYCLES);
+    if (fd_m[c] < 0) {
+      if (fd_a[c] >= 0)
+	close(fd_a[c]);
+      close_cpus(c);
+      break;
+    }
+  }
+  if (c == ncpus)
+    freq_source = FREQ_PERF;
+}
+
+void EnergyInit(double tsc_hz) {
+  tsc = tsc_hz;
+  if (inited)
+    return;
+  inited = 1;
+  find_rapl();
+  find_freq();
+  if (zones > 0)
+    printf("energy: RAPL, %d package%s%s\n", zones, zones > 1 ? "s" : "", drams > 0 ? " + dram" : "");
+  else
+    printf("energy: no RAPL counters (no readable powercap package zone), energy not reported\n");
+  printf("frequency: %s\n", freq_source == FREQ_NONE ?
+	 "no APERF/MPERF (no msr or perf access), not reported" : freq_names[freq_source]);
+}
+
+int energy_rapl() {
+  return zones > 0;
+}
+
+int energy_freq() {
+  return freq_source != FREQ_NONE;
+}
+
+void EnergyMark(energy_mark *m) {
+  unsigned long long a, b;
+  int z, c;
+
+  memset(m, 0, sizeof(*m));
+  for (z = 0; z < zones; z++) {
+    m->pkg_uj[z] = read_number(pkg_path[z]);
+    if (dram_path[z] != NULL)
+      m->dram_uj[z] = read_number(dram_path[z]);
+  }
+  for (c = 0; freq_source != FREQ_NONE && c < ncpus; c++) {
+    a = b = 0;
+    if (freq_source == FREQ_MSR) {
+      if (pread(fd_a[c], &a, sizeof(a), MSR_APERF) != sizeof(a) ||
+	  pread(fd_m[c], &b, sizeof(b), MSR_MPERF) != sizeof(b))
+	a = b = 0;
+    }
+    else if (read(fd_a[c], &a, sizeof(a)) != sizeof(a) || read(fd_m[c], &b, sizeof(b)) != sizeof(b))
+      a = b = 0;
+    m->aperf += a;
+    m->mperf += b;
+  }
+}
+
+/* a counter's increase, allowing for one wrap at range */
+static double delta(double from, double to, double range) {
+  if (from < 0 || to < 0)
+    return 0;
+  return to >= from ? to - from : range > 0 ? to + range - from : 0;
+}
+
+void EnergySince(const energy_mark *start, double seconds, energy_sample *s) {
+  energy_mark now;
+  int z;
+
+  EnergyMark(&now);
+  memset(s, 0, sizeof(*s));
+  s->seconds = seconds;
+  s->rapl = zones > 0;
+  s->dram = drams > 0;
+  for (z = 0; z < zones; z++) {
+    s->joules += 1e-6 * delta(start->pkg_uj[z], now.pkg_uj[z], pkg_range[z]);
+    if (dram_path[z] != NULL)
+      s->dram_joules += 1e-6 * delta(start->dram_uj[z], now.dram_uj[z], dram_range[z]);
+  }
+  if (freq_source != FREQ_NONE && now.mperf != start->mperf) {
+    s->freq = 1;
+    s->ghz = 1e-9 * tsc * (double) (now.aperf - start->aperf) / (double) (now.mperf - start->mperf);
+  }
+}
+
+void EnergyReport(const energy_sample *s, double updates) {
+  char e[160] = "n/a", f[32] = "n/a";
+
+  // EnergyInit has said that neither is measured
+  if (!s->rapl && !s->freq)
+    return;
+  if (s->rapl && s->seconds > 0 && updates > 0)
+    snprintf(e, sizeof(e), "%.4g J%s, %.1f W, %.3g nJ/update, %.3g GFlop/s/W",
+	     s->joules + s->dram_joules, s->dram ? " (with dram)" : "",
+	     (s->joules + s->dram_joules) / s->seconds, 1e9 * (s->joules + s->dram_joules) / updates,
+	     s->joules + s->dram_joules > 0 ?
+	     1e-9 * ENERGY_FLOPS_PER_UPDATE * updates / (s->joules + s->dram_joules) : 0.0);
+  if (s->freq)
+    snprintf(f, sizeof(f), "%.2f GHz", s->ghz);
+  printf("energy: %s, core clock: %s\n", e, f);
+}
@@ -0,0 +1,59 @@
+#ifndef _ENERGY_H_
+#define _ENERGY_H_
+
+/*
+  Energy and frequency around a run.  Energy comes from the RAPL counters
+  the powercap driver exposes (intel-rapl, which AMD parts use too):
+  every package zone under STENCILPROBE_POWERCAP (default
+  /sys/class/powercap) plus its dram subzone when there is one, with the
+  counters' wraparound at max_energy_range_uj undone.  The counters cover
+  the whole socket, so anything else running is charged to the kernel.
+
+  The core frequency is APERF/MPERF summed over every cpu: APERF counts
+  at the actual clock and MPERF at the TSC rate, both only while the cpu
+  is not halted, so their ratio times the TSC rate is the mean clock of
+  the busy cpus.  The counters are read from /dev/cpu/N/msr (root and the
+  msr module) or, failing that, as perf cycles and ref-cycles per cpu.
+
+  Either source may be missing (no powercap in a VM, no msr access);
+  EnergyInit says which are used and the samples mark what is unknown,
+  so the reports print "n/a" instead of failing (EnergyReport prints
+  nothing when both are missing).
+*/
+
+/* floating-point operations per 7-point update: 6 adds or subtracts, 1 multiply, 1 divide */
+#define ENERGY_FLOPS_PER_UPDATE 8
+
+#define ENERGY_MAX_ZONES 16
+#define ENERGY_MAX_CPUS 1024
+
+typedef struct {
+  double pkg_uj[ENERGY_MAX_ZONES], dram_uj[ENERGY_MAX_ZONES];
+  unsigned long long aperf, mperf;	/* summed over the cpus */
+} energy_mark;
+
+typedef struct {
+  int rapl, dram, freq;		/* which fields are known */
+  double seconds;
+  double joules;		/* packages */
+  double dram_joules;
+  double ghz;			/* mean busy clock */
+} energy_sample;
+
+/* finds the sources; prints them once.  tsc_hz scales the frequency (1/spt). */
+void EnergyInit(double tsc_hz);
+
+/* whether RAPL or a frequency source was found */
+int energy_rapl();
+int energy_freq();
+
+/* reads every counter into m */
+void EnergyMark(energy_mark *m);
+
+/* s = the counters from start to now, over seconds of wall time */
+void EnergySince(const energy_mark *start, double seconds, energy_sample *s);
+
+/* one line: joules, watts, nJ per update, GFlop/s per watt and GHz for updates point updates */
+void EnergyReport(const energy_sample *s, double updates);
+
+#endif
@@ -0,0 +1,29 @@
+#!/bin/bash
+# finds best prefetch distance/hint for a kernel on a 512^3 problem
+# usage: ./find_best_prefetch.sh <make target> <kernel name, e.g. BLOCKED> [block x y z]
+
+target=${1:-blocked_probe}
+kernel=${2:-BLOCKED}
+block=${3:-"512 16 16"}
+
+make $target
+
+for hint in 0 1 2 3
+do
+	for dist in 0 1 2 4 8 16
+	do
+		STENCILPROBE_${kernel}_PF_DIST=$dist STENCILPROBE_${kernel}_PF_HINT=$hint \
+			./probe 512 512 512 $block 1 > out-pf-$dist\-$hint\.out
+		echo "done with dist $dist hint $hint"
+	done
+done
+
+for hint in 0 1 2 3
+do
+	for dist in 0 1 2 4 8 16
+	do
+		echo -n dist $dist hint $hint, 
+		cat out-pf-$dist\-$hint\.out | grep elapsed | awk '{print $4}' | sed 's/time://' | perl min.pl
+		echo
+	done
+done
@@ -0,0 +1,44 @@
+#!/bin/bash
+# builds every kernel under every compiler and flag set as a shared object
+# for main.flagsweep.c, and lists them in <dir>/manifest
+#
+#   SWEEP_CC       compilers to try; missing ones are skipped
+#   SWEEP_FLAGS    flag sets, separated by ';'
+#   SWEEP_KERNELS  kernel sources (probe_heat.c is "naive")
+
+dir=${1:-sweep}
+ccs=${SWEEP_CC:-gcc clang icx}
+kernels=${SWEEP_KERNELS:-probe_heat.c probe_heat_blocked.c}
+IFS=';' read -ra sets <<< "${SWEEP_FLAGS:--O3;-O3 -march=native}"
+
+mkdir -p $dir
+: > $dir/manifest
+for cc in $ccs
+do
+	if ! command -v $cc > /dev/null
+	then
+		echo "skipping $cc: not found"
+		continue
+	fi
+	for k in $kernels
+	do
+		name=${k%.c}
+		name=${name#probe_heat}
+		name=${name#_}
+		[ -z "$name" ] && name=naive
+		for i in "${!sets[@]}"
+		do
+			so=$dir/$name.$cc.$i.so
+			# the kernels' helpers (prefetch, trace, scratch, queues) resolve
+			# against the driver; the pool, boundary and active-tile code are built with the kernel
+			if $cc ${sets[$i]} -fPIC -shared -DRANDOMVALUES $k pool.c boundary.c active.c -o $so 2> $so.log
+			then
+				printf '%s\t%s\t%s\t%s\n' "$name" "$cc" "${sets[$i]}" "$so" >> $dir/manifest
+				rm -f $so.log
+			else
+				echo "$cc ${sets[$i]} $k failed, see $so.log"
+			fi
+		done
+	done
+done
+echo "$(wc -l < $dir/manifest) shared objects in $dir"
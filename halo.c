@@ -0,0 +1,204 @@
+/*
+	Stencil Probe halo exchange
+	Face packing and unpacking with strided gathers for the x faces and
+	zero-copy z faces.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#include "halo.h"
+#include "arena.h"
+
+void HaloInit(halo_plan *h, int nx, int ny, int nz, int w) {
+  long total = 0, off = 0;
+  void *p = NULL;
+  int f;
+
+  if (w < 1 || 2 * w >= nx - w || 2 * w >= ny - w || 2 * w >= nz - w) {
+    printf("Error: a %d cell halo does not fit a %dx%dx%d grid.\n", w, nx, ny, nz);
+    exit(EXIT_FAILURE);
+  }
+  h->nx = nx;
+  h->ny = ny;
+  h->nz = nz;
+  h->w = w;
+  for (f = 0; f < HALO_FACES; f++) {
+    halo_face *face = &h->face[f];
+
+    if (f == HALO_XLO || f == HALO_XHI)
+      face->count = (long) w * (ny - 2 * w) * (nz - 2 * w);
+    else if (f == HALO_YLO || f == HALO_YHI)
+      face->count = (long) w * (nx - 2 * w) * (nz - 2 * w);
+    else
+      face->count = (long) w * nx * ny;
+    face->zero_copy = f == HALO_ZLO || f == HALO_ZHI;
+    face->send = face->recv = NULL;
+    if (!face->zero_copy)
+      total += 2 * face->count;
+  }
+
+  if (posix_memalign(&p, ARENA_ALIGN, total * sizeof(double)) != 0) {
+    printf("Error on halo buffer malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  h->pool = (double *) p;
+  memset(h->pool, 0, total * sizeof(double));
+  for (f = 0; f < HALO_FACES; f++) {
+    if (h->face[f].zero_copy)
+      continue;
+    h->face[f].send = &h->pool[off];
+    h->face[f].recv = &h->pool[off + h->face[f].count];
+    off += 2 * h->face[f].count;
+  }
+}
+
+void HaloFree(halo_plan *h) {
+  free(h->pool);
+  h->pool = NULL;
+}
+
+const char *halo_face_name(int f) {
+  static const char *names[HALO_FACES] = { "x-", "x+", "y-", "y+", "z-", "z+" };
+
+  return f >= 0 && f < HALO_FACES ? names[f] : "?";
+}
+
+const char *halo_gather_desc() {
+#if defined(__AVX512F__)
+  return "avx512 gather/scatter";
+#elif defined(__AVX2__)
+  return "avx2 gather, scalar scatter";
+#else
+  return "scalar";
+#endif
+}
+
+/* dst[j] = src[j*stride] for j < n */
+static void gather_col(const double *src, int stride, double *dst, int n) {
+  int j = 0;
+#if defined(__AVX512F__)
+  __m256i vi = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+				  _mm256_set1_epi32(stride));
+
+  for (; j + 8 <= n; j += 8)
+    _mm512_storeu_pd(&dst[j], _mm512_i32gather_pd(vi, &src[(long) j * stride], 8));
+#elif defined(__AVX2__)
+  __m128i vi = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(stride));
+
+  for (; j + 4 <= n; j += 4)
+    _mm256_storeu_pd(&dst[j], _mm256_i32gather_pd(&src[(long) j * stride], vi, 8));
+#endif
+  for (; j < n; j++)
+    dst[j] = src[(long) j * stride];
+}
+
+/* dst[j*stride] = src[j] for j < n */
+static void scatter_col(double *dst, int stride, const double *src, int n) {
+  int j = 0;
+#if defined(__AVX512F__)
+  __m256i vi = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+				  _mm256_set1_epi32(stride));
+
+  for (; j + 8 <= n; j += 8)
+    _mm512_i32scatter_pd(&dst[(long) j * stride], vi, _mm512_loadu_pd(&src[j]), 8);
+#endif
+  for (; j < n; j++)
+    dst[(long) j * stride] = src[j];
+}
+
+/*
+  First cell of the owned layers next to face f (send) or of its ghost
+  layers (recv), along the face normal.
+*/
+static int send_layer(const halo_plan *h, int f) {
+  int n = f < HALO_YLO ? h->nx : f < HALO_ZLO ? h->ny : h->nz;
+
+  return f % 2 == 0 ? h->w : n - 2 * h->w;
+}
+
+static int ghost_layer(const halo_plan *h, int f) {
+  int n = f < HALO_YLO ? h->nx : f < HALO_ZLO ? h->ny : h->nz;
+
+  return f % 2 == 0 ? 0 : n - h->w;
+}
+
+/*
+  Copies between face f of A, starting at layer l0 along its normal, and
+  the packed buffer buf:  x faces are [k][layer][j], y faces [k][layer][i].
+*/
+static void face_copy(const halo_plan *h, double *A, int f, int l0, double *buf, int pack) {
+  int nx = h->nx, ny = h->ny, nz = h->nz, w = h->w;
+  int k, l;
+
+  if (f == HALO_XLO || f == HALO_XHI) {
+    for (k = w; k < nz - w; k++)
+      for (l = 0; l < w; l++) {
+	double *col = &A[Index3D (nx, ny, l0 + l, w, k)];
+
+	if (pack)
+	  gather_col(col, nx, buf, ny - 2 * w);
+	else
+	  scatter_col(col, nx, buf, ny - 2 * w);
+	buf += ny - 2 * w;
+      }
+  }
+  else {
+    for (k = w; k < nz - w; k++)
+      for (l = 0; l < w; l++) {
+	double *row = &A[Index3D (nx, ny, w, l0 + l, k)];
+
+	if (pack)
+	  memcpy(buf, row, (nx - 2 * w) * sizeof(double));
+	else
+	  memcpy(row, buf, (nx - 2 * w) * sizeof(double));
+	buf += nx - 2 * w;
+      }
+  }
+}
+
+void HaloPackFace(halo_plan *h, double *A, int f) {
+  halo_face *face = &h->face[f];
+
+  if (face->zero_copy) {
+    face->send = &A[Index3D (h->nx, h->ny, 0, 0, send_layer(h, f))];
+    face->recv = &A[Index3D (h->nx, h->ny, 0, 0, ghost_layer(h, f))];
+    return;
+  }
+  face_copy(h, A, f, send_layer(h, f), face->send, 1);
+}
+
+void HaloUnpackFace(halo_plan *h, double *A, int f) {
+  halo_face *face = &h->face[f];
+
+  // the incoming planes were delivered straight into the ghost planes
+  if (face->zero_copy)
+    return;
+  face_copy(h, A, f, ghost_layer(h, f), face->recv, 0);
+}
+
+void HaloPack(halo_plan *h, double *A) {
+  int f;
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (f = 0; f < HALO_FACES; f++)
+    HaloPackFace(h, A, f);
+}
+
+void HaloUnpack(halo_plan *h, double *A) {
+  int f;
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (f = 0; f < HALO_FACES; f++)
+    HaloUnpackFace(h, A, f);
+}
+
+void HaloExchangeSelf(halo_plan *h) {
+  int f;
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (f = 0; f < HALO_FACES; f++)
+    memcpy(h->face[f ^ 1].recv, h->face[f].send, h->face[f].count * sizeof(double));
+}
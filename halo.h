@@ -0,0 +1,70 @@
+#ifndef _HALO_H_
+#define _HALO_H_
+
+#include "common.h"
+
+/*
+  Halo (ghost shell) pack and unpack for the six faces of an Index3D grid
+  with a ghost shell w cells deep, as a multi-process or multi-patch run
+  would exchange it.  Face regions are chosen so that no two faces write
+  the same ghost cell, which lets the faces run on different threads:
+
+    x faces   w columns,  j and k over the owned range
+    y faces   w rows,     i and k over the owned range
+    z faces   w planes,   all of i and j
+
+  A z face is w contiguous planes, so it is never copied: its send buffer
+  points at the owned planes and its receive buffer at the ghost planes
+  (zero-copy).  y faces are one memcpy per row.  x faces are strided
+  gathers; the AVX2 / AVX-512 gather (and AVX-512 scatter) path is used
+  when the compiler targets it, and a scalar loop otherwise.
+*/
+
+#define HALO_XLO 0
+#define HALO_XHI 1
+#define HALO_YLO 2
+#define HALO_YHI 3
+#define HALO_ZLO 4
+#define HALO_ZHI 5
+#define HALO_FACES 6
+
+typedef struct {
+  long count;		/* doubles in the face */
+  int zero_copy;	/* send / recv alias the grid */
+  double *send;		/* packed owned cells next to the face */
+  double *recv;		/* incoming values for the ghost cells */
+} halo_face;
+
+typedef struct {
+  int nx, ny, nz, w;
+  halo_face face[HALO_FACES];
+  double *pool;		/* the packed buffers of the copied faces */
+} halo_plan;
+
+/* sizes the faces of an nx*ny*nz grid with a ghost shell w deep */
+void HaloInit(halo_plan *h, int nx, int ny, int nz, int w);
+void HaloFree(halo_plan *h);
+
+/* name of a HALO_* face and of the compiled x-face gather path */
+const char *halo_face_name(int f);
+const char *halo_gather_desc();
+
+/*
+  Single-face pack / unpack.  For a zero-copy face HaloPackFace only
+  points send (and recv) at the grid A.
+ */
+void HaloPackFace(halo_plan *h, double *A, int f);
+void HaloUnpackFace(halo_plan *h, double *A, int f);
+
+/* all six faces, one face per OpenMP thread */
+void HaloPack(halo_plan *h, double *A);
+void HaloUnpack(halo_plan *h, double *A);
+
+/*
+  Stands in for the network: every face's send buffer is delivered to the
+  receive buffer of the opposite face, i.e. a periodic exchange with
+  itself.  Run between HaloPack and HaloUnpack.
+ */
+void HaloExchangeSelf(halo_plan *h);
+
+#endif
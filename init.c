@@ -0,0 +1,172 @@
+/*
+	Stencil Probe initial fields
+	Counter-based random fields and analytic fields, filled in parallel.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "common.h"
+#include "util.h"
+#include "init.h"
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+static const char *names[INIT_FIELDS] = { "random", "constant", "gaussian", "sine", "box" };
+
+const char *init_name(int kind) {
+  return kind >= 0 && kind < INIT_FIELDS ? names[kind] : "?";
+}
+
+int init_kind(const char *name) {
+  int k;
+
+  for (k = 0; k < INIT_FIELDS; k++)
+    if (strcmp(name, names[k]) == 0)
+      return k;
+  return -1;
+}
+
+void InitFromEnv(init_field *f, int dflt) {
+  const char *s = getenv("STENCILPROBE_INIT");
+  const char *seed = getenv("STENCILPROBE_SEED");
+  int p;
+
+  f->kind = dflt;
+  if (s != NULL && *s != '\0') {
+    f->kind = init_kind(s);
+    if (f->kind < 0) {
+      printf("Error: unknown STENCILPROBE_INIT %s.\n", s);
+      exit(EXIT_FAILURE);
+    }
+  }
+  // all 64 bits: the low word keys key[0] and the high word key[1]
+  f->seed = seed != NULL && *seed != '\0' ? strtoull(seed, NULL, 0) : 1;
+  f->value = probe_param("INIT_VALUE", 1);
+  f->width = probe_param("INIT_WIDTH", 10);
+  p = probe_param("INIT_MODE", 1);
+  f->mode[0] = f->mode[1] = f->mode[2] = p;
+}
+
+void philox4x32(const unsigned ctr[4], const unsigned key[2], unsigned out[4]) {
+  unsigned c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+  unsigned k0 = key[0], k1 = key[1];
+  unsigned long long p0, p1;
+  int r;
+
+  for (r = 0; r < PHILOX_ROUNDS; r++) {
+    p0 = (unsigned long long) PHILOX_M0 * c0;
+    p1 = (unsigned long long) PHILOX_M1 * c2;
+    c0 = (unsigned) (p1 >> 32) ^ c1 ^ k0;
+    c2 = (unsigned) (p0 >> 32) ^ c3 ^ k1;
+    c1 = (unsigned) p1;
+    c3 = (unsigned) p0;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+/* points n0..n1-1 of the random field */
+static void random_range(double *A, long n0, long n1, unsigned long long seed) {
+  unsigned ctr[4] = { 0, 0, 0, 0 }, key[2], out[4];
+  long n;
+
+  key[0] = (unsigned) seed;
+  key[1] = (unsigned) (seed >> 32);
+  for (n = n0; n < n1; n++) {
+    if (n == n0 || (n & 3) == 0) {
+      ctr[0] = (unsigned) (n >> 2);
+      ctr[1] = (unsigned) (n >> 34);
+      philox4x32(ctr, key, out);
+    }
+    A[n] = out[n & 3] * (1.0 / 4294967296.0);
+  }
+}
+
+void InitField(int nx, int ny, int nz, double *A, const init_field *f) {
+  double pi = acos(-1.0), s = 0, cx = (nx - 1) / 2.0, cy = (ny - 1) / 2.0, cz = (nz - 1) / 2.0;
+  long plane = (long) nx * ny;
+  int k;
+
+  if (f->kind == INIT_GAUSSIAN) {
+    int edge = nx < ny ? (nx < nz ? nx : nz) : (ny < nz ? ny : nz);
+    s = f->width / 100.0 * edge;
+    s = s > 0 ? 1 / (2 * s * s) : 0;
+  }
+  else if (f->kind == INIT_BOX)
+    s = f->width / 200.0;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (k = 0; k < nz; k++) {
+    double *p = A + k * plane, wz, wy;
+    int i, j;
+
+    switch (f->kind) {
+    case INIT_RANDOM:
+      random_range(A, k * plane, (k + 1) * plane, f->seed);
+      break;
+    case INIT_GAUSSIAN:
+      for (j = 0; j < ny; j++)
+	for (i = 0; i < nx; i++)
+	  p[i + (long) nx * j] = exp(-s * ((i - cx) * (i - cx) + (j - cy) * (j - cy) + (k - cz) * (k - cz)));
+      break;
+    case INIT_SINE:
+      wz = sin(pi * f->mode[2] * k / (nz - 1));
+      for (j = 0; j < ny; j++) {
+	wy = wz * sin(pi * f->mode[1] * j / (ny - 1));
+	for (i = 0; i < nx; i++)
+	  p[i + (long) nx * j] = wy * sin(pi * f->mode[0] * i / (nx - 1));
+      }
+      break;
+    case INIT_BOX:
+      for (j = 0; j < ny; j++)
+	for (i = 0; i < nx; i++)
+	  p[i + (long) nx * j] = fabs(i - cx) <= s * nx && fabs(j - cy) <= s * ny &&
+	    fabs(k - cz) <= s * nz ? 1.0 : 0.0;
+      break;
+    default:
+      for (i = 0; i < plane; i++)
+	p[i] = f->value;
+    }
+  }
+
+  // the kernels' scale factor; no stencil reads the corner
+  if (f->kind == INIT_GAUSSIAN || f->kind == INIT_SINE || f->kind == INIT_BOX)
+    A[0] = 1.0;
+}
+
+double init_sine_eigenvalue(int nx, int ny, int nz, const init_field *f) {
+  double pi = acos(-1.0);
+
+  return 2 * cos(pi * f->mode[0] / (nx - 1)) + 2 * cos(pi * f->mode[1] / (ny - 1))
+    + 2 * cos(pi * f->mode[2] / (nz - 1)) - 6;
+}
+
+double InitSineError(int nx, int ny, int nz, const double *A, const init_field *f,
+		     int timesteps) {
+  double pi = acos(-1.0), g = pow(init_sine_eigenvalue(nx, ny, nz, f), timesteps);
+  double exact, err = 0, big = 0;
+  int i, j, k;
+
+  for (k = 1; k < nz - 1; k++)
+    for (j = 1; j < ny - 1; j++)
+      for (i = 1; i < nx - 1; i++) {
+	exact = g * sin(pi * f->mode[0] * i / (nx - 1)) * sin(pi * f->mode[1] * j / (ny - 1))
+	  * sin(pi * f->mode[2] * k / (nz - 1));
+	if (fabs(exact) > big)
+	  big = fabs(exact);
+	if (fabs(A[Index3D (nx, ny, i, j, k)] - exact) > err)
+	  err = fabs(A[Index3D (nx, ny, i, j, k)] - exact);
+      }
+  return big > 0 ? err / big : err;
+}
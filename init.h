@@ -0,0 +1,78 @@
+#ifndef _INIT_H_
+#define _INIT_H_
+
+/*
+  Initial fields.  StencilInit fills a grid from the field named by
+  STENCILPROBE_INIT:
+
+    random    uniform in [0,1) from a counter-based generator (Philox4x32-10
+              keyed by the 64-bit STENCILPROBE_SEED, default 1, low word
+              first): point n takes word n%4
+              of the block for counter n/4, so the values depend only on
+              the seed and the index, never on the thread count or the
+              order the planes are filled in (the default with RANDOMVALUES)
+    constant  STENCILPROBE_INIT_VALUE everywhere (default 1, the default
+              without RANDOMVALUES)
+    gaussian  a unit pulse at the grid center with a standard deviation of
+              STENCILPROBE_INIT_WIDTH percent of the smallest edge (default 10)
+    sine      sin(pi p i/(nx-1)) sin(pi p j/(ny-1)) sin(pi p k/(nz-1)) with
+              p = STENCILPROBE_INIT_MODE (default 1), zero on the boundary
+    box       1 in a centered box spanning STENCILPROBE_INIT_WIDTH percent
+              of each edge, 0 elsewhere: a localized field whose quiet part
+              the operator keeps at 0 (see active.h)
+
+  Planes are filled in parallel under OpenMP, which also places them on
+  the node of the thread that will sweep them under a static schedule.
+
+  The kernels take their scale factor from A[0], a corner no stencil
+  reads; the gaussian, sine and box fields set it to 1, so a kernel
+  applies the plain 7-point Laplacian
+    Anext = A(i±1) + A(j±1) + A(k±1) - 6 A
+  to them.  Sine modes are its eigenvectors: after T steps the interior is
+  lambda^T times the initial field, with
+    lambda = 2 cos(pi p/(nx-1)) + 2 cos(pi p/(ny-1)) + 2 cos(pi p/(nz-1)) - 6,
+  which checks a kernel against a closed form instead of another kernel.
+  The highest mode (p = n-2) has the largest |lambda|, so rounding in the
+  other modes never outgrows it; low modes decay faster than rounding
+  noise and are only good for a step or two.
+*/
+
+#define INIT_RANDOM   0
+#define INIT_CONSTANT 1
+#define INIT_GAUSSIAN 2
+#define INIT_SINE     3
+#define INIT_BOX      4
+#define INIT_FIELDS   5
+
+typedef struct {
+  int kind;
+  unsigned long long seed;	/* random */
+  double value;			/* constant */
+  double width;			/* gaussian, percent of the smallest edge; box, of each edge */
+  int mode[3];			/* sine, per axis */
+} init_field;
+
+/* name of an INIT_* field, and its number from a name (-1 if unknown) */
+const char *init_name(int kind);
+int init_kind(const char *name);
+
+/* fills f from the environment, with kind dflt unless STENCILPROBE_INIT is set */
+void InitFromEnv(init_field *f, int dflt);
+
+/* fills A (nx*ny*nz) with the field f */
+void InitField(int nx, int ny, int nz, double *A, const init_field *f);
+
+/* Philox4x32-10: the block for counter ctr under key */
+void philox4x32(const unsigned ctr[4], const unsigned key[2], unsigned out[4]);
+
+/* the factor one kernel step multiplies sine field f by */
+double init_sine_eigenvalue(int nx, int ny, int nz, const init_field *f);
+
+/*
+  Largest interior difference between A and sine field f after timesteps
+  kernel steps, relative to the largest exact value.
+ */
+double InitSineError(int nx, int ny, int nz, const double *A, const init_field *f,
+		     int timesteps);
+
+#endif
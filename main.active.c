@@ -0,0 +1,124 @@
+/*
+	Stencil Probe
+	Active-tile execution: the blocked kernel on a localized field with
+	tile skipping off and on.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "common.h"
+#include "util.h"
+#include "init.h"
+#include "pool.h"
+#include "scratch.h"
+#include "active.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+/* run.h has the run parameters */
+#include "run.h"
+
+void StencilProbe_rivera(double* A0, double* Anext, int nx, int ny, int nz,
+			 int tx, int ty, int tz, int timesteps);
+
+static int nx, ny, nz, tx, ty, tz, timesteps;
+static double spt;
+static init_field field;
+
+/*
+  best time in seconds over NUM_TRIALS runs with skipping on or off; the
+  result is left in out and the tile counts of the last run in *computed
+  and *skipped
+*/
+static double run(int on, double *A0, double *Anext, double *out, long *computed, long *skipped) {
+  double best = -1;
+  ticks t1, t2;
+  int i;
+
+  ActiveSet(on);
+  for (i=0;i<NUM_TRIALS;i++) {
+    InitField(nx,ny,nz,Anext,&field);
+    InitField(nx,ny,nz,A0,&field);
+    ActiveReset();
+
+    t1 = getticks();
+    StencilProbe_rivera(A0, Anext, nx, ny, nz, tx, ty, tz, timesteps);
+    t2 = getticks();
+    if (best < 0 || spt * elapsed(t2, t1) < best)
+      best = spt * elapsed(t2, t1);
+  }
+  ActiveSet(-1);
+  ActiveTotals(computed, skipped);
+  memcpy(out, timesteps % 2 == 0 ? A0 : Anext, sizeof(double)*nx*ny*nz);
+  return best;
+}
+
+int main(int argc,char *argv[])
+{
+  double *Anext, *A0, *ref, *result, off, on, diff = 0, big = 0;
+  long points, i, computed, skipped;
+
+  /* parse command line options */
+  if (argc < 8) {
+    printf("\nUSAGE:\n%s <grid x> <grid y> <grid z> <block x> <block y> <block z> <timesteps>\n", argv[0]);
+    printf("\nRuns the blocked kernel with active tiles off and on, on the field\n");
+    printf("STENCILPROBE_INIT names (default box; STENCILPROBE_INIT_WIDTH sets its size).\n\n");
+    return EXIT_FAILURE;
+  }
+  nx = atoi(argv[1]);
+  ny = atoi(argv[2]);
+  nz = atoi(argv[3]);
+  tx = atoi(argv[4]);
+  ty = atoi(argv[5]);
+  tz = atoi(argv[6]);
+  timesteps = atoi(argv[7]);
+  InitFromEnv(&field, INIT_BOX);
+  printf("%dx%dx%d, blocking: %dx%dx%d, timesteps: %d, field: %s, sync: %s\n",
+	 nx,ny,nz,tx,ty,tz,timesteps,init_name(field.kind),sync_name(sync_mode()));
+
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+
+  points = (long) nx * ny * nz;
+  Anext = (double*) malloc(sizeof(double)*points);
+  A0 = (double*) malloc(sizeof(double)*points);
+  ref = (double*) malloc(sizeof(double)*points);
+  result = (double*) malloc(sizeof(double)*points);
+  if (A0 == NULL || Anext == NULL || ref == NULL || result == NULL) {
+    printf("Error on grid malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  ScratchInit(nx,ny,nz,tx,ty,timesteps);
+
+  off = run(0, A0, Anext, ref, &computed, &skipped);
+  on = run(1, A0, Anext, result, &computed, &skipped);
+  for (i = 0; i < points; i++) {
+    if (fabs(result[i] - ref[i]) > diff)
+      diff = fabs(result[i] - ref[i]);
+    if (fabs(ref[i]) > big)
+      big = fabs(ref[i]);
+  }
+  if (big > 0)
+    diff /= big;
+
+  printf("%-8s %-12s %-14s\n", "tiles", "time(s)", "Mupdates/s");
+  printf("%-8s %-12.4g %-14.1f\n", "all", off, (double) (nx-2) * (ny-2) * (nz-2) * timesteps / off * 1e-6);
+  printf("%-8s %-12.4g %-14.1f\n", "active", on, (double) (nx-2) * (ny-2) * (nz-2) * timesteps / on * 1e-6);
+  printf("skipped %ld of %ld tile updates (%.1f%%), speedup %.2fx, max diff %g\n",
+	 skipped, computed + skipped, computed + skipped > 0 ? 100.0 * skipped / (computed + skipped) : 0.0,
+	 off / on, diff);
+
+  free(Anext);
+  free(A0);
+  free(ref);
+  free(result);
+  return diff == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,95 @@
+/*
+	Stencil Probe
+	Main function for the nested-grid (AMR-style) probe.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "common.h"
+#include "util.h"
+#include "scratch.h"
+#include "amr.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+/* run.h has the run parameters */
+#include "run.h"
+
+void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
+                  int tx, int ty, int tz, int timesteps);
+
+int main(int argc,char *argv[])
+{
+  amr_level levels[AMR_MAX_LEVELS];
+  amr_stats stats;
+  int nx,ny,nz,nlevels,tx,ty,tz,timesteps;
+  int i,l;
+  
+  ticks t1, t2;
+  double spt, total;
+  
+  /* parse command line options */
+  if (argc < 9) {
+    printf("\nUSAGE:\n%s <grid x> <grid y> <grid z> <levels> <block x> <block y> <block z> <timesteps>\n", argv[0]);
+    printf("\nThe grid size is that of the coarse level.  Each of the up to %d levels refines\nthe middle half of the level below by 2.\n\n", AMR_MAX_LEVELS);
+    return EXIT_FAILURE;
+  }
+  
+  nx = atoi(argv[1]);
+  ny = atoi(argv[2]);
+  nz = atoi(argv[3]);
+  nlevels = atoi(argv[4]);
+  tx = atoi(argv[5]);
+  ty = atoi(argv[6]);
+  tz = atoi(argv[7]);
+  timesteps = atoi(argv[8]);
+  if (nlevels < 1 || nlevels > AMR_MAX_LEVELS) {
+    printf("<levels> must be between 1 and %d\n", AMR_MAX_LEVELS);
+    return EXIT_FAILURE;
+  }
+  printf("%dx%dx%d, levels: %d, blocking: %dx%dx%d, timesteps: %d\n",
+	 nx,ny,nz,nlevels,tx,ty,tz,timesteps);
+  
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+  
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  
+  /* kernel scratch memory, allocated and touched once outside the timings */
+  ScratchInit(nx,ny,nz,tx,ty,timesteps);
+  
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+  
+  for (i=0;i<NUM_TRIALS;i++) {
+    AmrInit(levels, nlevels, nx, ny, nz);
+    if (i == 0)
+      for (l=0;l<nlevels;l++)
+	printf("level %d: %dx%dx%d at %d,%d,%d\n", l, levels[l].nx, levels[l].ny,
+	       levels[l].nz, levels[l].ox, levels[l].oy, levels[l].oz);
+    
+    stats.stencil_ticks = stats.interp_ticks = stats.restrict_ticks = 0;
+    stats.stencil_bytes = stats.interp_bytes = stats.restrict_bytes = 0;
+    
+    t1 = getticks();
+    StencilProbe_amr(levels, nlevels, StencilProbe, tx, ty, tz, timesteps, &stats);
+    t2 = getticks();
+    total = elapsed(t2, t1);
+    
+    printf("elapsed ticks: %g  time:%g \n", total, spt * total);
+    printf("  stencil:     time:%g  bytes:%g\n",
+	   spt * stats.stencil_ticks, stats.stencil_bytes);
+    printf("  interpolate: time:%g  bytes:%g  (%.3g of stencil time, %.3g of stencil bytes)\n",
+	   spt * stats.interp_ticks, stats.interp_bytes,
+	   stats.interp_ticks / stats.stencil_ticks, stats.interp_bytes / stats.stencil_bytes);
+    printf("  restrict:    time:%g  bytes:%g  (%.3g of stencil time, %.3g of stencil bytes)\n",
+	   spt * stats.restrict_ticks, stats.restrict_bytes,
+	   stats.restrict_ticks / stats.stencil_ticks, stats.restrict_bytes / stats.stencil_bytes);
+    
+    AmrFree(levels, nlevels);
+  }
+  
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+/*
+	Stencil Probe
+	Main function for the batched small-grid probe.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "common.h"
+#include "util.h"
+#include "trace.h"
+#include "scratch.h"
+#include "topology.h"
+#include "batch.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+/* run.h has the run parameters */
+#include "run.h"
+
+void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
+                  int tx, int ty, int tz, int timesteps);
+
+int main(int argc,char *argv[])
+{
+  grid_desc *grids;
+  batch_stats stats;
+  int nx,ny,nz,npatches,tx,ty,tz,timesteps;
+  int i,g;
+  
+  ticks t1, t2;
+  double spt, serial;
+  
+  /* parse command line options */
+  if (argc < 9) {
+    printf("\nUSAGE:\n%s <patch x> <patch y> <patch z> <num patches> <block x> <block y> <block z> <timesteps>\n", argv[0]);
+    printf("\nEach patch is advanced by the linked StencilProbe kernel, first with one call per patch\nand then through StencilProbe_batch().  STENCILPROBE_BATCH_BYTES overrides the bundle size.\n\n");
+    return EXIT_FAILURE;
+  }
+  
+  nx = atoi(argv[1]);
+  ny = atoi(argv[2]);
+  nz = atoi(argv[3]);
+  npatches = atoi(argv[4]);
+  tx = atoi(argv[5]);
+  ty = atoi(argv[6]);
+  tz = atoi(argv[7]);
+  timesteps = atoi(argv[8]);
+  printf("%d patches of %dx%dx%d, blocking: %dx%dx%d, timesteps: %d\n",
+	 npatches,nx,ny,nz,tx,ty,tz,timesteps);
+  
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+  
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  /* tile timelines when STENCILPROBE_TRACE is set */
+  TraceInit(spt);
+  
+  /* pin threads (STENCILPROBE_AFFINITY) before anything is first touched */
+  TopoPin();
+  
+  /* allocate patches */
+  grids = (grid_desc*)malloc(sizeof(grid_desc)*npatches);
+  for (g=0;g<npatches;g++) {
+    grids[g].nx = nx;
+    grids[g].ny = ny;
+    grids[g].nz = nz;
+    grids[g].A0 = (double*)malloc(sizeof(double)*nx*ny*nz);
+    grids[g].Anext = (double*)malloc(sizeof(double)*nx*ny*nz);
+  }
+  
+  /* kernel scratch memory, allocated and touched once outside the timings */
+  ScratchInit(nx,ny,nz,tx,ty,timesteps);
+  
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+  TopoReport();
+  
+  for (i=0;i<NUM_TRIALS;i++) {
+    for (g=0;g<npatches;g++) {
+      StencilInit(nx,ny,nz,grids[g].A0);
+      StencilInit(nx,ny,nz,grids[g].Anext);
+    }
+    
+    t1 = getticks();
+    for (g=0;g<npatches;g++)
+      StencilProbe(grids[g].A0, grids[g].Anext, nx, ny, nz, tx, ty, tz, timesteps);
+    t2 = getticks();
+    serial = elapsed(t2, t1);
+    
+    for (g=0;g<npatches;g++) {
+      StencilInit(nx,ny,nz,grids[g].A0);
+      StencilInit(nx,ny,nz,grids[g].Anext);
+    }
+    
+    StencilProbe_batch(grids, npatches, StencilProbe, tx, ty, tz, timesteps, &stats);
+    
+    printf("per-patch calls: time:%g  per patch:%g \n",
+	   spt * serial, spt * serial / npatches);
+    printf("batched: threads:%d bundles:%d steals:%ld  time:%g  compute per patch:%g  overhead per patch:%g \n",
+	   stats.nthreads, stats.nbundles, stats.steals,
+	   spt * stats.wall_ticks,
+	   spt * stats.compute_ticks / npatches,
+	   spt * (stats.wall_ticks * stats.nthreads - stats.compute_ticks) / npatches);
+  }
+  
+  /* free arrays */
+  for (g=0;g<npatches;g++) {
+    free(grids[g].A0);
+    free(grids[g].Anext);
+  }
+  free(grids);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,315 @@
+/*
+	Stencil Probe
+	Regression benchmark: every kernel on an L2-, an LLC- and a
+	DRAM-sized grid, on one thread and on all of them, compared with the
+	stored baseline of this host.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "common.h"
+#include "util.h"
+#include "trace.h"
+#include "scratch.h"
+#include "topology.h"
+#include "circqueue.h"
+#include "pool.h"
+#include "bench.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+
+void StencilProbe_naive(double* A0, double* Anext, int nx, int ny, int nz,
+			int tx, int ty, int tz, int timesteps);
+void StencilProbe_rivera(double* A0, double* Anext, int nx, int ny, int nz,
+			 int tx, int ty, int tz, int timesteps);
+void StencilProbe_timeskew(double* A0, double* Anext, int nx, int ny, int nz,
+			   int tx, int ty, int tz, int timesteps);
+void StencilProbe_circqueue(double* A0, double* Anext, int nx, int ny, int nz,
+			    int tx, int ty, int tz, int timesteps);
+void StencilProbe_oblivious(double* A0, double* Anext, int nx, int ny, int nz,
+			    int tx, int ty, int tz, int timesteps);
+void StencilProbe_oblivious_tuned(double* A0, double* Anext, int nx, int ny, int nz,
+				  int tx, int ty, int tz, int timesteps);
+void StencilProbe_stream(double* A0, double* Anext, int nx, int ny, int nz,
+			 int tx, int ty, int tz, int timesteps);
+void StencilProbe_redblack_blocked(double* A0, double* Anext, int nx, int ny, int nz,
+				   int tx, int ty, int tz, int timesteps);
+void StencilProbe_redblack_wavefront(double* A0, double* Anext, int nx, int ny, int nz,
+				     int tx, int ty, int tz, int timesteps);
+
+static const struct {
+  const char *name;
+  stencil_fn kernel;
+  int queues;	/* needs CircularQueueInit before each run */
+} kernels[] = {
+  { "naive",              StencilProbe_naive,              0 },
+  { "blocked",            StencilProbe_rivera,             0 },
+  { "timeskew",           StencilProbe_timeskew,           0 },
+  { "circqueue",          StencilProbe_circqueue,          1 },
+  { "oblivious",          StencilProbe_oblivious,          0 },
+  { "oblivious_tuned",    StencilProbe_oblivious_tuned,    0 },
+  { "stream",             StencilProbe_stream,             0 },
+  { "redblack_blocked",   StencilProbe_redblack_blocked,   0 },
+  { "redblack_wavefront", StencilProbe_redblack_wavefront, 0 },
+};
+#define NKERNELS ((int) (sizeof(kernels)/sizeof(kernels[0])))
+
+static const char *grids[] = { "L2", "LLC", "DRAM" };
+#define NGRIDS 3
+
+/* a sample repeats the kernel call until it covers this many point updates */
+#define BENCH_MIN_UPDATES 2e7
+
+static int block, steps;
+static double spt;
+
+static void set_threads(int t) {
+#ifdef _OPENMP
+  omp_set_num_threads(t);
+#endif
+  TopoPin();
+}
+
+/* cubic edge whose two arrays take about bytes, the interior a multiple of the block */
+static int grid_edge(double bytes) {
+  int n = (int) cbrt(bytes / (2 * sizeof(double)));
+
+  if (n < block + 2)
+    n = block + 2;
+  return 2 + (n - 2 + block - 1) / block * block;
+}
+
+/*
+  Working sets: half of L2; a quarter of the LLC, but at least 4x L2 and
+  at most STENCILPROBE_BENCH_LLC_MB (default 64); 4x the LLC, but at
+  least 256 MB and at most STENCILPROBE_BENCH_DRAM_MB (default 2048).
+ */
+static double grid_bytes(int g) {
+  double l2 = cache_size(2) > 0 ? cache_size(2) : 256.0 * 1024;
+  double llc = cache_size(3) > 0 ? cache_size(3) : 8 * l2, mb = 1024.0 * 1024, ws;
+
+  if (g == 0)
+    return l2 / 2;
+  if (g == 1) {
+    ws = llc / 4;
+    if (ws > probe_param("BENCH_LLC_MB", 64) * mb)
+      ws = probe_param("BENCH_LLC_MB", 64) * mb;
+    return ws < 4 * l2 ? 4 * l2 : ws;
+  }
+  ws = 4 * llc < 256 * mb ? 256 * mb : 4 * llc;
+  if (ws > probe_param("BENCH_DRAM_MB", 2048) * mb)
+    ws = probe_param("BENCH_DRAM_MB", 2048) * mb;
+  return ws;
+}
+
+/* fills e->samples with e->count throughput samples (Mpoints/s) of kernel k */
+static void measure(int k, bench_entry *e) {
+  int n = e->n, reps, r, s;
+  double *A0, *Anext, interior = (double) (n-2) * (n-2) * (n-2), t;
+  ticks t1, t2;
+
+  Anext = (double*) malloc(sizeof(double)*n*n*n);
+  A0 = (double*) malloc(sizeof(double)*n*n*n);
+  if (A0 == NULL || Anext == NULL) {
+    printf("Error on grid malloc (%dx%dx%d).\n", n, n, n);
+    exit(EXIT_FAILURE);
+  }
+  TopoBindGrid(Anext, n, n, n);
+  TopoBindGrid(A0, n, n, n);
+  reps = (int) ceil(BENCH_MIN_UPDATES / (interior * steps));
+
+  // one untimed call faults the pages in and wakes the clocks and the threads
+  StencilInit(n, n, n, Anext);
+  StencilInit(n, n, n, A0);
+  if (kernels[k].queues && steps > 1)
+    CircularQueueInit(n, block, steps);
+  kernels[k].kernel(A0, Anext, n, n, n, block, block, block, steps);
+
+  for (s = 0; s < e->count; s++) {
+    t = 0;
+    // fresh values every call, so the grid never drifts into inf/NaN
+    for (r = 0; r < reps; r++) {
+      StencilInit(n, n, n, Anext);
+      StencilInit(n, n, n, A0);
+      if (kernels[k].queues && steps > 1)
+	CircularQueueInit(n, block, steps);
+      t1 = getticks();
+      kernels[k].kernel(A0, Anext, n, n, n, block, block, block, steps);
+      t2 = getticks();
+      t += spt * elapsed(t2, t1);
+    }
+    e->samples[s] = interior * steps * reps / t * 1e-6;
+  }
+
+  free(Anext);
+  free(A0);
+}
+
+static double best(const bench_entry *e) {
+  double b = 0;
+  int s;
+
+  for (s = 0; s < e->count; s++)
+    if (e->samples[s] > b)
+      b = e->samples[s];
+  return b;
+}
+
+int main(int argc,char *argv[])
+{
+  bench_entry *base = NULL, *run;
+  char host[256], path[512];
+  const char *dir;
+  double tol, alpha, change, p;
+  int nbase, nrun = 0, added = 0, nthreads = 1, maxthreads = 1, threads[2];
+  int k, g, t, a, edge, update, samples, regressions = 0;
+
+  if (argc > 1 && strcmp(argv[1], "-h") == 0) {
+    printf("\nUSAGE:\n%s [<kernel> ...]\n", argv[0]);
+    printf("\nRuns the kernels (default all) on an L2-, an LLC- and a DRAM-sized grid on\n");
+    printf("one thread and on all of them, and compares with the baseline of this host in\n");
+    printf("STENCILPROBE_BENCH_DIR (default bench)/<host>.json, recording it if there is none.\n");
+    printf("A point regresses when its best throughput drops by more than\n");
+    printf("STENCILPROBE_BENCH_TOL percent (default 5) and a one-sided Mann-Whitney test\n");
+    printf("puts the drop below STENCILPROBE_BENCH_ALPHA percent (default 5).\n");
+    printf("STENCILPROBE_BENCH_N samples per point (default 7), STENCILPROBE_BENCH_BLOCK\n");
+    printf("(default 16), STENCILPROBE_BENCH_STEPS per call (default 4);\n");
+    printf("STENCILPROBE_BENCH_UPDATE=1 replaces the points this run measures in the baseline;\n");
+    printf("points it does not measure are kept, and points missing from the baseline are added.\n\n");
+    return EXIT_FAILURE;
+  }
+  for (a = 1; a < argc; a++) {
+    for (k = 0; k < NKERNELS; k++)
+      if (strcmp(argv[a], kernels[k].name) == 0)
+	break;
+    if (k == NKERNELS) {
+      printf("Error: unknown kernel %s.\n", argv[a]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  block = probe_param("BENCH_BLOCK", 16);
+  steps = probe_param("BENCH_STEPS", 4);
+  samples = probe_param("BENCH_N", 7);
+  if (samples < 2)
+    samples = 2;
+  if (samples > BENCH_MAX_SAMPLES)
+    samples = BENCH_MAX_SAMPLES;
+  tol = probe_param("BENCH_TOL", 5) / 100.0;
+  alpha = probe_param("BENCH_ALPHA", 5) / 100.0;
+  update = probe_param("BENCH_UPDATE", 0);
+#ifdef _OPENMP
+  maxthreads = omp_get_max_threads();
+#endif
+  threads[0] = 1;
+  threads[1] = maxthreads;
+  nthreads = maxthreads > 1 ? 2 : 1;
+
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  TraceInit(spt);
+  /* the single-sweep kernels run threaded here (pool.h) */
+  PoolThreaded();
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+
+  if (gethostname(host, sizeof(host)) != 0)
+    strcpy(host, "unknown");
+  host[sizeof(host) - 1] = '\0';
+  dir = getenv("STENCILPROBE_BENCH_DIR");
+  if (dir == NULL || *dir == '\0')
+    dir = "bench";
+  snprintf(path, sizeof(path), "%s/%s.json", dir, host);
+  nbase = BenchLoad(path, &base);
+  printf("baseline: %s (%s)\n", path, nbase < 0 ? "none, this run records it" :
+	 update ? "compared, measured points replaced" : "compared");
+  printf("block %d, %d timesteps per call, %d samples per point, regression: > %.0f%% and p < %.2f\n",
+	 block, steps, samples, 100 * tol, alpha);
+
+  run = (bench_entry *) calloc(NKERNELS * NGRIDS * 2, sizeof(bench_entry));
+  if (run == NULL) {
+    printf("Error on benchmark malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  // scratch for the largest grid, on every thread
+  set_threads(maxthreads);
+  edge = grid_edge(grid_bytes(NGRIDS-1));
+  ScratchInit(edge, edge, edge, block, block, steps);
+  printf("%-20s %-5s %-6s %-8s %-12s %-12s %-9s %-8s %s\n", "kernel", "grid", "edge",
+	 "threads", "Mpoints/s", "baseline", "change", "p", "");
+  for (k = 0; k < NKERNELS; k++) {
+    for (a = 1; a < argc; a++)
+      if (strcmp(argv[a], kernels[k].name) == 0)
+	break;
+    if (argc > 1 && a == argc)
+      continue;
+    for (g = 0; g < NGRIDS; g++)
+      for (t = 0; t < nthreads; t++) {
+	bench_entry *e = &run[nrun++];
+	const bench_entry *b;
+	const char *verdict = "new";
+
+	snprintf(e->kernel, sizeof(e->kernel), "%s", kernels[k].name);
+	snprintf(e->grid, sizeof(e->grid), "%s", grids[g]);
+	e->n = grid_edge(grid_bytes(g));
+	e->threads = threads[t];
+	e->steps = steps;
+	e->count = samples;
+	set_threads(e->threads);
+	measure(k, e);
+
+	b = nbase > 0 ? bench_find(base, nbase, e) : NULL;
+	if (b == NULL) {
+	  added++;
+	  printf("%-20s %-5s %-6d %-8d %-12.1f %-12s %-9s %-8s %s\n", e->kernel, e->grid, e->n,
+		 e->threads, best(e), "-", "-", "-", verdict);
+	  continue;
+	}
+	change = best(e) / best(b) - 1;
+	if (change < 0) {
+	  p = mann_whitney_p(b->samples, b->count, e->samples, e->count);
+	  verdict = -change > tol && p < alpha ? "REGRESSED" : "ok";
+	}
+	else {
+	  p = mann_whitney_p(e->samples, e->count, b->samples, b->count);
+	  verdict = change > tol && p < alpha ? "faster" : "ok";
+	}
+	if (strcmp(verdict, "REGRESSED") == 0)
+	  regressions++;
+	printf("%-20s %-5s %-6d %-8d %-12.1f %-12.1f %+-9.1f %-8.3g %s\n", e->kernel, e->grid, e->n,
+	       e->threads, best(e), best(b), 100 * change, p, verdict);
+      }
+  }
+
+  // points this run did not measure keep their baseline; new ones are
+  // added, and re-measured ones replaced only on update
+  if (nbase < 0 || update || added) {
+    bench_entry *merged;
+    int nmerged = bench_merge(base, nbase > 0 ? nbase : 0, run, nrun, update, &merged);
+
+    mkdir(dir, 0777);
+    if (BenchSave(path, host, merged, nmerged) != 0) {
+      printf("Error: cannot write baseline %s.\n", path);
+      return EXIT_FAILURE;
+    }
+    printf("baseline written to %s (%d points)\n", path, nmerged);
+    free(merged);
+  }
+  printf("%d of %d points regressed\n", regressions, nrun);
+
+  free(base);
+  free(run);
+  return regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
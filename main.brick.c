@@ -0,0 +1,170 @@
+/*
+	Stencil Probe
+	Main function comparing bricked, space-filling-curve ordered storage
+	with the Index3D layout, plain, padded and blocked.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "common.h"
+#include "util.h"
+#include "brick.h"
+#include "scratch.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+/* run.h has the run parameters */
+#include "run.h"
+
+void StencilProbe_naive(double* A0, double* Anext, int nx, int ny, int nz,
+			int tx, int ty, int tz, int timesteps);
+void StencilProbe_rivera(double* A0, double* Anext, int nx, int ny, int nz,
+			 int tx, int ty, int tz, int timesteps);
+
+typedef void (*brick_fn)(brick_grid *A0, brick_grid *Anext, int tx, int ty, int tz, int timesteps);
+
+static const struct {
+  const char *name;
+  stencil_fn kernel;
+} linear[] = {
+  { "naive",   StencilProbe_naive },
+  { "blocked", StencilProbe_rivera },
+};
+
+static const struct {
+  const char *name;
+  brick_fn kernel;
+} bricked[] = {
+  { "naive",   StencilProbe_brick_naive },
+  { "blocked", StencilProbe_brick_blocked },
+};
+
+static int nx, ny, nz, tx, ty, tz, timesteps;
+static double spt;
+
+/* best time over NUM_TRIALS of a linear kernel on an (nx+pad)x(ny+pad)xnz grid */
+static double run_linear(stencil_fn kernel, int pad) {
+  int px = nx + pad, py = ny + pad;
+  double *A0, *Anext, best = -1;
+  ticks t1, t2;
+  int i;
+
+  Anext = (double*)malloc(sizeof(double)*px*py*nz);
+  A0 = (double*)malloc(sizeof(double)*px*py*nz);
+  if (A0 == NULL || Anext == NULL) {
+    printf("Error on padded grid malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i=0;i<NUM_TRIALS;i++) {
+    StencilInit(px,py,nz,Anext);
+    StencilInit(px,py,nz,A0);
+
+    t1 = getticks();
+    kernel(A0, Anext, px, py, nz, tx, ty, tz, timesteps);
+    t2 = getticks();
+
+    if (best < 0 || elapsed(t2, t1) < best)
+      best = elapsed(t2, t1);
+  }
+  free(Anext);
+  free(A0);
+  return spt * best;
+}
+
+int main(int argc,char *argv[])
+{
+  brick_grid A0, Anext;
+  double *init;
+  int i,o,e,pad;
+
+  ticks t1, t2;
+  double best, updates, conv_in, conv_out, t;
+
+  /* parse command line options */
+  if (argc < 8) {
+    printf("\nUSAGE:\n%s <grid x> <grid y> <grid z> <block x> <block y> <block z> <timesteps>\n", argv[0]);
+    printf("\nThe padded runs add STENCILPROBE_BRICK_PAD (default 8) cells to the x and y extents;\n");
+    printf("their time is still divided by the unpadded number of updates.\n\n");
+    return EXIT_FAILURE;
+  }
+
+  nx = atoi(argv[1]);
+  ny = atoi(argv[2]);
+  nz = atoi(argv[3]);
+  tx = atoi(argv[4]);
+  ty = atoi(argv[5]);
+  tz = atoi(argv[6]);
+  timesteps = atoi(argv[7]);
+  pad = probe_param("BRICK_PAD", 8);
+  printf("%dx%dx%d, blocking: %dx%dx%d, timesteps: %d, brick: %d^3\n",
+	 nx,ny,nz,tx,ty,tz,timesteps,BRICK_DIM);
+
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  /* the padded runs are the largest grid (active tiles, if enabled, map it) */
+  ScratchInit(nx+pad,ny+pad,nz,tx,ty,timesteps);
+  updates = (double) (nx-2) * (ny-2) * (nz-2) * timesteps;
+
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+
+  for (e=0;e<(int)(sizeof(linear)/sizeof(linear[0]));e++) {
+    t = run_linear(linear[e].kernel, 0);
+    printf("%-16s %-8s bytes:%-11ld best time:%-10g ns/update:%g \n", "linear",
+	   linear[e].name, 2L * sizeof(double) * nx * ny * nz, t, 1e9 * t / updates);
+    if (pad > 0) {
+      t = run_linear(linear[e].kernel, pad);
+      printf("%-16s %-8s bytes:%-11ld best time:%-10g ns/update:%g \n", "linear padded",
+	     linear[e].name, 2L * sizeof(double) * (nx+pad) * (ny+pad) * nz, t, 1e9 * t / updates);
+    }
+  }
+
+  init = (double*)malloc(sizeof(double)*nx*ny*nz);
+  if (init == NULL) {
+    printf("Error on grid malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (o=BRICK_LEX;o<=BRICK_HILBERT;o++) {
+    BrickAlloc(&A0, o, nx, ny, nz);
+    BrickAlloc(&Anext, o, nx, ny, nz);
+
+    for (e=0;e<(int)(sizeof(bricked)/sizeof(bricked[0]));e++) {
+      best = -1;
+      conv_in = conv_out = -1;
+      for (i=0;i<NUM_TRIALS;i++) {
+	StencilInit(nx,ny,nz,init);
+	t1 = getticks();
+	BrickFromLinear(&A0, init);
+	t2 = getticks();
+	if (conv_in < 0 || elapsed(t2, t1) < conv_in)
+	  conv_in = elapsed(t2, t1);
+	BrickFromLinear(&Anext, init);
+
+	t1 = getticks();
+	bricked[e].kernel(&A0, &Anext, tx, ty, tz, timesteps);
+	t2 = getticks();
+	if (best < 0 || elapsed(t2, t1) < best)
+	  best = elapsed(t2, t1);
+
+	t1 = getticks();
+	BrickToLinear(timesteps % 2 == 0 ? &A0 : &Anext, init);
+	t2 = getticks();
+	if (conv_out < 0 || elapsed(t2, t1) < conv_out)
+	  conv_out = elapsed(t2, t1);
+      }
+      printf("%-16s %-8s bytes:%-11ld best time:%-10g ns/update:%g  to/from linear:%g/%g s\n",
+	     brick_order_name(o), bricked[e].name, 2 * brick_bytes(&A0), spt * best,
+	     1e9 * spt * best / updates, spt * conv_in, spt * conv_out);
+    }
+
+    BrickFree(&A0);
+    BrickFree(&Anext);
+  }
+
+  free(init);
+  return EXIT_SUCCESS;
+}
@@ -7,6 +7,20 @@
 #include <stdlib.h>
 #include "common.h"
 #include "util.h"
+#include "trace.h"
+#include "scratch.h"
+#include "topology.h"
+#include "phase.h"
+#include "pool.h"
+#include "boundary.h"
+#include "active.h"
+#include "energy.h"
+#ifdef VARCOEFPROBE
+#include "coef.h"
+#endif
+#ifdef CIRCULARQUEUEPROBE
+#include "circqueue.h"
+#endif
 #include "cycle.h"
 #ifdef HAVE_PAPI
 #include <papi.h>
@@ -22,10 +36,12 @@ int main(int argc,char *argv[])
   double *Anext;
   double *A0;
   int nx,ny,nz,tx,ty,tz,timesteps;
-  int i;
+  int i, energy;
   
   ticks t1, t2;
   double spt;
+  energy_mark em;
+  energy_sample es;
   
   /* parse command line options */
   if (argc < 8) {
@@ -51,12 +67,34 @@ int main(int argc,char *argv[])
   
   /* find conversion factor from ticks to seconds */
   spt = seconds_per_tick();
+  /* tile timelines when STENCILPROBE_TRACE is set */
+  TraceInit(spt);
+  
+  /* pin threads (STENCILPROBE_AFFINITY) before anything is first touched */
+  TopoPin();
   
   /* allocate arrays */ 
   Anext=(double*)malloc(sizeof(double)*nx*ny*nz);
   A0=(double*)malloc(sizeof(double)*nx*ny*nz);
+  TopoBindGrid(Anext,nx,ny,nz);
+  TopoBindGrid(A0,nx,ny,nz);
+  
+  /* kernel scratch memory, allocated and touched once outside the timings */
+  ScratchInit(nx,ny,nz,tx,ty,timesteps);
   
   printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+  TopoReport();
+  /* RAPL energy and core clock per trial when STENCILPROBE_ENERGY is set */
+  energy = probe_param("ENERGY", 0);
+  if (energy)
+    EnergyInit(1 / spt);
+  
+#ifdef VARCOEFPROBE
+  /* coefficients are constant across trials */
+  CoefInit(nx,ny,nz);
+  printf("coefficient grids: %d  bytes per coefficient: %d\n",
+	 stencil_coefs.ncoef, coef_bytes(&stencil_coefs));
+#endif
   
   for (i=0;i<NUM_TRIALS;i++) {
     /* initialize arrays to all ones */
@@ -69,6 +107,12 @@ int main(int argc,char *argv[])
 #endif    
 
     // clear_cache();
+    PhaseReset();
+    PoolReset();
+    BoundaryReset();
+    ActiveReset();
+    if (energy)
+      EnergyMark(&em);
     
     t1 = getticks();	
     
@@ -76,8 +120,17 @@ int main(int argc,char *argv[])
     StencilProbe(A0, Anext, nx, ny, nz, tx, ty, tz, timesteps);
     
     t2 = getticks();
+    // end mark before any report is printed, so joules cover the call only
+    if (energy)
+      EnergySince(&em, spt * elapsed(t2,t1), &es);
     
     printf("elapsed ticks: %g  time:%g \n", elapsed(t2, t1), spt * elapsed(t2,t1));
+    PhaseReport(spt, spt * elapsed(t2,t1));
+    PoolReport(spt);
+    BoundaryReport(spt, spt * elapsed(t2,t1));
+    ActiveReport();
+    if (energy)
+      EnergyReport(&es, (double) (nx-2) * (ny-2) * (nz-2) * timesteps);
   }
   
   /* free arrays */
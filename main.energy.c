@@ -0,0 +1,196 @@
+/*
+	Stencil Probe
+	Energy and frequency per kernel and thread count: RAPL joules and
+	APERF/MPERF clock around every trial.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "common.h"
+#include "util.h"
+#include "trace.h"
+#include "scratch.h"
+#include "topology.h"
+#include "circqueue.h"
+#include "pool.h"
+#include "energy.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+/* run.h has the run parameters */
+#include "run.h"
+
+void StencilProbe_naive(double* A0, double* Anext, int nx, int ny, int nz,
+			int tx, int ty, int tz, int timesteps);
+void StencilProbe_rivera(double* A0, double* Anext, int nx, int ny, int nz,
+			 int tx, int ty, int tz, int timesteps);
+void StencilProbe_timeskew(double* A0, double* Anext, int nx, int ny, int nz,
+			   int tx, int ty, int tz, int timesteps);
+void StencilProbe_circqueue(double* A0, double* Anext, int nx, int ny, int nz,
+			    int tx, int ty, int tz, int timesteps);
+void StencilProbe_oblivious(double* A0, double* Anext, int nx, int ny, int nz,
+			    int tx, int ty, int tz, int timesteps);
+void StencilProbe_oblivious_tuned(double* A0, double* Anext, int nx, int ny, int nz,
+				  int tx, int ty, int tz, int timesteps);
+void StencilProbe_stream(double* A0, double* Anext, int nx, int ny, int nz,
+			 int tx, int ty, int tz, int timesteps);
+void StencilProbe_redblack_blocked(double* A0, double* Anext, int nx, int ny, int nz,
+				   int tx, int ty, int tz, int timesteps);
+void StencilProbe_redblack_wavefront(double* A0, double* Anext, int nx, int ny, int nz,
+				     int tx, int ty, int tz, int timesteps);
+
+static const struct {
+  const char *name;
+  stencil_fn kernel;
+  int queues;	/* needs CircularQueueInit before each run */
+} kernels[] = {
+  { "naive",              StencilProbe_naive,              0 },
+  { "blocked",            StencilProbe_rivera,             0 },
+  { "timeskew",           StencilProbe_timeskew,           0 },
+  { "circqueue",          StencilProbe_circqueue,          1 },
+  { "oblivious",          StencilProbe_oblivious,          0 },
+  { "oblivious_tuned",    StencilProbe_oblivious_tuned,    0 },
+  { "stream",             StencilProbe_stream,             0 },
+  { "redblack_blocked",   StencilProbe_redblack_blocked,   0 },
+  { "redblack_wavefront", StencilProbe_redblack_wavefront, 0 },
+};
+#define NKERNELS ((int) (sizeof(kernels)/sizeof(kernels[0])))
+
+static int nx, ny, nz, tx, ty, tz, timesteps;
+static double spt;
+
+static void set_threads(int t) {
+#ifdef _OPENMP
+  omp_set_num_threads(t);
+#endif
+  TopoPin();
+}
+
+/*
+  NUM_TRIALS runs of kernel k; *best is the sample of the fastest, whose
+  energy goes with the time reported next to it
+*/
+static void run(int k, double *A0, double *Anext, energy_sample *best) {
+  energy_mark m;
+  energy_sample s;
+  ticks t1, t2;
+  int i;
+
+  for (i=0;i<NUM_TRIALS;i++) {
+    StencilInit(nx,ny,nz,Anext);
+    StencilInit(nx,ny,nz,A0);
+    if (kernels[k].queues && timesteps > 1)
+      CircularQueueInit(nx, ty, timesteps);
+
+    EnergyMark(&m);
+    t1 = getticks();
+    kernels[k].kernel(A0, Anext, nx, ny, nz, tx, ty, tz, timesteps);
+    t2 = getticks();
+    EnergySince(&m, spt * elapsed(t2, t1), &s);
+    if (i == 0 || s.seconds < best->seconds)
+      *best = s;
+  }
+}
+
+static void na(char *buf, int len, int known, const char *fmt, double v) {
+  if (known)
+    snprintf(buf, len, fmt, v);
+  else
+    snprintf(buf, len, "n/a");
+}
+
+int main(int argc,char *argv[])
+{
+  double *Anext, *A0, updates, joules;
+  int maxthreads = 1, t, last, k, a, selected;
+  energy_sample s;
+  char j[32], nj[32], w[32], gfw[32], ghz[32];
+
+  /* parse command line options */
+  if (argc < 8) {
+    printf("\nUSAGE:\n%s <grid x> <grid y> <grid z> <block x> <block y> <block z> <timesteps> [<kernel> ...]\n", argv[0]);
+    printf("\nRuns each kernel (default all) on 1, 2, 4, ... up to the OpenMP thread count and\n");
+    printf("reports package (+dram) energy from RAPL and the mean core clock from APERF/MPERF.\n");
+    printf("\nKERNELS:\n");
+    for (k=0;k<NKERNELS;k++)
+      printf("  %s\n", kernels[k].name);
+    printf("\n");
+    return EXIT_FAILURE;
+  }
+  nx = atoi(argv[1]);
+  ny = atoi(argv[2]);
+  nz = atoi(argv[3]);
+  tx = atoi(argv[4]);
+  ty = atoi(argv[5]);
+  tz = atoi(argv[6]);
+  timesteps = atoi(argv[7]);
+  for (a = 8; a < argc; a++) {
+    for (k=0;k<NKERNELS;k++)
+      if (strcmp(argv[a], kernels[k].name) == 0)
+	break;
+    if (k == NKERNELS) {
+      printf("Error: unknown kernel %s.\n", argv[a]);
+      return EXIT_FAILURE;
+    }
+  }
+#ifdef _OPENMP
+  maxthreads = omp_get_max_threads();
+#endif
+  printf("%dx%dx%d, blocking: %dx%dx%d, timesteps: %d\n", nx,ny,nz,tx,ty,tz,timesteps);
+
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  TraceInit(spt);
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+  EnergyInit(1 / spt);
+  /* the single-sweep kernels run threaded here (pool.h) */
+  PoolThreaded();
+
+  Anext = (double*) malloc(sizeof(double)*nx*ny*nz);
+  A0 = (double*) malloc(sizeof(double)*nx*ny*nz);
+  if (A0 == NULL || Anext == NULL) {
+    printf("Error on grid malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  ScratchInit(nx,ny,nz,tx,ty,timesteps);
+  updates = (double) (nx-2) * (ny-2) * (nz-2) * timesteps;
+
+  printf("%-20s %-8s %-12s %-12s %-10s %-10s %-8s %-12s %-8s\n", "kernel", "threads", "time(s)",
+	 "Mupdates/s", "joules", "nJ/update", "watts", "GFlop/s/W", "GHz");
+  for (k=0;k<NKERNELS;k++) {
+    for (selected = argc == 8, a = 8; a < argc; a++)
+      if (strcmp(argv[a], kernels[k].name) == 0)
+	selected = 1;
+    if (!selected)
+      continue;
+    for (t = 1, last = 0; last < maxthreads; t *= 2) {
+      if (t > maxthreads)
+	t = maxthreads;
+      last = t;
+      set_threads(t);
+      run(k, A0, Anext, &s);
+      joules = s.joules + s.dram_joules;
+      na(j, sizeof(j), s.rapl, "%.4g", joules);
+      na(nj, sizeof(nj), s.rapl, "%.4g", 1e9 * joules / updates);
+      na(w, sizeof(w), s.rapl, "%.1f", joules / s.seconds);
+      na(gfw, sizeof(gfw), s.rapl && joules > 0, "%.4g", 1e-9 * ENERGY_FLOPS_PER_UPDATE * updates / joules);
+      na(ghz, sizeof(ghz), s.freq, "%.2f", s.ghz);
+      printf("%-20s %-8d %-12.4g %-12.1f %-10s %-10s %-8s %-12s %-8s\n", kernels[k].name, t,
+	     s.seconds, updates / s.seconds * 1e-6, j, nj, w, gfw, ghz);
+    }
+  }
+  set_threads(maxthreads);
+
+  free(Anext);
+  free(A0);
+  return EXIT_SUCCESS;
+}
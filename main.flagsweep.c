@@ -0,0 +1,198 @@
+/*
+	Stencil Probe
+	Compiler / flag sweep: loads the kernels flagsweep.sh built under
+	each compiler and flag set and benchmarks them side by side.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fenv.h>
+#include <dlfcn.h>
+#include "common.h"
+#include "util.h"
+#include "scratch.h"
+#include "trace.h"
+#include "circqueue.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+/* run.h has the run parameters */
+#include "run.h"
+
+#define SWEEP_MAX_VARIANTS 256
+
+typedef struct {
+  char kernel[32], cc[32], flags[256], path[512];
+  stencil_fn fn;
+  /*
+    floating-point state right after loading: a -ffast-math object may
+    switch on flush-to-zero when it is loaded, which must not leak into
+    the other variants
+  */
+  fenv_t env;
+} variant;
+
+static variant v[SWEEP_MAX_VARIANTS];
+
+/* reads the tab-separated manifest; returns the number of variants */
+static int load_manifest(const char *path) {
+  FILE *f = fopen(path, "r");
+  char line[1024], *field[4], *p;
+  int n = 0, i;
+
+  if (f == NULL) {
+    printf("Error: cannot read manifest %s.\n", path);
+    exit(EXIT_FAILURE);
+  }
+  while (n < SWEEP_MAX_VARIANTS && fgets(line, sizeof(line), f) != NULL) {
+    line[strcspn(line, "\n")] = '\0';
+    for (i = 0, p = line; i < 4 && p != NULL; i++) {
+      field[i] = p;
+      if ((p = strchr(p, '\t')) != NULL)
+	*p++ = '\0';
+    }
+    if (i < 4)
+      continue;
+    snprintf(v[n].kernel, sizeof(v[n].kernel), "%s", field[0]);
+    snprintf(v[n].cc, sizeof(v[n].cc), "%s", field[1]);
+    snprintf(v[n].flags, sizeof(v[n].flags), "%s", field[2]);
+    snprintf(v[n].path, sizeof(v[n].path), "%s", field[3]);
+    n++;
+  }
+  fclose(f);
+  return n;
+}
+
+/* largest difference between A and ref over the grid, relative to the largest |ref| */
+static double max_diff(const double *A, const double *ref, long n) {
+  double d = 0, big = 0, e;
+  long i;
+
+  for (i = 0; i < n; i++) {
+    e = fabs(A[i] - ref[i]);
+    if (e != e)
+      return INFINITY;
+    if (e > d)
+      d = e;
+    if (fabs(ref[i]) > big)
+      big = fabs(ref[i]);
+  }
+  return big > 0 ? d / big : d;
+}
+
+int main(int argc,char *argv[])
+{
+  double *Anext, *A0, *ref, *result, t, best, first = 0, spt, diff, bestrate;
+  int nx,ny,nz,tx,ty,tz,timesteps;
+  int n, i, j, trial, seen, fastest;
+  long points;
+  fenv_t base;
+  ticks t1, t2;
+
+  /* parse command line options */
+  if (argc < 9) {
+    printf("\nUSAGE:\n%s <manifest> <grid x> <grid y> <grid z> <block x> <block y> <block z> <timesteps>\n", argv[0]);
+    printf("\nThe manifest lists kernel, compiler, flags and shared object, tab-separated,\n");
+    printf("one per line, as flagsweep.sh writes it.  Each variant is checked against the\n");
+    printf("first build of the same kernel.\n\n");
+    return EXIT_FAILURE;
+  }
+  n = load_manifest(argv[1]);
+  nx = atoi(argv[2]);
+  ny = atoi(argv[3]);
+  nz = atoi(argv[4]);
+  tx = atoi(argv[5]);
+  ty = atoi(argv[6]);
+  tz = atoi(argv[7]);
+  timesteps = atoi(argv[8]);
+  points = (long) nx * ny * nz;
+  printf("%dx%dx%d, blocking: %dx%dx%d, timesteps: %d, %d variants\n",
+	 nx,ny,nz,tx,ty,tz,timesteps,n);
+
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  TraceInit(spt);
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+
+  fegetenv(&base);
+  for (i = 0; i < n; i++) {
+    void *h = dlopen(v[i].path, RTLD_NOW | RTLD_LOCAL);
+
+    if (h == NULL || (v[i].fn = (stencil_fn) dlsym(h, "StencilProbe")) == NULL) {
+      printf("skipping %s: %s\n", v[i].path, dlerror());
+      v[i].fn = NULL;
+      continue;
+    }
+    fegetenv(&v[i].env);
+    fesetenv(&base);
+  }
+
+  Anext = (double*) malloc(sizeof(double)*points);
+  A0 = (double*) malloc(sizeof(double)*points);
+  ref = (double*) malloc(sizeof(double)*points);
+  if (A0 == NULL || Anext == NULL || ref == NULL) {
+    printf("Error on grid malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  ScratchInit(nx,ny,nz,tx,ty,timesteps);
+
+  printf("%-12s %-8s %-36s %-12s %-12s %-9s %-10s\n", "kernel", "cc", "flags", "time(s)",
+	 "Mpoints/s", "speedup", "max diff");
+  // kernels in the order they first appear, every build of one together
+  for (i = 0; i < n; i++) {
+    for (seen = 0, j = 0; j < i; j++)
+      if (strcmp(v[j].kernel, v[i].kernel) == 0)
+	seen = 1;
+    if (seen)
+      continue;
+    fastest = -1;
+    bestrate = 0;
+    first = 0;
+    for (j = i; j < n; j++) {
+      if (strcmp(v[j].kernel, v[i].kernel) != 0 || v[j].fn == NULL)
+	continue;
+      best = -1;
+      for (trial = 0; trial < NUM_TRIALS; trial++) {
+	StencilInit(nx,ny,nz,Anext);
+	StencilInit(nx,ny,nz,A0);
+	if (strcmp(v[j].kernel, "circqueue") == 0 && timesteps > 1)
+	  CircularQueueInit(nx, ty, timesteps);
+	fesetenv(&v[j].env);
+	t1 = getticks();
+	v[j].fn(A0, Anext, nx, ny, nz, tx, ty, tz, timesteps);
+	t2 = getticks();
+	fesetenv(&base);
+	t = spt * elapsed(t2, t1);
+	if (best < 0 || t < best)
+	  best = t;
+      }
+      result = timesteps % 2 == 0 ? A0 : Anext;
+      if (first == 0) {
+	first = best;
+	memcpy(ref, result, sizeof(double)*points);
+      }
+      diff = max_diff(result, ref, points);
+      printf("%-12s %-8s %-36s %-12.4g %-12.1f %-9.2f %-10.3g\n", v[j].kernel, v[j].cc,
+	     v[j].flags, best, (double) (nx-2) * (ny-2) * (nz-2) * timesteps / best * 1e-6,
+	     first / best, diff);
+      if (fastest < 0 || first / best > bestrate) {
+	fastest = j;
+	bestrate = first / best;
+      }
+    }
+    if (fastest >= 0)
+      printf("best %s: %s %s (%.2fx)\n", v[i].kernel, v[fastest].cc, v[fastest].flags, bestrate);
+  }
+
+  free(Anext);
+  free(A0);
+  free(ref);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+/*
+	Stencil Probe
+	Halo pack / unpack microbenchmark, per face orientation and for the
+	threaded six-face exchange.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "common.h"
+#include "util.h"
+#include "halo.h"
+#include "cycle.h"
+/* run.h has the run parameters */
+#include "run.h"
+
+static double spt;
+
+/* best seconds per call of op over NUM_TRIALS batches of reps calls */
+#define TIME_BEST(_best, _reps, _op)					\
+  do {									\
+    ticks _t1, _t2;							\
+    int _i, _r;								\
+    (_best) = -1;							\
+    for (_i = 0; _i < NUM_TRIALS; _i++) {				\
+      _t1 = getticks();							\
+      for (_r = 0; _r < (_reps); _r++)					\
+	_op;								\
+      _t2 = getticks();							\
+      if ((_best) < 0 || spt * elapsed(_t2, _t1) / (_reps) < (_best))	\
+	(_best) = spt * elapsed(_t2, _t1) / (_reps);			\
+    }									\
+  } while (0)
+
+int main(int argc,char *argv[])
+{
+  halo_plan h;
+  double *A;
+  int nx,ny,nz,w,f,reps,threads=1;
+  double pack, unpack, xchg, bytes, copied;
+
+  /* parse command line options */
+  if (argc < 4) {
+    printf("\nUSAGE:\n%s <grid x> <grid y> <grid z> [<halo width>]\n", argv[0]);
+    printf("\nTimes packing and unpacking each face of the grid, then the threaded\n");
+    printf("pack / self-exchange / unpack of all six.  STENCILPROBE_HALO_REPS sets the\n");
+    printf("calls per timing (default 20).\n\n");
+    return EXIT_FAILURE;
+  }
+
+  nx = atoi(argv[1]);
+  ny = atoi(argv[2]);
+  nz = atoi(argv[3]);
+  w = argc > 4 ? atoi(argv[4]) : 1;
+  reps = probe_param("HALO_REPS", 20);
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+  printf("%dx%dx%d, halo width: %d, x-face gathers: %s, threads: %d\n",
+	 nx,ny,nz,w,halo_gather_desc(),threads);
+
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+
+  A = (double*)malloc(sizeof(double)*nx*ny*nz);
+  if (A == NULL) {
+    printf("Error on grid malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  StencilInit(nx,ny,nz,A);
+  HaloInit(&h, nx, ny, nz, w);
+
+  printf("%-5s %-10s %-10s %-12s %-10s %-12s %-10s\n", "face", "doubles", "zero-copy",
+	 "pack(us)", "GB/s", "unpack(us)", "GB/s");
+  for (f=0;f<HALO_FACES;f++) {
+    bytes = h.face[f].count * sizeof(double);
+    TIME_BEST(pack, reps, HaloPackFace(&h, A, f));
+    TIME_BEST(unpack, reps, HaloUnpackFace(&h, A, f));
+    if (h.face[f].zero_copy)
+      printf("%-5s %-10ld %-10s %-12.3g %-10s %-12.3g %-10s\n", halo_face_name(f),
+	     h.face[f].count, "yes", 1e6 * pack, "-", 1e6 * unpack, "-");
+    else
+      printf("%-5s %-10ld %-10s %-12.3g %-10.3g %-12.3g %-10.3g\n", halo_face_name(f),
+	     h.face[f].count, "no", 1e6 * pack, bytes / pack * 1e-9,
+	     1e6 * unpack, bytes / unpack * 1e-9);
+  }
+
+  /* the whole exchange; the self-exchange stands in for the network */
+  bytes = copied = 0;
+  for (f=0;f<HALO_FACES;f++) {
+    bytes += h.face[f].count * sizeof(double);
+    if (!h.face[f].zero_copy)
+      copied += h.face[f].count * sizeof(double);
+  }
+  TIME_BEST(pack, reps, HaloPack(&h, A));
+  TIME_BEST(xchg, reps, HaloExchangeSelf(&h));
+  TIME_BEST(unpack, reps, HaloUnpack(&h, A));
+  printf("all faces: %.0f bytes (%.0f packed), pack %.3g us, exchange %.3g us, unpack %.3g us, "
+	 "pack+unpack %.3g GB/s\n", bytes, copied, 1e6 * pack, 1e6 * xchg, 1e6 * unpack,
+	 2 * copied / (pack + unpack) * 1e-9);
+
+  HaloFree(&h);
+  free(A);
+  return EXIT_SUCCESS;
+}
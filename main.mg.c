@@ -0,0 +1,100 @@
+/*
+	Stencil Probe
+	Main function for the multigrid V-cycle probe.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "common.h"
+#include "util.h"
+#include "scratch.h"
+#include "mg.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+/* run.h has the run parameters */
+#include "run.h"
+
+void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
+                  int tx, int ty, int tz, int timesteps);
+
+static const char *phase_names[MG_NPHASES] = { "smooth", "residual", "restrict", "prolong" };
+
+int main(int argc,char *argv[])
+{
+  mg_hierarchy mg;
+  int nx,ny,nz,nlevels,tx,ty,tz,cycles;
+  int i,l,p;
+  
+  ticks t1, t2;
+  double spt, r0, r1, total;
+  
+  /* parse command line options */
+  if (argc < 9) {
+    printf("\nUSAGE:\n%s <grid x> <grid y> <grid z> <levels> <block x> <block y> <block z> <V-cycles>\n", argv[0]);
+    printf("\nGRID CONSTRAINTS:\nEach <grid size - 1> should be divisible by 2^(levels-1), e.g. 2^m+1.\n");
+    printf("The block sizes are passed to the smoother/residual kernel on every level.\n\n");
+    return EXIT_FAILURE;
+  }
+  
+  nx = atoi(argv[1]);
+  ny = atoi(argv[2]);
+  nz = atoi(argv[3]);
+  nlevels = atoi(argv[4]);
+  tx = atoi(argv[5]);
+  ty = atoi(argv[6]);
+  tz = atoi(argv[7]);
+  cycles = atoi(argv[8]);
+  printf("%dx%dx%d, levels: %d, blocking: %dx%dx%d, V-cycles: %d\n",
+	 nx,ny,nz,nlevels,tx,ty,tz,cycles);
+  
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+  
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  
+  /* kernel scratch memory, allocated and touched once outside the timings */
+  ScratchInit(nx,ny,nz,tx,ty,1);
+  
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+  
+  for (i=0;i<NUM_TRIALS;i++) {
+    MgInit(&mg, nx, ny, nz, nlevels);
+    r0 = MgResidualNorm(&mg, StencilProbe, tx, ty, tz);
+    
+    t1 = getticks();
+    StencilProbe_vcycle(&mg, StencilProbe, tx, ty, tz, cycles);
+    t2 = getticks();
+    
+    r1 = MgResidualNorm(&mg, StencilProbe, tx, ty, tz);
+    printf("elapsed ticks: %g  time:%g  residual: %g -> %g  (%g per cycle)\n",
+	   elapsed(t2, t1), spt * elapsed(t2,t1), r0, r1,
+	   cycles > 0 ? pow(r1 / r0, 1.0 / cycles) : 1.0);
+    
+    if (i == NUM_TRIALS-1) {
+      printf("%-6s %-14s %-8s", "level", "size", "threads");
+      for (p=0;p<MG_NPHASES;p++)
+	printf(" %-11s", phase_names[p]);
+      printf(" %-11s\n", "total");
+      for (l=0;l<mg.nlevels;l++) {
+	char size[32];
+	snprintf(size, sizeof(size), "%dx%dx%d", mg.level[l].nx, mg.level[l].ny, mg.level[l].nz);
+	printf("%-6d %-14s %-8d", l, size, mg.level[l].threads);
+	total = 0;
+	for (p=0;p<MG_NPHASES;p++) {
+	  printf(" %-11.4g", spt * mg.level[l].ticks[p]);
+	  total += mg.level[l].ticks[p];
+	}
+	printf(" %-11.4g\n", spt * total);
+      }
+    }
+    
+    MgFree(&mg);
+  }
+  
+  return EXIT_SUCCESS;
+}
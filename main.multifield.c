@@ -0,0 +1,138 @@
+/*
+	Stencil Probe
+	Main function comparing the SoA, AoS and AoSoA layouts of a
+	multi-component grid under the naive and blocked engines.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "common.h"
+#include "util.h"
+#include "multifield.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+/* run.h has the run parameters */
+#include "run.h"
+
+typedef void (*mf_fn)(mf_grid *A0, mf_grid *Anext, int tx, int ty, int tz, int timesteps);
+
+static const struct {
+  const char *name;
+  int layout;
+} layouts[] = {
+  { "SoA",   MF_SOA },
+  { "AoS",   MF_AOS },
+  { "AoSoA", MF_AOSOA },
+};
+
+static const struct {
+  const char *name;
+  mf_fn kernel;
+} engines[] = {
+  { "naive",   StencilProbe_mf_naive },
+  { "blocked", StencilProbe_mf_blocked },
+};
+
+/*
+  Modeled DRAM traffic per component update: read A0, write Anext and
+  its write-allocate read, as for the scalar kernels.
+*/
+#define MF_BYTES_PER_UPDATE (3*sizeof(double))
+
+int main(int argc,char *argv[])
+{
+  mf_grid A0, Anext;
+  double *init, *ref, *out;
+  int nx,ny,nz,tx,ty,tz,timesteps,ncomp;
+  int i,l,e;
+  long n, c;
+
+  ticks t1, t2;
+  double spt, best, updates, diff;
+
+  /* parse command line options */
+  if (argc < 8) {
+    printf("\nUSAGE:\n%s <grid x> <grid y> <grid z> <block x> <block y> <block z> <timesteps>\n", argv[0]);
+    printf("\nSTENCILPROBE_MF_COMPONENTS sets the components per cell (default 4).\n\n");
+    return EXIT_FAILURE;
+  }
+
+  nx = atoi(argv[1]);
+  ny = atoi(argv[2]);
+  nz = atoi(argv[3]);
+  tx = atoi(argv[4]);
+  ty = atoi(argv[5]);
+  tz = atoi(argv[6]);
+  timesteps = atoi(argv[7]);
+  ncomp = probe_param("MF_COMPONENTS", 4);
+  printf("%dx%dx%d, %d components, blocking: %dx%dx%d, timesteps: %d, AoSoA width: %d\n",
+	 nx,ny,nz,ncomp,tx,ty,tz,timesteps,MF_VLEN);
+
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+
+  /* one random initial state shared by every layout, plus the SoA naive result */
+  n = (long) nx * ny * nz;
+  init = (double*)malloc(sizeof(double)*n*ncomp);
+  ref = (double*)malloc(sizeof(double)*n*ncomp);
+  out = (double*)malloc(sizeof(double)*n*ncomp);
+  if (init == NULL || ref == NULL || out == NULL) {
+    printf("Error on multi-component reference malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (c=0;c<ncomp;c++)
+    StencilInit(nx,ny,nz,&init[c*n]);
+  updates = (double) (nx-2) * (ny-2) * (nz-2) * ncomp * timesteps;
+
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+
+  for (l=0;l<(int)(sizeof(layouts)/sizeof(layouts[0]));l++) {
+    MfAlloc(&A0, layouts[l].layout, ncomp, nx, ny, nz);
+    MfAlloc(&Anext, layouts[l].layout, ncomp, nx, ny, nz);
+
+    for (e=0;e<(int)(sizeof(engines)/sizeof(engines[0]));e++) {
+      best = -1;
+      for (i=0;i<NUM_TRIALS;i++) {
+	MfFromSoA(&A0, init);
+	MfFromSoA(&Anext, init);
+
+	t1 = getticks();
+	engines[e].kernel(&A0, &Anext, tx, ty, tz, timesteps);
+	t2 = getticks();
+
+	if (best < 0 || elapsed(t2, t1) < best)
+	  best = elapsed(t2, t1);
+      }
+
+      MfToSoA(timesteps % 2 == 0 ? &A0 : &Anext, out);
+      if (l == 0 && e == 0)
+	for (c=0;c<n*ncomp;c++)
+	  ref[c] = out[c];
+      diff = 0;
+      for (c=0;c<n*ncomp;c++)
+	if (fabs(out[c] - ref[c]) > diff)
+	  diff = fabs(out[c] - ref[c]);
+
+      printf("%-6s %-8s bytes:%-11ld best time:%-10g Mupdates/s:%-9.1f modeled GB/s:%-7.3g max diff vs SoA naive:%g \n",
+	     layouts[l].name, engines[e].name, mf_bytes(&A0), spt * best,
+	     updates / (spt * best) * 1e-6,
+	     MF_BYTES_PER_UPDATE * updates / (spt * best) / 1e9, diff);
+    }
+
+    MfFree(&A0);
+    MfFree(&Anext);
+  }
+
+  /* free arrays */
+  free(init);
+  free(ref);
+  free(out);
+  return EXIT_SUCCESS;
+}
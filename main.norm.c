@@ -0,0 +1,88 @@
+/*
+	Stencil Probe
+	Main function comparing the fused stencil + residual norm kernel with
+	the stencil followed by a separate norm pass.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "common.h"
+#include "util.h"
+#include "scratch.h"
+#include "norm.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+/* run.h has the run parameters */
+#include "run.h"
+
+int main(int argc,char *argv[])
+{
+  double *Anext;
+  double *A0;
+  stencil_norm fused, unfused;
+  int nx,ny,nz,tx,ty,tz,timesteps;
+  int i;
+  
+  ticks t1, t2, t3, t4;
+  double spt;
+  
+  /* parse command line options */
+  if (argc < 8) {
+    printf("\nUSAGE:\n%s <grid x> <grid y> <grid z> <block x> <block y> <block z> <timesteps>\n", argv[0]);
+    printf("\nThe norms are computed every timestep; the block sizes are ignored.\n\n");
+    return EXIT_FAILURE;
+  }
+  
+  nx = atoi(argv[1]);
+  ny = atoi(argv[2]);
+  nz = atoi(argv[3]);
+  tx = atoi(argv[4]);
+  ty = atoi(argv[5]);
+  tz = atoi(argv[6]);
+  timesteps = atoi(argv[7]);
+  printf("%dx%dx%d, blocking: %dx%dx%d, timesteps: %d\n",
+	 nx,ny,nz,tx,ty,tz,timesteps);
+  
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+  
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  
+  /* allocate arrays */ 
+  Anext=(double*)malloc(sizeof(double)*nx*ny*nz);
+  A0=(double*)malloc(sizeof(double)*nx*ny*nz);
+  
+  /* kernel scratch memory, allocated and touched once outside the timings */
+  ScratchInit(nx,ny,nz,tx,ty,timesteps);
+  
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+  
+  for (i=0;i<NUM_TRIALS;i++) {
+    /* StencilInit's random field is keyed by STENCILPROBE_SEED, not by
+       rand(), so both kernels start from the same data */
+    StencilInit(nx,ny,nz,Anext);
+    StencilInit(nx,ny,nz,A0);
+    t1 = getticks();
+    StencilProbe_norm(A0, Anext, nx, ny, nz, tx, ty, tz, timesteps, &fused);
+    t2 = getticks();
+    
+    StencilInit(nx,ny,nz,Anext);
+    StencilInit(nx,ny,nz,A0);
+    t3 = getticks();
+    StencilProbe_norm_unfused(A0, Anext, nx, ny, nz, tx, ty, tz, timesteps, &unfused);
+    t4 = getticks();
+    
+    printf("fused:   time:%g  l2:%.17g  max:%.17g \n", spt * elapsed(t2,t1), fused.l2, fused.max);
+    printf("unfused: time:%g  l2:%.17g  max:%.17g  (fused speedup %.3g) \n",
+	   spt * elapsed(t4,t3), unfused.l2, unfused.max, elapsed(t4,t3) / elapsed(t2,t1));
+  }
+  
+  /* free arrays */
+  free(Anext);
+  free(A0);
+  return EXIT_SUCCESS;
+}
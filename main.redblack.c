@@ -0,0 +1,121 @@
+/*
+	Stencil Probe
+	Main function comparing the in-place red-black smoothers with the
+	two-array Jacobi kernel for the same number of point updates.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "common.h"
+#include "util.h"
+#include "trace.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+/* run.h has the run parameters */
+#include "run.h"
+
+void StencilProbe_naive(double* A0, double* Anext, int nx, int ny, int nz,
+			int tx, int ty, int tz, int timesteps);
+void StencilProbe_redblack(double* A0, double* Anext, int nx, int ny, int nz,
+			   int tx, int ty, int tz, int timesteps);
+void StencilProbe_redblack_blocked(double* A0, double* Anext, int nx, int ny, int nz,
+				   int tx, int ty, int tz, int timesteps);
+void StencilProbe_redblack_wavefront(double* A0, double* Anext, int nx, int ny, int nz,
+				     int tx, int ty, int tz, int timesteps);
+
+/*
+  Modeled DRAM traffic in bytes per point update, assuming nothing but the
+  blocking working set survives in cache between passes:
+    Jacobi:             read A0, write Anext (plus its write-allocate read)
+    red-black sweeps:   every half-sweep reads and writes the whole grid,
+                        since both colors share each cache line
+    red-black wavefront: the grid is read and written once per call
+*/
+static const struct {
+  const char *name;
+  stencil_fn kernel;
+  int arrays;
+  double bytes_per_pass;
+  int passes_per_sweep;	/* 0: one pass per call */
+} variants[] = {
+  { "jacobi (two-array)",   StencilProbe_naive,              2, 3*sizeof(double), 1 },
+  { "red-black naive",      StencilProbe_redblack,           1, 2*sizeof(double), 2 },
+  { "red-black tiled",      StencilProbe_redblack_blocked,   1, 2*sizeof(double), 2 },
+  { "red-black wavefront",  StencilProbe_redblack_wavefront, 1, 2*sizeof(double), 0 },
+};
+
+int main(int argc,char *argv[])
+{
+  double *Anext;
+  double *A0;
+  int nx,ny,nz,tx,ty,tz,timesteps;
+  int i,v;
+  
+  ticks t1, t2;
+  double spt, best, updates, bytes;
+  
+  /* parse command line options */
+  if (argc < 8) {
+    printf("\nUSAGE:\n%s <grid x> <grid y> <grid z> <block x> <block y> <block z> <timesteps>\n", argv[0]);
+    printf("\nEach timestep is one Jacobi step or one full red-black sweep.\n\n");
+    return EXIT_FAILURE;
+  }
+  
+  nx = atoi(argv[1]);
+  ny = atoi(argv[2]);
+  nz = atoi(argv[3]);
+  tx = atoi(argv[4]);
+  ty = atoi(argv[5]);
+  tz = atoi(argv[6]);
+  timesteps = atoi(argv[7]);
+  printf("%dx%dx%d, blocking: %dx%dx%d, timesteps: %d\n",
+	 nx,ny,nz,tx,ty,tz,timesteps);
+  
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+  
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  /* tile timelines when STENCILPROBE_TRACE is set */
+  TraceInit(spt);
+  
+  /* allocate arrays */ 
+  Anext=(double*)malloc(sizeof(double)*nx*ny*nz);
+  A0=(double*)malloc(sizeof(double)*nx*ny*nz);
+  updates = (double) (nx-2) * (ny-2) * (nz-2) * timesteps;
+  
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+  
+  for (v=0;v<(int)(sizeof(variants)/sizeof(variants[0]));v++) {
+    best = -1;
+    for (i=0;i<NUM_TRIALS;i++) {
+      StencilInit(nx,ny,nz,Anext);
+      StencilInit(nx,ny,nz,A0);
+      
+      t1 = getticks();
+      variants[v].kernel(A0, Anext, nx, ny, nz, tx, ty, tz, timesteps);
+      t2 = getticks();
+      
+      if (best < 0 || elapsed(t2, t1) < best)
+	best = elapsed(t2, t1);
+    }
+    
+    if (variants[v].passes_per_sweep)
+      bytes = variants[v].bytes_per_pass * variants[v].passes_per_sweep * updates;
+    else
+      bytes = variants[v].bytes_per_pass * updates / timesteps;
+    
+    printf("%-22s arrays:%d  best time:%g  ns/update:%g  modeled bytes/update:%g  modeled GB/s:%g \n",
+	   variants[v].name, variants[v].arrays, spt * best,
+	   1e9 * spt * best / updates, bytes / updates,
+	   bytes / (spt * best) / 1e9);
+  }
+  
+  /* free arrays */
+  free(Anext);
+  free(A0);
+  return EXIT_SUCCESS;
+}
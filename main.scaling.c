@@ -0,0 +1,276 @@
+/*
+	Stencil Probe
+	Strong/weak scaling and grid-size sweeps for the registered kernels.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "common.h"
+#include "util.h"
+#include "trace.h"
+#include "scratch.h"
+#include "topology.h"
+#include "circqueue.h"
+#include "pool.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+/* run.h has the run parameters */
+#include "run.h"
+
+void StencilProbe_naive(double* A0, double* Anext, int nx, int ny, int nz,
+			int tx, int ty, int tz, int timesteps);
+void StencilProbe_rivera(double* A0, double* Anext, int nx, int ny, int nz,
+			 int tx, int ty, int tz, int timesteps);
+void StencilProbe_timeskew(double* A0, double* Anext, int nx, int ny, int nz,
+			   int tx, int ty, int tz, int timesteps);
+void StencilProbe_circqueue(double* A0, double* Anext, int nx, int ny, int nz,
+			    int tx, int ty, int tz, int timesteps);
+void StencilProbe_oblivious(double* A0, double* Anext, int nx, int ny, int nz,
+			    int tx, int ty, int tz, int timesteps);
+void StencilProbe_oblivious_tuned(double* A0, double* Anext, int nx, int ny, int nz,
+				  int tx, int ty, int tz, int timesteps);
+void StencilProbe_stream(double* A0, double* Anext, int nx, int ny, int nz,
+			 int tx, int ty, int tz, int timesteps);
+void StencilProbe_redblack_blocked(double* A0, double* Anext, int nx, int ny, int nz,
+				   int tx, int ty, int tz, int timesteps);
+void StencilProbe_redblack_wavefront(double* A0, double* Anext, int nx, int ny, int nz,
+				     int tx, int ty, int tz, int timesteps);
+
+static const struct {
+  const char *name;
+  stencil_fn kernel;
+  int queues;	/* needs CircularQueueInit before each run */
+} kernels[] = {
+  { "naive",              StencilProbe_naive,              0 },
+  { "blocked",            StencilProbe_rivera,             0 },
+  { "timeskew",           StencilProbe_timeskew,           0 },
+  { "circqueue",          StencilProbe_circqueue,          1 },
+  { "oblivious",          StencilProbe_oblivious,          0 },
+  { "oblivious_tuned",    StencilProbe_oblivious_tuned,    0 },
+  { "stream",             StencilProbe_stream,             0 },
+  { "redblack_blocked",   StencilProbe_redblack_blocked,   0 },
+  { "redblack_wavefront", StencilProbe_redblack_wavefront, 0 },
+};
+#define NKERNELS ((int) (sizeof(kernels)/sizeof(kernels[0])))
+
+/* a throughput drop larger than this between sweep points is flagged */
+#define CLIFF_RATIO 0.75
+
+static int k, tx, ty, tz, timesteps;
+static double spt;
+
+static int gcd(int a, int b) {
+  return b == 0 ? a : gcd(b, a % b);
+}
+
+/* rounds a grid edge up so that the interior is a multiple of every block edge */
+static int round_grid(int n) {
+  int m = tx / gcd(tx, ty) * ty;
+
+  m = m / gcd(m, tz) * tz;
+  if (n < 3) n = 3;
+  return 2 + (n - 2 + m - 1) / m * m;
+}
+
+static void set_threads(int t) {
+#ifdef _OPENMP
+  omp_set_num_threads(t);
+#endif
+  TopoPin();
+}
+
+/* best time in seconds over NUM_TRIALS runs of the selected kernel */
+static double run(int nx, int ny, int nz) {
+  double *A0, *Anext, best = -1;
+  ticks t1, t2;
+  int i;
+
+  Anext = (double*) malloc(sizeof(double)*nx*ny*nz);
+  A0 = (double*) malloc(sizeof(double)*nx*ny*nz);
+  if (A0 == NULL || Anext == NULL) {
+    printf("Error on grid malloc (%dx%dx%d).\n", nx, ny, nz);
+    exit(EXIT_FAILURE);
+  }
+  TopoBindGrid(Anext, nx, ny, nz);
+  TopoBindGrid(A0, nx, ny, nz);
+
+  for (i=0;i<NUM_TRIALS;i++) {
+    StencilInit(nx,ny,nz,Anext);
+    StencilInit(nx,ny,nz,A0);
+    if (kernels[k].queues && timesteps > 1)
+      CircularQueueInit(nx, ty, timesteps);
+
+    t1 = getticks();
+    kernels[k].kernel(A0, Anext, nx, ny, nz, tx, ty, tz, timesteps);
+    t2 = getticks();
+    if (best < 0 || spt * elapsed(t2, t1) < best)
+      best = spt * elapsed(t2, t1);
+  }
+
+  free(Anext);
+  free(A0);
+  return best;
+}
+
+static double mpoints(int nx, int ny, int nz, double t) {
+  return (double) (nx-2) * (ny-2) * (nz-2) * timesteps / t * 1e-6;
+}
+
+/* the innermost cache level a working set fits in */
+static const char *residence(double bytes) {
+  static const char *names[] = { "L1", "L2", "L3" };
+  int l;
+
+  for (l = 1; l <= 3; l++)
+    if (cache_size(l) > 0 && bytes <= cache_size(l))
+      return names[l-1];
+  return "DRAM";
+}
+
+static void thread_sweep(int weak, int maxthreads) {
+  int n, t, nz, last = 0;
+  double t0 = 0, tt, eff;
+
+  n = round_grid(weak ? probe_param("SCALING_WEAK_N", 256) : probe_param("SCALING_N", 512));
+  if (weak)
+    printf("weak scaling: %s, %dx%dx(%d per thread), blocking: %dx%dx%d, timesteps: %d\n",
+	   kernels[k].name, n, n, n-2, tx, ty, tz, timesteps);
+  else
+    printf("strong scaling: %s, %dx%dx%d, blocking: %dx%dx%d, timesteps: %d\n",
+	   kernels[k].name, n, n, n, tx, ty, tz, timesteps);
+  printf("%-8s %-14s %-12s %-12s %-10s %-10s\n",
+	 "threads", "size", "time(s)", "Mpoints/s", "speedup", "efficiency");
+  // scratch for the largest grid, on every thread of the widest run
+  ScratchInit(n, n, weak ? (n-2) * maxthreads + 2 : n, tx, ty, timesteps);
+
+  for (t = 1; last < maxthreads; t *= 2) {
+    char size[32];
+
+    if (t > maxthreads)
+      t = maxthreads;
+    last = t;
+    set_threads(t);
+    nz = weak ? (n-2) * t + 2 : n;
+    tt = run(n, n, nz);
+    if (t == 1)
+      t0 = tt;
+    // weak scaling keeps the work per thread, so the ideal time is flat
+    eff = weak ? t0 / tt : t0 / (t * tt);
+    snprintf(size, sizeof(size), "%dx%dx%d", n, n, nz);
+    printf("%-8d %-14s %-12.4g %-12.1f %-10.2f %-10.2f\n", t, size, tt,
+	   mpoints(n, n, nz, tt), weak ? t * t0 / tt : t0 / tt, eff);
+  }
+}
+
+/* cubic grids whose two arrays double in size from L2/4 to 4x the LLC */
+static void size_sweep(int threads) {
+  double lo, hi, ws, bytes, rate, prev = 0;
+  const char *where, *prev_where = NULL;
+  int n, prev_n = 0;
+
+  lo = cache_size(2) > 0 ? cache_size(2) / 4.0 : 256.0 * 1024;
+  hi = cache_size(3) > 0 ? 4.0 * cache_size(3) : 4.0 * cache_size(2);
+  if (hi < 64.0 * 1024 * 1024)
+    hi = 64.0 * 1024 * 1024;
+
+  set_threads(threads);
+  // scratch for the largest grid the sweep can reach
+  n = round_grid((int) cbrt(hi / (2 * sizeof(double))));
+  ScratchInit(n, n, n, tx, ty, timesteps);
+  printf("grid-size sweep: %s, %d threads, blocking: %dx%dx%d, timesteps: %d\n",
+	 kernels[k].name, threads, tx, ty, tz, timesteps);
+  printf("%-6s %-12s %-6s %-12s %-12s\n", "size", "bytes", "fits", "time(s)", "Mpoints/s");
+
+  for (ws = lo; ws <= hi; ws *= 2) {
+    n = round_grid((int) cbrt(ws / (2 * sizeof(double))));
+    if (n == prev_n)
+      continue;
+    prev_n = n;
+    // the rounded grid's working set; ws keeps doubling from lo
+    bytes = 2.0 * sizeof(double) * n * n * n;
+    where = residence(bytes);
+    if (prev_where != NULL && strcmp(where, prev_where) != 0)
+      printf("-- working set leaves %s --\n", prev_where);
+    prev_where = where;
+
+    rate = mpoints(n, n, n, run(n, n, n));
+    printf("%-6d %-12.0f %-6s %-12.4g %-12.1f%s\n", n, bytes, where,
+	   (double) (n-2) * (n-2) * (n-2) * timesteps / rate * 1e-6, rate,
+	   prev > 0 && rate < CLIFF_RATIO * prev ? "  <- cliff" : "");
+    prev = rate;
+  }
+}
+
+int main(int argc,char *argv[])
+{
+  int maxthreads = 1;
+  const char *mode;
+
+  /* parse command line options */
+  if (argc < 7) {
+    printf("\nUSAGE:\n%s <kernel> <strong|weak|size> <block x> <block y> <block z> <timesteps> [<max threads>]\n", argv[0]);
+    printf("\nKERNELS:\n");
+    for (k=0;k<NKERNELS;k++)
+      printf("  %s\n", kernels[k].name);
+    printf("\nstrong: STENCILPROBE_SCALING_N^3 grid (default 512) on 1, 2, 4, ... threads\n");
+    printf("weak:   STENCILPROBE_SCALING_WEAK_N^2 x (N-2) interior planes per thread (default 256)\n");
+    printf("size:   cubic grids from a quarter of L2 to 4x the last level cache, on <max threads>\n");
+    printf("\nGrid edges are rounded up so the interior is a multiple of the block sizes.\n\n");
+    return EXIT_FAILURE;
+  }
+
+  for (k=0;k<NKERNELS;k++)
+    if (strcmp(argv[1], kernels[k].name) == 0)
+      break;
+  if (k == NKERNELS) {
+    printf("Error: unknown kernel %s.\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  mode = argv[2];
+  tx = atoi(argv[3]);
+  ty = atoi(argv[4]);
+  tz = atoi(argv[5]);
+  timesteps = atoi(argv[6]);
+#ifdef _OPENMP
+  maxthreads = omp_get_max_threads();
+#endif
+  if (argc > 7)
+    maxthreads = atoi(argv[7]);
+  if (maxthreads < 1)
+    maxthreads = 1;
+
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  /* tile timelines when STENCILPROBE_TRACE is set */
+  TraceInit(spt);
+  /* the single-sweep kernels run threaded here (pool.h) */
+  PoolThreaded();
+
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+  set_threads(maxthreads);
+  TopoReport();
+
+  if (strcmp(mode, "strong") == 0)
+    thread_sweep(0, maxthreads);
+  else if (strcmp(mode, "weak") == 0)
+    thread_sweep(1, maxthreads);
+  else if (strcmp(mode, "size") == 0)
+    size_sweep(maxthreads);
+  else {
+    printf("Error: unknown mode %s.\n", mode);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -6,8 +6,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "common.h"
 #include "util.h"
+#include "scratch.h"
+#include "batch.h"
+#include "amr.h"
+#include "mg.h"
+#include "norm.h"
+#include "circqueue.h"
+#include "coef.h"
+#include "multifield.h"
+#include "brick.h"
+#include "halo.h"
+#include "tune.h"
+#include "pool.h"
+#include "init.h"
+#include "bench.h"
+#include "boundary.h"
+#include "active.h"
+#include "energy.h"
 #include "cycle.h"
 #ifdef HAVE_PAPI
 #include <papi.h>
@@ -18,6 +40,91 @@
 void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
                   int tx, int ty, int tz, int timesteps);
 void check_vals(double* A, double* B, int nx, int ny, int nz);
+void StencilProbe_naive(double* A0, double* Anext, int nx, int ny, int nz,
+			int tx, int ty, int tz, int timesteps);
+void StencilProbe_rivera(double* A0, double* Anext, int nx, int ny, int nz,
+			 int tx, int ty, int tz, int timesteps);
+void StencilProbe_timeskew(double* A0, double* Anext, int nx, int ny, int nz,
+			   int tx, int ty, int tz, int timesteps);
+void StencilProbe_circqueue(double* A0, double* Anext, int nx, int ny, int nz,
+			    int tx, int ty, int tz, int timesteps);
+void StencilProbe_oblivious(double* A0, double* Anext, int nx, int ny, int nz,
+			    int tx, int ty, int tz, int timesteps);
+void StencilProbe_oblivious_tuned(double* A0, double* Anext, int nx, int ny, int nz,
+				  int tx, int ty, int tz, int timesteps);
+void StencilProbe_stream(double* A0, double* Anext, int nx, int ny, int nz,
+			 int tx, int ty, int tz, int timesteps);
+void StencilProbe_varcoef(double* A0, double* Anext, int nx, int ny, int nz,
+			  int tx, int ty, int tz, int timesteps);
+void StencilProbe_varcoef_timeskew(double* A0, double* Anext, int nx, int ny, int nz,
+				   int tx, int ty, int tz, int timesteps);
+void StencilProbe_varcoef_circqueue(double* A0, double* Anext, int nx, int ny, int nz,
+				    int tx, int ty, int tz, int timesteps);
+void StencilProbe_redblack(double* A0, double* Anext, int nx, int ny, int nz,
+			   int tx, int ty, int tz, int timesteps);
+void StencilProbe_redblack_blocked(double* A0, double* Anext, int nx, int ny, int nz,
+				   int tx, int ty, int tz, int timesteps);
+void StencilProbe_redblack_wavefront(double* A0, double* Anext, int nx, int ny, int nz,
+				     int tx, int ty, int tz, int timesteps);
+
+/* where a read of index i in 0..n-1 lands under boundary condition kind */
+static int bc_map(int i, int n, int kind) {
+  if (i == 0)
+    return kind == BC_PERIODIC ? n - 2 : 1;
+  if (i == n - 1)
+    return kind == BC_PERIODIC ? 1 : n - 2;
+  return i;
+}
+
+/*
+  The naive sweep reading ghosts through bc_map instead of the shell,
+  then the ghost faces of the result filled the same way.  Returns the
+  array holding the result.
+*/
+static double *bc_reference(double *A0, double *Anext, int nx, int ny, int nz,
+			    int timesteps, int kind) {
+  double fac = A0[0], *tmp;
+  int i, j, k, t;
+
+  for (t = 0; t < timesteps; t++) {
+    for (k = 1; k < nz - 1; k++)
+      for (j = 1; j < ny - 1; j++)
+	for (i = 1; i < nx - 1; i++)
+	  Anext[Index3D(nx,ny,i,j,k)] =
+	    A0[Index3D(nx,ny,i,j,bc_map(k+1,nz,kind))] +
+	    A0[Index3D(nx,ny,i,j,bc_map(k-1,nz,kind))] +
+	    A0[Index3D(nx,ny,i,bc_map(j+1,ny,kind),k)] +
+	    A0[Index3D(nx,ny,i,bc_map(j-1,ny,kind),k)] +
+	    A0[Index3D(nx,ny,bc_map(i+1,nx,kind),j,k)] +
+	    A0[Index3D(nx,ny,bc_map(i-1,nx,kind),j,k)]
+	    - 6.0 * A0[Index3D(nx,ny,i,j,k)] / (fac*fac);
+    for (k = 0; k < nz; k++)
+      for (j = 0; j < ny; j++)
+	for (i = 0; i < nx; i++)
+	  // faces only: exactly one index on the shell
+	  if ((i == 0 || i == nx-1) + (j == 0 || j == ny-1) + (k == 0 || k == nz-1) == 1)
+	    Anext[Index3D(nx,ny,i,j,k)] =
+	      Anext[Index3D(nx,ny,bc_map(i,nx,kind),bc_map(j,ny,kind),bc_map(k,nz,kind))];
+    tmp = A0;
+    A0 = Anext;
+    Anext = tmp;
+  }
+  return A0;
+}
+
+/* writes text to dir/name */
+static void put_file(const char *dir, const char *name, const char *text) {
+  char path[512];
+  FILE *f;
+
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  if ((f = fopen(path, "w")) == NULL) {
+    printf("Error: cannot write %s.\n", path);
+    exit(EXIT_FAILURE);
+  }
+  fputs(text, f);
+  fclose(f);
+}
 
 int main(int argc,char *argv[]) {
   double *A0_naive, *A0_test;
@@ -60,10 +167,23 @@ int main(int argc,char *argv[]) {
   Anext_naive=(double*)malloc(sizeof(double)*nx*ny*nz);
   Anext_test=(double*)malloc(sizeof(double)*nx*ny*nz);
 
-  // Run Naive Code
+  // scratch for every thread the tests use: the pool tests below run 3
+#ifdef _OPENMP
+  i = omp_get_max_threads();
+  if (i < 3)
+    omp_set_num_threads(3);
+#endif
+  ScratchInit(nx,ny,nz,tx,ty,timesteps);
+#ifdef _OPENMP
+  omp_set_num_threads(i);
+#endif
+
+  // Run Naive Code, serial: the reference every other check compares against
+  PoolSetSync(SYNC_SERIAL);
   StencilInit(nx,ny,nz,A0_naive);
   StencilInit(nx,ny,nz,Anext_naive);
   StencilProbe_naive(A0_naive, Anext_naive, nx, ny, nz, tx, ty, tz, timesteps);
+  PoolSetSync(-1);
   if (timesteps%2 == 0) {
     Afinal_naive = A0_naive;
   }
@@ -85,6 +205,210 @@ int main(int argc,char *argv[]) {
     Afinal_test = Anext_test;
   }
   check_vals(Afinal_naive, Afinal_test, nx, ny, nz);
+
+  // Test every pool synchronization against the serial loop, with more
+  // threads than the default so the slabs have interior neighbors
+  {
+    double *ref0 = (double*)malloc(sizeof(double)*nx*ny*nz);
+    double *ref1 = (double*)malloc(sizeof(double)*nx*ny*nz);
+    double *ref;
+    int mode, threads = 1;
+
+    if (ref0 == NULL || ref1 == NULL) {
+      printf("Error on pool test malloc.\n");
+      exit(EXIT_FAILURE);
+    }
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+    omp_set_num_threads(3);
+#endif
+    PoolSetSync(SYNC_SERIAL);
+    StencilInit(nx,ny,nz,ref0);
+    StencilInit(nx,ny,nz,ref1);
+    StencilProbe_naive(ref0, ref1, nx, ny, nz, tx, ty, tz, timesteps);
+    ref = timesteps%2 == 0 ? ref0 : ref1;
+    for (mode = SYNC_FORK; mode < SYNC_MODES; mode++) {
+      PoolSetSync(mode);
+      StencilInit(nx,ny,nz,A0_test);
+      StencilInit(nx,ny,nz,Anext_test);
+      printf("Checking naive with %s synchronization...\n", sync_name(mode));
+      StencilProbe_naive(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+      check_vals(ref, timesteps%2 == 0 ? A0_test : Anext_test, nx, ny, nz);
+      StencilInit(nx,ny,nz,A0_test);
+      StencilInit(nx,ny,nz,Anext_test);
+      printf("Checking Rivera blocking with %s synchronization...\n", sync_name(mode));
+      StencilProbe_rivera(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+      check_vals(ref, timesteps%2 == 0 ? A0_test : Anext_test, nx, ny, nz);
+    }
+    PoolSetSync(-1);
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    free(ref0);
+    free(ref1);
+  }
+  
+  // Test periodic and zero-flux boundaries in the kernels that apply them
+  // (3 threads, so the pool's periodic ring is exercised) against a sweep
+  // that reads the ghosts through the boundary mapping
+  {
+    double *ref0 = (double*)malloc(sizeof(double)*nx*ny*nz);
+    double *ref1 = (double*)malloc(sizeof(double)*nx*ny*nz);
+    double *ref;
+    init_field f;
+    int kind, e, threads = 1;
+
+    if (ref0 == NULL || ref1 == NULL) {
+      printf("Error on boundary test malloc.\n");
+      exit(EXIT_FAILURE);
+    }
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+    omp_set_num_threads(3);
+#endif
+    PoolSetSync(SYNC_NEIGHBOR);
+    InitFromEnv(&f, INIT_RANDOM);
+    f.kind = INIT_RANDOM;
+    for (kind = BC_PERIODIC; kind < BC_KINDS; kind++) {
+      BoundarySet(kind);
+      InitField(nx, ny, nz, ref0, &f);
+      InitField(nx, ny, nz, ref1, &f);
+      ref0[0] = 1.0;
+      ref = bc_reference(ref0, ref1, nx, ny, nz, timesteps, kind);
+      for (e = 0; e < 3; e++) {
+	InitField(nx, ny, nz, A0_test, &f);
+	InitField(nx, ny, nz, Anext_test, &f);
+	A0_test[0] = 1.0;
+	printf("Checking %s with %s boundaries...\n",
+	       e == 0 ? "naive" : e == 1 ? "Rivera blocking" : "2.5D plane-streaming", bc_name(kind));
+	if (e == 0)
+	  StencilProbe_naive(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+	else if (e == 1)
+	  StencilProbe_rivera(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+	else
+	  StencilProbe_stream(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+	check_vals(ref, timesteps%2 == 0 ? A0_test : Anext_test, nx, ny, nz);
+      }
+    }
+    BoundarySet(-1);
+    PoolSetSync(-1);
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    free(ref0);
+    free(ref1);
+  }
+  
+  // Test active tiles: Rivera on a box field with skipping on against the
+  // full sweep, under each boundary condition (3 threads, neighbor sync)
+  // and with fixed ghosts that differ between the two arrays
+  {
+    double *ref0 = (double*)malloc(sizeof(double)*nx*ny*nz);
+    double *ref1 = (double*)malloc(sizeof(double)*nx*ny*nz);
+    init_field f, g;
+    long computed, skipped, all = 0;
+    int e, threads = 1;
+
+    if (ref0 == NULL || ref1 == NULL) {
+      printf("Error on active tile test malloc.\n");
+      exit(EXIT_FAILURE);
+    }
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+    omp_set_num_threads(3);
+#endif
+    PoolSetSync(SYNC_NEIGHBOR);
+    InitFromEnv(&f, INIT_BOX);
+    f.kind = INIT_BOX;
+    f.width = 30;
+    g = f;
+    for (e = 0; e < BC_KINDS + 1; e++) {
+      // the last case fills Anext with another field, so its ghosts differ
+      g.kind = e == BC_KINDS ? INIT_GAUSSIAN : INIT_BOX;
+      BoundarySet(e == BC_KINDS ? BC_DIRICHLET : e);
+      ActiveSet(0);
+      InitField(nx, ny, nz, ref0, &f);
+      InitField(nx, ny, nz, ref1, &g);
+      // a second source off center, two planes from the top, so that
+      // activity reaches the bottom planes only through periodic ghosts
+      ref0[Index3D(nx,ny,nx-3,ny-3,nz-3)] = 1.0;
+      StencilProbe_rivera(ref0, ref1, nx, ny, nz, tx, ty, tz, timesteps);
+      ActiveSet(1);
+      ActiveReset();
+      InitField(nx, ny, nz, A0_test, &f);
+      InitField(nx, ny, nz, Anext_test, &g);
+      A0_test[Index3D(nx,ny,nx-3,ny-3,nz-3)] = 1.0;
+      printf("Checking Rivera blocking with active tiles, %s boundaries%s...\n",
+	     bc_name(e == BC_KINDS ? BC_DIRICHLET : e), e == BC_KINDS ? " differing between arrays" : "");
+      StencilProbe_rivera(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+      check_vals(timesteps%2 == 0 ? ref0 : ref1, timesteps%2 == 0 ? A0_test : Anext_test, nx, ny, nz);
+      ActiveTotals(&computed, &skipped);
+      if (e < BC_KINDS)
+	all += skipped;
+    }
+    printf("Checking active tiles skip quiet tiles: %ld skipped... %s\n", all, all > 0 ? "PASS" : "FAIL");
+    BoundarySet(-1);
+
+    // batched patches run Rivera side by side, box and random fields
+    // alternating, each against its own skipping-free run
+    {
+      grid_desc grids[8];
+      double *pref[8];
+      long size = (long) nx * ny * nz;
+
+      for (e = 0; e < 8; e++) {
+	g = f;
+	g.kind = e % 2 ? INIT_RANDOM : INIT_BOX;
+	g.width = 20 + 10 * (e / 2);
+	grids[e].nx = nx;
+	grids[e].ny = ny;
+	grids[e].nz = nz;
+	grids[e].A0 = (double*)malloc(sizeof(double)*size);
+	grids[e].Anext = (double*)malloc(sizeof(double)*size);
+	pref[e] = (double*)malloc(sizeof(double)*size);
+	if (grids[e].A0 == NULL || grids[e].Anext == NULL || pref[e] == NULL) {
+	  printf("Error on active tile batch test malloc.\n");
+	  exit(EXIT_FAILURE);
+	}
+	ActiveSet(0);
+	InitField(nx, ny, nz, ref0, &g);
+	InitField(nx, ny, nz, ref1, &g);
+	StencilProbe_rivera(ref0, ref1, nx, ny, nz, tx, ty, tz, timesteps);
+	memcpy(pref[e], timesteps%2 == 0 ? ref0 : ref1, sizeof(double)*size);
+	InitField(nx, ny, nz, grids[e].A0, &g);
+	InitField(nx, ny, nz, grids[e].Anext, &g);
+      }
+      ActiveSet(1);
+      printf("Checking batched Rivera blocking with active tiles...\n");
+      StencilProbe_batch(grids, 8, StencilProbe_rivera, tx, ty, tz, timesteps, NULL);
+      for (e = 0; e < 8; e++) {
+	check_vals(pref[e], timesteps%2 == 0 ? grids[e].A0 : grids[e].Anext, nx, ny, nz);
+	free(grids[e].A0);
+	free(grids[e].Anext);
+	free(pref[e]);
+      }
+    }
+    ActiveSet(-1);
+    PoolSetSync(-1);
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    free(ref0);
+    free(ref1);
+  }
+  
+  // Test 2.5D Plane-Streaming Blocking
+  StencilInit(nx,ny,nz,A0_test);
+  StencilInit(nx,ny,nz,Anext_test);
+  printf("Checking 2.5D plane-streaming blocking...\n");
+  StencilProbe_stream(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+  if (timesteps%2 == 0) {
+    Afinal_test = A0_test;
+  }
+  else {
+    Afinal_test = Anext_test;
+  }
+  check_vals(Afinal_naive, Afinal_test, nx, ny, nz);
   
   // Test Cache-Oblivious Blocking
   StencilInit(nx,ny,nz,A0_test);
@@ -99,6 +423,19 @@ int main(int argc,char *argv[]) {
   }
   check_vals(Afinal_naive, Afinal_test, nx, ny, nz);
   
+  // Test Tuned Cache-Oblivious Blocking
+  StencilInit(nx,ny,nz,A0_test);
+  StencilInit(nx,ny,nz,Anext_test);
+  printf("Checking Tuned Cache-Oblivious blocking...\n");
+  StencilProbe_oblivious_tuned(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+  if (timesteps%2 == 0) {
+    Afinal_test = A0_test;
+  }
+  else {
+    Afinal_test = Anext_test;
+  }
+  check_vals(Afinal_naive, Afinal_test, nx, ny, nz);
+  
   // Test Time-Skewed Blocking
   StencilInit(nx,ny,nz,A0_test);
   StencilInit(nx,ny,nz,Anext_test);
@@ -112,6 +449,100 @@ int main(int argc,char *argv[]) {
   }
   check_vals(Afinal_naive, Afinal_test, nx, ny, nz);
 
+  // Test fused residual norm: same grid as naive, same norm as the two-pass version
+  {
+    stencil_norm fused, unfused;
+
+    StencilInit(nx,ny,nz,A0_test);
+    StencilInit(nx,ny,nz,Anext_test);
+    printf("Checking fused residual norm...\n");
+    StencilProbe_norm(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps, &fused);
+    if (timesteps%2 == 0) {
+      Afinal_test = A0_test;
+    }
+    else {
+      Afinal_test = Anext_test;
+    }
+    check_vals(Afinal_naive, Afinal_test, nx, ny, nz);
+    StencilInit(nx,ny,nz,A0_test);
+    StencilInit(nx,ny,nz,Anext_test);
+    StencilProbe_norm_unfused(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps, &unfused);
+    printf("Norms l2 %g max %g, unfused l2 %g max %g: %s\n",
+	   fused.l2, fused.max, unfused.l2, unfused.max,
+	   (fused.l2 == unfused.l2 && fused.max == unfused.max) ? "PASS" : "FAIL");
+  }
+
+  // Test batched execution: several copies of the grid as independent patches
+  {
+    grid_desc grids[5];
+    int g;
+
+    printf("Checking batched small-grid execution...\n");
+    for (g=0; g<5; g++) {
+      grids[g].nx = nx;
+      grids[g].ny = ny;
+      grids[g].nz = nz;
+      grids[g].A0 = (double*)malloc(sizeof(double)*nx*ny*nz);
+      grids[g].Anext = (double*)malloc(sizeof(double)*nx*ny*nz);
+      StencilInit(nx,ny,nz,grids[g].A0);
+      StencilInit(nx,ny,nz,grids[g].Anext);
+    }
+    StencilProbe_batch(grids, 5, StencilProbe_rivera, tx, ty, tz, timesteps, NULL);
+    for (g=0; g<5; g++) {
+      check_vals(Afinal_naive, (timesteps%2 == 0) ? grids[g].A0 : grids[g].Anext,
+		 nx, ny, nz);
+      free(grids[g].A0);
+      free(grids[g].Anext);
+    }
+  }
+
+  // Test nested grids: the interior kernel must not change the result
+  {
+    amr_level ref[AMR_MAX_LEVELS], test[AMR_MAX_LEVELS];
+    int l;
+
+    printf("Checking nested-grid (AMR) levels...\n");
+    AmrInit(ref, AMR_MAX_LEVELS, nx, ny, nz);
+    AmrInit(test, AMR_MAX_LEVELS, nx, ny, nz);
+    StencilProbe_amr(ref, AMR_MAX_LEVELS, StencilProbe_naive, tx, ty, tz, timesteps, NULL);
+    StencilProbe_amr(test, AMR_MAX_LEVELS, StencilProbe_rivera, tx, ty, tz, timesteps, NULL);
+    for (l=0; l<AMR_MAX_LEVELS; l++)
+      check_vals(ref[l].A0, test[l].A0, ref[l].nx, ref[l].ny, ref[l].nz);
+    AmrFree(ref, AMR_MAX_LEVELS);
+    AmrFree(test, AMR_MAX_LEVELS);
+  }
+
+  // Interpolating a constant or linear coarse field and restricting it back
+  // must reproduce the field to round-off
+  {
+    amr_level lev[2];
+    double *save, err = 0, v;
+    int c, i, j, k;
+
+    AmrInit(lev, 2, nx, ny, nz);
+    save = (double*)malloc(sizeof(double)*nx*ny*nz);
+    for (c = 0; c < 2; c++) {
+      for (k=0; k<nz; k++)
+	for (j=0; j<ny; j++)
+	  for (i=0; i<nx; i++)
+	    save[Index3D(nx,ny,i,j,k)] = lev[0].A0[Index3D(nx,ny,i,j,k)] =
+	      c == 0 ? 2.5 : 1 + 0.5*i - 0.25*j + 0.125*k;
+      AmrInterpolate(&lev[0], &lev[1]);
+      AmrRestrict(&lev[0], &lev[1]);
+      for (k=0; k<nz; k++)
+	for (j=0; j<ny; j++)
+	  for (i=0; i<nx; i++) {
+	    v = fabs(lev[0].A0[Index3D(nx,ny,i,j,k)] - save[Index3D(nx,ny,i,j,k)]);
+	    if (v > err)
+	      err = v;
+	  }
+    }
+    printf("AMR interpolate then restrict, constant and linear fields: max error %.3g: %s\n",
+	   err, err < 1e-12 * (nx + ny + nz) ? "PASS" : "FAIL");
+    free(save);
+    AmrFree(lev, 2);
+  }
+
   // Test Circular-Queue Blocking
   StencilInit(nx,ny,nz,A0_test);
   StencilInit(nx,ny,nz,Anext_test);
@@ -123,6 +554,366 @@ int main(int argc,char *argv[]) {
   Afinal_test = Anext_test;
   check_vals(Afinal_naive, Afinal_test, nx, ny, nz);
   
+  // Test the bricked kernels in every brick order, and that consecutive
+  // Hilbert bricks share a face
+  {
+    brick_grid A, B;
+    int order, s, d;
+
+    for (order=BRICK_LEX; order<=BRICK_HILBERT; order++) {
+      BrickAlloc(&A, order, nx, ny, nz);
+      BrickAlloc(&B, order, nx, ny, nz);
+      StencilInit(nx,ny,nz,A0_test);
+      StencilInit(nx,ny,nz,Anext_test);
+      printf("Checking %s-ordered bricks...\n", brick_order_name(order));
+      BrickFromLinear(&A, A0_test);
+      BrickFromLinear(&B, Anext_test);
+      StencilProbe_brick_naive(&A, &B, tx, ty, tz, timesteps);
+      BrickToLinear((timesteps%2 == 0) ? &A : &B, A0_test);
+      check_vals(Afinal_naive, A0_test, nx, ny, nz);
+
+      StencilInit(nx,ny,nz,A0_test);
+      printf("Checking %s-ordered bricks, blocked...\n", brick_order_name(order));
+      BrickFromLinear(&A, A0_test);
+      BrickFromLinear(&B, A0_test);
+      StencilProbe_brick_blocked(&A, &B, tx, ty, tz, timesteps);
+      BrickToLinear((timesteps%2 == 0) ? &A : &B, A0_test);
+      check_vals(Afinal_naive, A0_test, nx, ny, nz);
+      BrickFree(&A);
+      BrickFree(&B);
+    }
+
+    BrickAlloc(&A, BRICK_HILBERT, 8*BRICK_DIM, 8*BRICK_DIM, 8*BRICK_DIM);
+    for (s=1, i=0; s<A.nbx*A.nby*A.nbz; s++) {
+      int a = A.brick[s-1], b = A.brick[s];
+      d = abs(a % A.nbx - b % A.nbx) + abs(a / A.nbx % A.nby - b / A.nbx % A.nby)
+	+ abs(a / (A.nbx*A.nby) - b / (A.nbx*A.nby));
+      if (d != 1)
+	i++;
+    }
+    printf("Hilbert brick order, %d steps between non-adjacent bricks: %s\n", i,
+	   i == 0 ? "PASS" : "FAIL");
+    BrickFree(&A);
+  }
+  
+  // Test the threaded halo pack / self-exchange / unpack: every ghost cell
+  // of a face must hold the owned cell on the opposite side (periodic)
+  {
+    halo_plan h;
+    int k;
+
+    for (i=0; i<nx*ny*nz; i++)
+      A0_test[i] = Anext_test[i] = i;
+    for (k=0; k<nz; k++)
+      for (j=0; j<ny; j++) {
+	if (j > 0 && j < ny-1 && k > 0 && k < nz-1) {
+	  Anext_test[Index3D(nx,ny,0,j,k)] = A0_test[Index3D(nx,ny,nx-2,j,k)];
+	  Anext_test[Index3D(nx,ny,nx-1,j,k)] = A0_test[Index3D(nx,ny,1,j,k)];
+	}
+	for (i=0; i<nx; i++) {
+	  if (i > 0 && i < nx-1 && k > 0 && k < nz-1 && (j == 0 || j == ny-1))
+	    Anext_test[Index3D(nx,ny,i,j,k)] = A0_test[Index3D(nx,ny,i,j == 0 ? ny-2 : 1,k)];
+	  if (k == 0 || k == nz-1)
+	    Anext_test[Index3D(nx,ny,i,j,k)] = A0_test[Index3D(nx,ny,i,j,k == 0 ? nz-2 : 1)];
+	}
+      }
+
+    printf("Checking halo exchange (%s)...\n", halo_gather_desc());
+    HaloInit(&h, nx, ny, nz, 1);
+    HaloPack(&h, A0_test);
+    HaloExchangeSelf(&h);
+    HaloUnpack(&h, A0_test);
+    check_vals(Anext_test, A0_test, nx, ny, nz);
+    HaloFree(&h);
+  }
+  
+  // The autotuner's queue footprint must match what CircularQueueInit allocates
+  if (timesteps > 1) {
+    double model = tune_queue_bytes(nx, ty, timesteps), alloc;
+
+    CircularQueueInit(nx, ty, timesteps);
+    alloc = 3.0 * (queuePlane1 - queuePlane0) * sizeof(double);
+    printf("Autotuner queue model %.0f bytes, allocated %.0f bytes: %s\n", model, alloc,
+	   model == alloc ? "PASS" : "FAIL");
+  }
+
+  // Autotuner ranks and Spearman correlation on known permutations: two
+  // swapped pairs of five give 1 - 6*4/120 = 0.8, reversal gives -1
+  {
+    double x[5] = { 0.3, 0.1, 0.5, 0.2, 0.4 }, r[5];
+    double a[5] = { 1, 2, 3, 4, 5 }, b[5] = { 20, 10, 40, 30, 50 }, c[5] = { 9, 7, 5, 3, 1 };
+    double s1, s2;
+
+    tune_ranks(x, 5, r);
+    s1 = tune_spearman(a, b, 5);
+    s2 = tune_spearman(a, c, 5);
+    printf("Autotuner ranks %g %g %g %g %g, Spearman %.3g and %.3g: %s\n", r[0], r[1], r[2], r[3], r[4], s1, s2,
+	   r[0] == 2 && r[1] == 0 && r[2] == 4 && r[3] == 1 && r[4] == 3 &&
+	   fabs(s1 - 0.8) < 1e-12 && fabs(s2 + 1) < 1e-12 ? "PASS" : "FAIL");
+  }
+
+  // The autotuner's prefetch term: on a grid streamed from DRAM, prefetching
+  // far enough ahead to cover the latency must be predicted faster than no
+  // prefetch, and its rows must count in the footprint
+  {
+    tune_machine m = { { 0, 32768, 262144, 1048576 }, { 0, 1e-9, 1e-9, 1e-9 }, 0, 1e10, 100e-9, 0.5 };
+    tune_config off = { 16, 16, 16, 1, 0 }, on = { 16, 16, 16, 1, 8 };
+
+    TuneModel(TUNE_TIMESKEW, 258, 258, 258, &m, &off);
+    TuneModel(TUNE_TIMESKEW, 258, 258, 258, &m, &on);
+    printf("Autotuner prefetch model %.3g ns/update without, %.3g with: %s\n",
+	   1e9 * off.predicted, 1e9 * on.predicted,
+	   on.predicted < off.predicted && on.bytes > off.bytes ? "PASS" : "FAIL");
+  }
+
+  // Philox against its published known answer, the random field against
+  // itself filled with a different thread count, and the kernels against
+  // the closed form for the highest sine mode
+  {
+    unsigned ctr[4] = { 0, 0, 0, 0 }, key[2] = { 0, 0 }, out[4];
+    init_field f;
+    double err;
+    int k;
+
+    philox4x32(ctr, key, out);
+    printf("Philox4x32-10 known answer: %s\n", out[0] == 0x6627e8d5u && out[1] == 0xe169c58du &&
+	   out[2] == 0xbc57ac4cu && out[3] == 0x9b00dbd8u ? "PASS" : "FAIL");
+
+    InitFromEnv(&f, INIT_RANDOM);
+    f.kind = INIT_RANDOM;
+#ifdef _OPENMP
+    k = omp_get_max_threads();
+    omp_set_num_threads(1);
+    InitField(nx, ny, nz, A0_test, &f);
+    omp_set_num_threads(3);
+    InitField(nx, ny, nz, Anext_test, &f);
+    omp_set_num_threads(k);
+#else
+    InitField(nx, ny, nz, A0_test, &f);
+    InitField(nx, ny, nz, Anext_test, &f);
+#endif
+    printf("Checking random field with 1 and 3 threads...\n");
+    check_vals(A0_test, Anext_test, nx, ny, nz);
+
+    f.kind = INIT_SINE;
+    f.mode[0] = nx - 2;
+    f.mode[1] = ny - 2;
+    f.mode[2] = nz - 2;
+    for (k = 0; k < 3; k++) {
+      InitField(nx, ny, nz, A0_test, &f);
+      InitField(nx, ny, nz, Anext_test, &f);
+      if (k == 0)
+	StencilProbe_naive(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+      else if (k == 1)
+	StencilProbe_rivera(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+      else
+	StencilProbe_timeskew(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+      err = InitSineError(nx, ny, nz, timesteps%2 == 0 ? A0_test : Anext_test, &f, timesteps);
+      printf("Analytic sine mode, %s: relative error %.3g: %s\n",
+	     k == 0 ? "naive" : k == 1 ? "Rivera blocking" : "time skewing", err,
+	     err < 1e-10 ? "PASS" : "FAIL");
+    }
+  }
+
+  // Exact Mann-Whitney tails: 3 vs 3 fully separated is 1/20, interleaved 16/20
+  {
+    double lo[3] = { 1, 2, 3 }, hi[3] = { 4, 5, 6 }, odd[3] = { 1, 3, 5 }, even[3] = { 2, 4, 6 };
+    double p1 = mann_whitney_p(hi, 3, lo, 3), p2 = mann_whitney_p(odd, 3, even, 3);
+
+    printf("Mann-Whitney p %.3g and %.3g: %s\n", p1, p2,
+	   fabs(p1 - 0.05) < 1e-12 && fabs(p2 - 0.8) < 1e-12 ? "PASS" : "FAIL");
+  }
+  
+  // RAPL energy through a powercap tree in a temporary directory: the
+  // package counter wraps at its range between the marks, the dram one
+  // does not; 1 J + 0.5 J in all
+  {
+    char dir[] = "/tmp/stencilprobe_rapl.XXXXXX", pkg[600], dram[700], cmd[640];
+    energy_mark m;
+    energy_sample s;
+
+    if (mkdtemp(dir) == NULL) {
+      printf("Error: cannot create %s.\n", dir);
+      exit(EXIT_FAILURE);
+    }
+    snprintf(pkg, sizeof(pkg), "%s/intel-rapl:0", dir);
+    snprintf(dram, sizeof(dram), "%s/intel-rapl:0:0", pkg);
+    mkdir(pkg, 0700);
+    mkdir(dram, 0700);
+    put_file(pkg, "name", "package-0\n");
+    put_file(pkg, "max_energy_range_uj", "262143328850\n");
+    put_file(pkg, "energy_uj", "262143000000\n");
+    put_file(dram, "name", "dram\n");
+    put_file(dram, "max_energy_range_uj", "65712999613\n");
+    put_file(dram, "energy_uj", "1000\n");
+    setenv("STENCILPROBE_POWERCAP", dir, 1);
+    EnergyInit(1 / spt);
+    EnergyMark(&m);
+    put_file(pkg, "energy_uj", "671150\n");
+    put_file(dram, "energy_uj", "501000\n");
+    EnergySince(&m, 1.0, &s);
+    printf("RAPL energy across a counter wrap: %g J + %g J dram... %s\n", s.joules, s.dram_joules,
+	   s.rapl && s.dram && fabs(s.joules - 1) < 1e-9 && fabs(s.dram_joules - 0.5) < 1e-9 ? "PASS" : "FAIL");
+    unsetenv("STENCILPROBE_POWERCAP");
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    if (system(cmd) != 0)
+      printf("Error: cannot remove %s.\n", dir);
+  }
+  
+  // Baseline merge: a run of a subset keeps the points it did not measure,
+  // adds the new one, and replaces the re-measured one only on update
+  {
+    bench_entry base[2], run[2], *m1, *m2;
+    int n1, n2;
+
+    memset(base, 0, sizeof(base));
+    snprintf(base[0].kernel, sizeof(base[0].kernel), "naive");
+    snprintf(base[0].grid, sizeof(base[0].grid), "L2");
+    base[1] = base[0];
+    snprintf(base[1].kernel, sizeof(base[1].kernel), "blocked");
+    base[0].count = base[1].count = 1;
+    base[0].samples[0] = 1;
+    base[1].samples[0] = 2;
+    run[0] = base[1];
+    run[0].samples[0] = 3;
+    run[1] = base[0];
+    snprintf(run[1].grid, sizeof(run[1].grid), "DRAM");
+    run[1].samples[0] = 4;
+    n1 = bench_merge(base, 2, run, 2, 1, &m1);
+    n2 = bench_merge(base, 2, run, 2, 0, &m2);
+    printf("Baseline merge: %d and %d points: %s\n", n1, n2,
+	   n1 == 3 && m1[0].samples[0] == 1 && m1[1].samples[0] == 3 && m1[2].samples[0] == 4 &&
+	   n2 == 3 && m2[0].samples[0] == 1 && m2[1].samples[0] == 2 && m2[2].samples[0] == 4 ? "PASS" : "FAIL");
+    free(m1);
+    free(m2);
+  }
+  
+  // Test variable-coefficient variants against the plain variable-coefficient
+  // sweep, for each number of coefficient grids and storage precision
+  {
+    int ncoef, precision;
+
+    for (ncoef=1; ncoef<=COEF_MAX; ncoef++) {
+      for (precision=COEF_DOUBLE; precision<=COEF_FIXED16; precision++) {
+	CoefAlloc(nx, ny, nz, ncoef, precision);
+	StencilInit(nx,ny,nz,A0_naive);
+	StencilInit(nx,ny,nz,Anext_naive);
+	StencilProbe_varcoef(A0_naive, Anext_naive, nx, ny, nz, tx, ty, tz, timesteps);
+	Afinal_naive = (timesteps%2 == 0) ? A0_naive : Anext_naive;
+
+	StencilInit(nx,ny,nz,A0_test);
+	StencilInit(nx,ny,nz,Anext_test);
+	printf("Checking variable-coefficient time skewing (%d grids, %d bytes)...\n",
+	       ncoef, coef_bytes(&stencil_coefs));
+	StencilProbe_varcoef_timeskew(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+	Afinal_test = (timesteps%2 == 0) ? A0_test : Anext_test;
+	check_vals(Afinal_naive, Afinal_test, nx, ny, nz);
+
+	StencilInit(nx,ny,nz,A0_test);
+	StencilInit(nx,ny,nz,Anext_test);
+	if (timesteps > 1) {
+	  CircularQueueInit(nx, ty, timesteps);
+	}
+	printf("Checking variable-coefficient circular queue (%d grids, %d bytes)...\n",
+	       ncoef, coef_bytes(&stencil_coefs));
+	StencilProbe_varcoef_circqueue(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+	check_vals(Afinal_naive, Anext_test, nx, ny, nz);
+	CoefFree();
+      }
+    }
+  }
+  
+  // Test red-black Gauss-Seidel variants against the naive red-black sweep
+  // (in place, so the result is always in A0)
+  StencilInit(nx,ny,nz,A0_naive);
+  StencilInit(nx,ny,nz,Anext_naive);
+  StencilProbe_redblack(A0_naive, Anext_naive, nx, ny, nz, tx, ty, tz, timesteps);
+
+  StencilInit(nx,ny,nz,A0_test);
+  StencilInit(nx,ny,nz,Anext_test);
+  printf("Checking tiled red-black Gauss-Seidel...\n");
+  StencilProbe_redblack_blocked(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+  check_vals(A0_naive, A0_test, nx, ny, nz);
+
+  StencilInit(nx,ny,nz,A0_test);
+  StencilInit(nx,ny,nz,Anext_test);
+  printf("Checking wavefront red-black Gauss-Seidel...\n");
+  StencilProbe_redblack_wavefront(A0_test, Anext_test, nx, ny, nz, tx, ty, tz, timesteps);
+  check_vals(A0_naive, A0_test, nx, ny, nz);
+  
+  // Test the multigrid V-cycle on a fixed 33^3 grid: the kernel must not
+  // change the result and the cycles must reduce the residual
+  {
+    mg_hierarchy ref, test;
+    double r0, r1;
+    int l;
+
+    printf("Checking multigrid V-cycle...\n");
+    MgInit(&ref, 33, 33, 33, 4);
+    MgInit(&test, 33, 33, 33, 4);
+    r0 = MgResidualNorm(&ref, StencilProbe_naive, tx, ty, tz);
+    StencilProbe_vcycle(&ref, StencilProbe_naive, tx, ty, tz, 4);
+    StencilProbe_vcycle(&test, StencilProbe_rivera, tx, ty, tz, 4);
+    r1 = MgResidualNorm(&ref, StencilProbe_naive, tx, ty, tz);
+    for (l=0; l<ref.nlevels; l++)
+      check_vals(ref.level[l].u, test.level[l].u,
+		 ref.level[l].nx, ref.level[l].ny, ref.level[l].nz);
+    printf("Residual %g -> %g after 4 V-cycles: %s\n", r0, r1,
+	   r1 < 0.01 * r0 ? "PASS" : "FAIL");
+    MgFree(&ref);
+    MgFree(&test);
+  }
+
+  // Test the multi-component layouts and the blocked engine against the
+  // naive SoA sweep; the unpacked components are checked as one grid of
+  // nz*ncomp planes
+  {
+    mf_grid A, B;
+    double *init, *ref, *out;
+    long n = (long) nx * ny * nz;
+    int ncomp = 3, layout, c;
+
+    init = (double*)malloc(sizeof(double)*n*ncomp);
+    ref = (double*)malloc(sizeof(double)*n*ncomp);
+    out = (double*)malloc(sizeof(double)*n*ncomp);
+    for (c=0; c<ncomp; c++)
+      StencilInit(nx,ny,nz,&init[c*n]);
+
+    MfAlloc(&A, MF_SOA, ncomp, nx, ny, nz);
+    MfAlloc(&B, MF_SOA, ncomp, nx, ny, nz);
+    MfFromSoA(&A, init);
+    MfFromSoA(&B, init);
+    StencilProbe_mf_naive(&A, &B, tx, ty, tz, timesteps);
+    MfToSoA((timesteps%2 == 0) ? &A : &B, ref);
+    MfFree(&A);
+    MfFree(&B);
+
+    for (layout=MF_SOA; layout<=MF_AOSOA; layout++) {
+      MfAlloc(&A, layout, ncomp, nx, ny, nz);
+      MfAlloc(&B, layout, ncomp, nx, ny, nz);
+      if (layout != MF_SOA) {
+	printf("Checking multi-component %s layout...\n", layout == MF_AOS ? "AoS" : "AoSoA");
+	MfFromSoA(&A, init);
+	MfFromSoA(&B, init);
+	StencilProbe_mf_naive(&A, &B, tx, ty, tz, timesteps);
+	MfToSoA((timesteps%2 == 0) ? &A : &B, out);
+	check_vals(ref, out, nx, ny, nz*ncomp);
+      }
+      printf("Checking multi-component %s layout, blocked...\n",
+	     layout == MF_SOA ? "SoA" : layout == MF_AOS ? "AoS" : "AoSoA");
+      MfFromSoA(&A, init);
+      MfFromSoA(&B, init);
+      StencilProbe_mf_blocked(&A, &B, tx, ty, tz, timesteps);
+      MfToSoA((timesteps%2 == 0) ? &A : &B, out);
+      check_vals(ref, out, nx, ny, nz*ncomp);
+      MfFree(&A);
+      MfFree(&B);
+    }
+    free(init);
+    free(ref);
+    free(out);
+  }
+  
   /* free arrays */
   free(Anext_naive);
   free(A0_naive);
@@ -0,0 +1,54 @@
+/*
+	Stencil Probe
+	Topology report and per-node memory bandwidth calibration.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "util.h"
+#include "topology.h"
+
+/* bytes moved per point by a streaming 7-point stencil (one read, one write) */
+#define STENCIL_BYTES_PER_POINT 16
+
+int main(int argc,char *argv[])
+{
+  size_t bytes;
+  long l3;
+  int n, ncpus, i;
+  double bw;
+
+  /* parse command line options */
+  if (argc > 1 && atoi(argv[1]) <= 0) {
+    printf("\nUSAGE:\n%s [<calibration array MB>]\n", argv[0]);
+    printf("\nPrints the cpu/NUMA topology and the placement chosen by STENCILPROBE_AFFINITY,\nthen the triad bandwidth of each node's memory using that node's cpus.\n\n");
+    return EXIT_FAILURE;
+  }
+
+  /* default to 4x the last level cache, at least 64 MB */
+  l3 = cache_size(3);
+  bytes = (size_t) 64 << 20;
+  if (4 * (size_t) l3 > bytes)
+    bytes = 4 * (size_t) l3;
+  if (argc > 1)
+    bytes = (size_t) atoi(argv[1]) << 20;
+
+  TopoPin();
+  TopoReport();
+
+  printf("calibration: triad over %lu MB\n", (unsigned long) (bytes >> 20));
+  printf("%-6s %-6s %-12s %-16s\n", "node", "cpus", "GB/s", "Mpoints/s bound");
+  for (n=0;n<stencil_topo.nnodes;n++) {
+    ncpus = 0;
+    for (i=0;i<stencil_topo.ncpus;i++)
+      if (stencil_topo.cpus[i].node == n)
+	ncpus++;
+    if (ncpus == 0)
+      continue;
+    bw = TopoNodeBandwidth(n, bytes);
+    printf("%-6d %-6d %-12.2f %-16.1f\n", n, ncpus, bw * 1e-9,
+	   bw / STENCIL_BYTES_PER_POINT * 1e-6);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,181 @@
+/*
+	Stencil Probe
+	Model-guided autotuner for the circular queue and time skewing
+	kernels: ranks every configuration with the footprint model, times
+	only the top few (plus a few lower-ranked controls) and reports model
+	vs. measured.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "util.h"
+#include "tune.h"
+#include "scratch.h"
+#include "circqueue.h"
+#include "cycle.h"
+#ifdef HAVE_PAPI
+#include <papi.h>
+#endif
+/* run.h has the run parameters */
+#include "run.h"
+
+void StencilProbe_naive(double* A0, double* Anext, int nx, int ny, int nz,
+			int tx, int ty, int tz, int timesteps);
+void StencilProbe_timeskew(double* A0, double* Anext, int nx, int ny, int nz,
+			   int tx, int ty, int tz, int timesteps);
+void StencilProbe_circqueue(double* A0, double* Anext, int nx, int ny, int nz,
+			    int tx, int ty, int tz, int timesteps);
+
+static const char *level_names[] = { "", "L1", "L2", "L3", "DRAM" };
+
+static int kernel, nx, ny, nz;
+static double *A0, *Anext, spt;
+
+/* best measured seconds per useful update of one configuration */
+static double measure(const tune_config *c) {
+  double best = -1;
+  char var[64], dist[16];
+  ticks t1, t2;
+  int i;
+
+  // the kernel reads its prefetch distance per call (prefetch.h)
+  snprintf(var, sizeof(var), "STENCILPROBE_%s_PF_DIST", kernel == TUNE_CIRCQUEUE ? "CIRCQUEUE" : "TIMESKEW");
+  snprintf(dist, sizeof(dist), "%d", c->pf_dist);
+  setenv(var, dist, 1);
+  for (i=0;i<NUM_TRIALS;i++) {
+    StencilInit(nx,ny,nz,Anext);
+    StencilInit(nx,ny,nz,A0);
+    if (kernel == TUNE_CIRCQUEUE && c->steps > 1)
+      CircularQueueInit(nx, c->ty, c->steps);
+
+    t1 = getticks();
+    if (kernel == TUNE_CIRCQUEUE)
+      StencilProbe_circqueue(A0, Anext, nx, ny, nz, c->tx, c->ty, c->tz, c->steps);
+    else
+      StencilProbe_timeskew(A0, Anext, nx, ny, nz, c->tx, c->ty, c->tz, c->steps);
+    t2 = getticks();
+    if (best < 0 || elapsed(t2, t1) < best)
+      best = elapsed(t2, t1);
+  }
+  return spt * best / ((double) (nx-2) * (ny-2) * (nz-2) * c->steps);
+}
+
+int main(int argc,char *argv[])
+{
+  tune_machine m;
+  tune_config *cand, *run, most;
+  double *measured, *rp;
+  int ncand, nrun, top, controls, maxsteps, best, i, l;
+
+  /* parse command line options */
+  if (argc < 5) {
+    printf("\nUSAGE:\n%s <circqueue|timeskew> <grid x> <grid y> <grid z> [<max timesteps per pass>]\n", argv[0]);
+    printf("\nBenchmarks the STENCILPROBE_TUNE_TOP (default 5) best modeled configurations\n");
+    printf("and STENCILPROBE_TUNE_CONTROLS (default 3) evenly spaced lower-ranked ones.\n");
+    printf("Block edges are divisors of the interior; max timesteps defaults to 8.\n");
+    printf("Each is tried with every prefetch distance of TUNE_PF_DISTS; the locality\n");
+    printf("hint is STENCILPROBE_PF_HINT's (default 3) for all of them.\n\n");
+    return EXIT_FAILURE;
+  }
+
+  if ((kernel = tune_kernel(argv[1])) < 0) {
+    printf("Error: unknown kernel %s.\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  nx = atoi(argv[2]);
+  ny = atoi(argv[3]);
+  nz = atoi(argv[4]);
+  maxsteps = argc > 5 ? atoi(argv[5]) : 8;
+  top = probe_param("TUNE_TOP", 5);
+  controls = probe_param("TUNE_CONTROLS", 3);
+  printf("%s, %dx%dx%d, up to %d timesteps per pass\n", tune_kernel_name(kernel),
+	 nx, ny, nz, maxsteps);
+
+#ifdef HAVE_PAPI
+  PAPI_library_init(PAPI_VER_CURRENT);
+#endif
+
+  /* find conversion factor from ticks to seconds */
+  spt = seconds_per_tick();
+  printf("USING TIMER: %s \t  SECONDS PER TICK:%g \n", TIMER_DESC, spt);
+
+  TuneCalibrate(&m, StencilProbe_naive);
+  printf("machine model (fill %.0f%%):", 100 * m.fill);
+  for (l=1;l<=TUNE_LEVELS;l++)
+    printf("  %s %ld KB %.3g ns/update", level_names[l], m.cache[l] >> 10, 1e9 * m.compute[l]);
+  printf("  row cost %.3g updates  bandwidth %.3g GB/s  latency %.3g ns\n", m.row_overhead,
+	 m.bandwidth * 1e-9, m.latency * 1e9);
+
+  ncand = TuneCandidates(kernel, nx, ny, nz, maxsteps, &m, &cand);
+  if (ncand == 0) {
+    printf("Error: no legal configuration for this grid.\n");
+    return EXIT_FAILURE;
+  }
+
+  /* the top candidates, then controls spread over the rest of the ranking */
+  if (top > ncand)
+    top = ncand;
+  if (controls > ncand - top)
+    controls = ncand - top;
+  nrun = top + controls;
+  run = (tune_config *) malloc(nrun * sizeof(tune_config));
+  measured = (double *) malloc(2 * nrun * sizeof(double));
+  Anext = (double*)malloc(sizeof(double)*nx*ny*nz);
+  A0 = (double*)malloc(sizeof(double)*nx*ny*nz);
+  if (run == NULL || measured == NULL || A0 == NULL || Anext == NULL) {
+    printf("Error on autotuner malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  rp = measured + nrun;
+  for (i=0;i<nrun;i++)
+    run[i] = cand[i < top ? i : top + (i - top + 1) * (ncand - top) / (controls + 1)];
+
+  /* scratch grows with every block edge and the depth, so the largest of each covers all runs */
+  most.tx = most.ty = most.steps = 1;
+  for (i=0;i<nrun;i++) {
+    if (run[i].tx > most.tx) most.tx = run[i].tx;
+    if (run[i].ty > most.ty) most.ty = run[i].ty;
+    if (run[i].steps > most.steps) most.steps = run[i].steps;
+  }
+  ScratchInit(nx, ny, nz, most.tx, most.ty, most.steps);
+
+  printf("%d candidates modeled, %d benchmarked\n", ncand, nrun);
+  printf("%-8s %-16s %-6s %-4s %-12s %-6s %-11s %-14s %-14s %-8s\n", "rank", "block (x,y,z)", "steps",
+	 "pf", "footprint", "fits", "bytes/upd", "model ns/upd", "measured", "ratio");
+  best = 0;
+  for (i=0;i<nrun;i++) {
+    char block[32], rank[16];
+    int r = i < top ? i : top + (i - top + 1) * (ncand - top) / (controls + 1);
+
+    measured[i] = measure(&run[i]);
+    if (measured[i] < measured[best])
+      best = i;
+    snprintf(block, sizeof(block), "%dx%dx%d", run[i].tx, run[i].ty, run[i].tz);
+    snprintf(rank, sizeof(rank), "%d%s", r + 1, i < top ? "" : "*");
+    printf("%-8s %-16s %-6d %-4d %-12.0f %-6s %-11.3g %-14.3g %-14.3g %-8.2f\n", rank, block,
+	   run[i].steps, run[i].pf_dist, run[i].bytes, level_names[run[i].level], run[i].traffic,
+	   1e9 * run[i].predicted, 1e9 * measured[i], measured[i] / run[i].predicted);
+  }
+  printf("(* control, outside the model's top %d)\n", top);
+
+  /* Spearman rank correlation between model and measurement */
+  for (i=0;i<nrun;i++)
+    rp[i] = run[i].predicted;
+  printf("model pick: %dx%dx%d, %d steps, prefetch %d, %.3g ns/update;  "
+	 "fastest measured: %dx%dx%d, %d steps, prefetch %d, %.3g ns/update\n",
+	 run[0].tx, run[0].ty, run[0].tz, run[0].steps, run[0].pf_dist, 1e9 * measured[0],
+	 run[best].tx, run[best].ty, run[best].tz, run[best].steps, run[best].pf_dist,
+	 1e9 * measured[best]);
+  if (nrun > 1)
+    printf("rank correlation (Spearman) model vs. measured: %.2f\n",
+	   tune_spearman(rp, measured, nrun));
+
+  free(cand);
+  free(run);
+  free(measured);
+  free(Anext);
+  free(A0);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,274 @@
+/*
+	Stencil Probe multigrid V-cycle
+	Smoother, residual, full-weighting restriction and trilinear
+	prolongation around the probe kernels.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "mg.h"
+#include "util.h"
+#include "cycle.h"
+
+/* interior points per thread below which a level gets fewer threads */
+#define MG_GRAIN (32*32*32)
+/* weighted Jacobi damping for the 3D 7-point operator */
+#define MG_OMEGA (6.0/7.0)
+
+static void set_threads(const mg_level *lev) {
+#ifdef _OPENMP
+  omp_set_num_threads(lev->threads);
+#endif
+}
+
+/*
+  The kernels take their coefficient from A0[0].  That corner is never
+  read by the 7-point stencil, so it is kept at 1 to make the kernels apply
+  the plain Laplacian, and is only zeroed while the prolongation reads it.
+*/
+static void set_corners(double *u, int nx, int ny, int nz, double v) {
+  int a, b, c;
+
+  for (c = 0; c < 2; c++)
+    for (b = 0; b < 2; b++)
+      for (a = 0; a < 2; a++)
+	u[Index3D (nx, ny, a*(nx-1), b*(ny-1), c*(nz-1))] = v;
+}
+
+static void smooth(mg_level *lev, stencil_fn kernel, int tx, int ty, int tz,
+		   int sweeps) {
+  int nx = lev->nx, ny = lev->ny, nz = lev->nz;
+  int s, i, j, k;
+
+  for (s = 0; s < sweeps; s++) {
+    kernel(lev->u, lev->r, nx, ny, nz, tx, ty, tz, 1);
+#pragma omp parallel for private(i, j)
+    for (k = 1; k < nz - 1; k++) {
+      for (j = 1; j < ny - 1; j++) {
+	double *u = &lev->u[Index3D (nx, ny, 0, j, k)];
+	const double *b = &lev->b[Index3D (nx, ny, 0, j, k)];
+	const double *Lu = &lev->r[Index3D (nx, ny, 0, j, k)];
+	for (i = 1; i < nx - 1; i++)
+	  u[i] += MG_OMEGA / 6.0 * (b[i] + Lu[i]);
+      }
+    }
+  }
+}
+
+static void residual(mg_level *lev, stencil_fn kernel, int tx, int ty, int tz) {
+  int nx = lev->nx, ny = lev->ny, nz = lev->nz;
+  int i, j, k;
+
+  kernel(lev->u, lev->r, nx, ny, nz, tx, ty, tz, 1);
+#pragma omp parallel for private(i, j)
+  for (k = 1; k < nz - 1; k++) {
+    for (j = 1; j < ny - 1; j++) {
+      const double *b = &lev->b[Index3D (nx, ny, 0, j, k)];
+      double *r = &lev->r[Index3D (nx, ny, 0, j, k)];
+      for (i = 1; i < nx - 1; i++)
+	r[i] = b[i] + r[i];
+    }
+  }
+}
+
+/* b of the coarse level from the residual of the fine one; zeroes coarse u */
+static void restrict_residual(const mg_level *f, mg_level *c) {
+  int fnx = f->nx, fny = f->ny;
+  int sy = fnx, sz = fnx * fny;
+  int i, j, k, a, b, d;
+
+#pragma omp parallel for private(i, j, a, b, d)
+  for (k = 1; k < c->nz - 1; k++) {
+    for (j = 1; j < c->ny - 1; j++) {
+      for (i = 1; i < c->nx - 1; i++) {
+	const double *p = &f->r[Index3D (fnx, fny, 2*i, 2*j, 2*k)];
+	double v = 0;
+	for (a = -1; a <= 1; a++)
+	  for (b = -1; b <= 1; b++)
+	    for (d = -1; d <= 1; d++)
+	      v += (2-abs(a)) * (2-abs(b)) * (2-abs(d)) * p[a*sz + b*sy + d];
+	// full weighting is v/64; the coarse h^2 is 4 times the fine one
+	c->b[Index3D (c->nx, c->ny, i, j, k)] = v / 16.0;
+	c->u[Index3D (c->nx, c->ny, i, j, k)] = 0.0;
+      }
+    }
+  }
+}
+
+/* u of the fine level += trilinear interpolation of the coarse u */
+static void prolong_correction(const mg_level *c, mg_level *f) {
+  int cnx = c->nx, cny = c->ny;
+  int sy = cnx, sz = cnx * cny;
+  int i, j, k, a, b, d;
+
+#pragma omp parallel for private(i, j, a, b, d)
+  for (k = 1; k < f->nz - 1; k++) {
+    for (j = 1; j < f->ny - 1; j++) {
+      for (i = 1; i < f->nx - 1; i++) {
+	const double *p = &c->u[Index3D (cnx, cny, i >> 1, j >> 1, k >> 1)];
+	int di = i & 1, dj = j & 1, dk = k & 1;
+	double v = 0;
+	for (a = 0; a <= dk; a++)
+	  for (b = 0; b <= dj; b++)
+	    for (d = 0; d <= di; d++)
+	      v += p[a*sz + b*sy + d];
+	f->u[Index3D (f->nx, f->ny, i, j, k)] += v / (1 << (di + dj + dk));
+      }
+    }
+  }
+}
+
+static void vcycle(mg_hierarchy *mg, int l, stencil_fn kernel,
+		   int tx, int ty, int tz) {
+  mg_level *lev = &mg->level[l], *coarse;
+  ticks t0, t1;
+
+  set_threads(lev);
+
+  if (l == mg->nlevels - 1) {
+    t0 = getticks();
+    smooth(lev, kernel, tx, ty, tz, mg->coarse_sweeps);
+    t1 = getticks();
+    lev->ticks[MG_SMOOTH] += elapsed(t1, t0);
+    return;
+  }
+  coarse = &mg->level[l+1];
+
+  t0 = getticks();
+  smooth(lev, kernel, tx, ty, tz, mg->presmooth);
+  t1 = getticks();
+  lev->ticks[MG_SMOOTH] += elapsed(t1, t0);
+
+  t0 = getticks();
+  residual(lev, kernel, tx, ty, tz);
+  t1 = getticks();
+  lev->ticks[MG_RESIDUAL] += elapsed(t1, t0);
+
+  t0 = getticks();
+  restrict_residual(lev, coarse);
+  t1 = getticks();
+  lev->ticks[MG_RESTRICT] += elapsed(t1, t0);
+
+  vcycle(mg, l+1, kernel, tx, ty, tz);
+  set_threads(lev);
+
+  t0 = getticks();
+  set_corners(coarse->u, coarse->nx, coarse->ny, coarse->nz, 0.0);
+  prolong_correction(coarse, lev);
+  set_corners(coarse->u, coarse->nx, coarse->ny, coarse->nz, 1.0);
+  t1 = getticks();
+  lev->ticks[MG_PROLONG] += elapsed(t1, t0);
+
+  t0 = getticks();
+  smooth(lev, kernel, tx, ty, tz, mg->postsmooth);
+  t1 = getticks();
+  lev->ticks[MG_SMOOTH] += elapsed(t1, t0);
+}
+
+void MgInit(mg_hierarchy *mg, int nx, int ny, int nz, int nlevels) {
+  size_t bytes = 0;
+  int maxthreads = 1;
+  int l, p, n, i, j, k;
+  char name[32];
+
+#ifdef _OPENMP
+  maxthreads = omp_get_max_threads();
+#endif
+  if (nlevels > MG_MAX_LEVELS)
+    nlevels = MG_MAX_LEVELS;
+
+  mg->level[0].nx = nx;
+  mg->level[0].ny = ny;
+  mg->level[0].nz = nz;
+  for (l = 1; l < nlevels; l++) {
+    const mg_level *f = &mg->level[l-1];
+    if ((f->nx-1) % 2 || (f->ny-1) % 2 || (f->nz-1) % 2
+	|| f->nx < 5 || f->ny < 5 || f->nz < 5)
+      break;
+    mg->level[l].nx = (f->nx-1)/2 + 1;
+    mg->level[l].ny = (f->ny-1)/2 + 1;
+    mg->level[l].nz = (f->nz-1)/2 + 1;
+  }
+  mg->nlevels = l;
+  mg->presmooth = probe_param("MG_PRESMOOTH", 2);
+  mg->postsmooth = probe_param("MG_POSTSMOOTH", 2);
+  mg->coarse_sweeps = probe_param("MG_COARSE_SWEEPS", 16);
+
+  for (l = 0; l < mg->nlevels; l++) {
+    mg_level *lev = &mg->level[l];
+    bytes += 3 * ARENA_SIZE(sizeof(double) * lev->nx * lev->ny * lev->nz);
+  }
+  arena_init(&mg->pool, bytes);
+
+  for (l = 0; l < mg->nlevels; l++) {
+    mg_level *lev = &mg->level[l];
+    n = lev->nx * lev->ny * lev->nz;
+
+    lev->u = (double *) arena_alloc(&mg->pool, sizeof(double) * n);
+    lev->b = (double *) arena_alloc(&mg->pool, sizeof(double) * n);
+    lev->r = (double *) arena_alloc(&mg->pool, sizeof(double) * n);
+
+    lev->threads = (lev->nx-2) * (lev->ny-2) * (lev->nz-2) / MG_GRAIN;
+    if (lev->threads < 1) lev->threads = 1;
+    if (lev->threads > maxthreads) lev->threads = maxthreads;
+    snprintf(name, sizeof(name), "MG_THREADS_%d", l);
+    lev->threads = probe_param(name, lev->threads);
+
+    for (p = 0; p < MG_NPHASES; p++)
+      lev->ticks[p] = 0;
+
+    if (l == 0)
+      StencilInit(lev->nx, lev->ny, lev->nz, lev->u);
+    for (k = 0; k < lev->nz; k++) {
+      for (j = 0; j < lev->ny; j++) {
+	for (i = 0; i < lev->nx; i++) {
+	  p = Index3D (lev->nx, lev->ny, i, j, k);
+	  if (l > 0 || i == 0 || j == 0 || k == 0
+	      || i == lev->nx-1 || j == lev->ny-1 || k == lev->nz-1)
+	    lev->u[p] = 0.0;
+	  lev->b[p] = 0.0;
+	  lev->r[p] = 0.0;
+	}
+      }
+    }
+    set_corners(lev->u, lev->nx, lev->ny, lev->nz, 1.0);
+  }
+}
+
+void MgFree(mg_hierarchy *mg) {
+  arena_free(&mg->pool);
+  mg->nlevels = 0;
+}
+
+void StencilProbe_vcycle(mg_hierarchy *mg, stencil_fn kernel,
+			 int tx, int ty, int tz, int cycles) {
+  int c;
+#ifdef _OPENMP
+  int maxthreads = omp_get_max_threads();
+#endif
+
+  for (c = 0; c < cycles; c++)
+    vcycle(mg, 0, kernel, tx, ty, tz);
+
+#ifdef _OPENMP
+  omp_set_num_threads(maxthreads);
+#endif
+}
+
+double MgResidualNorm(mg_hierarchy *mg, stencil_fn kernel, int tx, int ty, int tz) {
+  mg_level *lev = &mg->level[0];
+  int nx = lev->nx, ny = lev->ny, nz = lev->nz;
+  int i, j, k;
+  double norm = 0;
+
+  residual(lev, kernel, tx, ty, tz);
+  for (k = 1; k < nz - 1; k++)
+    for (j = 1; j < ny - 1; j++)
+      for (i = 1; i < nx - 1; i++)
+	if (fabs(lev->r[Index3D (nx, ny, i, j, k)]) > norm)
+	  norm = fabs(lev->r[Index3D (nx, ny, i, j, k)]);
+  return norm;
+}
@@ -0,0 +1,66 @@
+#ifndef _MG_H_
+#define _MG_H_
+
+#include "common.h"
+#include "arena.h"
+
+/*
+  Geometric multigrid V-cycle built on the probe kernels.
+
+  Each level solves -L(u) = b on a vertex-centered grid, where L is the
+  unscaled 7-point Laplacian (the probe kernel with a coefficient of 1)
+  and b already carries the h^2 factor.  A grid of n points (including
+  the boundary) in a dimension coarsens to (n-1)/2+1, so the fine grid
+  should be 2^m+1 points wide.
+
+    smoother:     weighted Jacobi, u += w/6 (b + L(u)), with L(u) from the kernel
+    residual:     r = b + L(u), with L(u) from the kernel
+    restriction:  27-point full weighting, b_coarse = 4 R(r)
+    prolongation: trilinear, u_fine += P(u_coarse)
+
+  All levels are carved out of one arena when the hierarchy is built, so
+  a cycle does no allocation.  Level l runs on level[l].threads OpenMP
+  threads; by default the thread count shrinks with the level size, and
+  STENCILPROBE_MG_THREADS_<l> overrides it.
+*/
+
+#define MG_MAX_LEVELS 16
+
+/* phases timed per level */
+#define MG_SMOOTH    0
+#define MG_RESIDUAL  1
+#define MG_RESTRICT  2
+#define MG_PROLONG   3
+#define MG_NPHASES   4
+
+typedef struct {
+  double *u, *b, *r;	/* solution, right-hand side, residual / scratch */
+  int nx, ny, nz;	/* size including the boundary */
+  int threads;
+  double ticks[MG_NPHASES];
+} mg_level;
+
+typedef struct {
+  mg_level level[MG_MAX_LEVELS];
+  int nlevels;
+  int presmooth, postsmooth, coarse_sweeps;
+  arena pool;
+} mg_hierarchy;
+
+/*
+  Builds up to nlevels levels over an nx*ny*nz fine grid (fewer if a
+  dimension cannot be coarsened further), with u from StencilInit on the
+  fine interior and zero boundaries and right-hand side.
+ */
+void MgInit(mg_hierarchy *mg, int nx, int ny, int nz, int nlevels);
+
+void MgFree(mg_hierarchy *mg);
+
+/* runs cycles V-cycles, accumulating per-level phase ticks */
+void StencilProbe_vcycle(mg_hierarchy *mg, stencil_fn kernel,
+			 int tx, int ty, int tz, int cycles);
+
+/* max-norm of the fine-level residual */
+double MgResidualNorm(mg_hierarchy *mg, stencil_fn kernel, int tx, int ty, int tz);
+
+#endif
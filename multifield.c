@@ -0,0 +1,236 @@
+/*
+	Stencil Probe multi-component grids
+	SoA, AoS and AoSoA storage, conversions and the naive and blocked
+	engines.  Each layout has its own row kernel so that the inner loop
+	runs over unit-stride data where the layout has any.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "multifield.h"
+#include "arena.h"
+#define MIN(x,y) (x < y ? x : y)
+
+void MfAlloc(mf_grid *g, int layout, int ncomp, int nx, int ny, int nz) {
+  void *p = NULL;
+
+  if (ncomp < 1 || ncomp > MF_MAX_COMP) {
+    printf("Error: %d components requested, 1..%d supported.\n", ncomp, MF_MAX_COMP);
+    exit(EXIT_FAILURE);
+  }
+  g->layout = layout;
+  g->ncomp = ncomp;
+  g->nx = nx;
+  g->ny = ny;
+  g->nz = nz;
+  g->nbx = (nx + MF_VLEN - 1) / MF_VLEN;
+  if (posix_memalign(&p, ARENA_ALIGN, mf_bytes(g)) != 0) {
+    printf("Error on multi-component grid malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  g->data = (double *) p;
+  // the AoSoA padding lanes are loaded (not used) by the row kernel
+  memset(g->data, 0, mf_bytes(g));
+}
+
+void MfFree(mf_grid *g) {
+  free(g->data);
+  g->data = NULL;
+}
+
+long mf_bytes(const mf_grid *g) {
+  long cells = (long) g->nx * g->ny * g->nz;
+
+  if (g->layout == MF_AOSOA)
+    cells = (long) g->nbx * MF_VLEN * g->ny * g->nz;
+  return cells * g->ncomp * sizeof(double);
+}
+
+/* position of component c of cell (i, j, k); not for inner loops */
+static long mf_index(const mf_grid *g, int c, int i, int j, int k) {
+  switch (g->layout) {
+  case MF_AOS:
+    return Index3D (g->nx, g->ny, i, j, k) * g->ncomp + c;
+  case MF_AOSOA:
+    return (((long) k * g->ny + j) * g->nbx + i / MF_VLEN) * g->ncomp * MF_VLEN
+      + c * MF_VLEN + i % MF_VLEN;
+  default:
+    return (long) c * g->nx * g->ny * g->nz + Index3D (g->nx, g->ny, i, j, k);
+  }
+}
+
+void MfFromSoA(mf_grid *g, const double *soa) {
+  long n = (long) g->nx * g->ny * g->nz;
+  int c, i, j, k;
+
+  for (c = 0; c < g->ncomp; c++)
+    for (k = 0; k < g->nz; k++)
+      for (j = 0; j < g->ny; j++)
+	for (i = 0; i < g->nx; i++)
+	  g->data[mf_index(g, c, i, j, k)] = soa[c * n + Index3D (g->nx, g->ny, i, j, k)];
+}
+
+void MfToSoA(const mf_grid *g, double *soa) {
+  long n = (long) g->nx * g->ny * g->nz;
+  int c, i, j, k;
+
+  for (c = 0; c < g->ncomp; c++)
+    for (k = 0; k < g->nz; k++)
+      for (j = 0; j < g->ny; j++)
+	for (i = 0; i < g->nx; i++)
+	  soa[c * n + Index3D (g->nx, g->ny, i, j, k)] = g->data[mf_index(g, c, i, j, k)];
+}
+
+/* cells i0..i1-1 of row (j, k), one component at a time */
+static void row_soa(const mf_grid *A, mf_grid *B, int j, int k, int i0, int i1, double fac) {
+  long n = (long) A->nx * A->ny * A->nz;
+  long sy = A->nx, sz = (long) A->nx * A->ny;
+  int nc = A->ncomp;
+  int c, i;
+
+  for (c = 0; c < nc; c++) {
+    const double *in = &A->data[c * n + Index3D (A->nx, A->ny, 0, j, k)];
+    const double *next = &A->data[((c + 1) % nc) * n + Index3D (A->nx, A->ny, 0, j, k)];
+    double *out = &B->data[c * n + Index3D (A->nx, A->ny, 0, j, k)];
+
+    for (i = i0; i < i1; i++) {
+      out[i] =
+	in[i + sz] +
+	in[i - sz] +
+	in[i + sy] +
+	in[i - sy] +
+	in[i + 1] +
+	in[i - 1]
+	- 6.0 * in[i] / (fac*fac)
+	+ MF_COUPLING * next[i];
+    }
+  }
+}
+
+/* cells i0..i1-1 of row (j, k), all components of a cell together */
+static void row_aos(const mf_grid *A, mf_grid *B, int j, int k, int i0, int i1, double fac) {
+  int nc = A->ncomp;
+  long sx = nc, sy = (long) A->nx * nc, sz = (long) A->nx * A->ny * nc;
+  const double *in = &A->data[Index3D (A->nx, A->ny, 0, j, k) * nc];
+  double *out = &B->data[Index3D (A->nx, A->ny, 0, j, k) * nc];
+  int c, i;
+
+  for (i = i0; i < i1; i++) {
+    const double *p = &in[i * sx];
+    double *q = &out[i * sx];
+    for (c = 0; c < nc; c++) {
+      q[c] =
+	p[c + sz] +
+	p[c - sz] +
+	p[c + sy] +
+	p[c - sy] +
+	p[c + sx] +
+	p[c - sx]
+	- 6.0 * p[c] / (fac*fac)
+	+ MF_COUPLING * p[c + 1 < nc ? c + 1 : 0];
+    }
+  }
+}
+
+/* cells i0..i1-1 of row (j, k), one MF_VLEN block and component at a time */
+static void row_aosoa(const mf_grid *A, mf_grid *B, int j, int k, int i0, int i1, double fac) {
+  int nc = A->ncomp;
+  long sb = (long) nc * MF_VLEN;
+  long sy = A->nbx * sb, sz = A->ny * sy;
+  long row = ((long) k * A->ny + j) * A->nbx * sb;
+  double west[MF_VLEN], east[MF_VLEN];
+  int b, c, l, lo, hi;
+
+  for (b = i0 / MF_VLEN; b <= (i1 - 1) / MF_VLEN; b++) {
+    lo = b == i0 / MF_VLEN ? i0 % MF_VLEN : 0;
+    hi = b == (i1 - 1) / MF_VLEN ? (i1 - 1) % MF_VLEN + 1 : MF_VLEN;
+
+    for (c = 0; c < nc; c++) {
+      const double *in = &A->data[row + b * sb + c * MF_VLEN];
+      const double *next = c + 1 < nc ? in + MF_VLEN : in - (nc - 1) * MF_VLEN;
+      double *out = &B->data[row + b * sb + c * MF_VLEN];
+
+      // x neighbors of the first and last lane live in the adjacent blocks
+      for (l = 0; l < MF_VLEN; l++) {
+	west[l] = in[l - 1];
+	east[l] = in[l + 1];
+      }
+      west[0] = in[-sb + MF_VLEN - 1];
+      east[MF_VLEN - 1] = in[sb];
+
+      if (lo == 0 && hi == MF_VLEN) {
+	// whole block: a constant trip count the compiler turns into vector ops
+	for (l = 0; l < MF_VLEN; l++)
+	  out[l] =
+	    in[l + sz] +
+	    in[l - sz] +
+	    in[l + sy] +
+	    in[l - sy] +
+	    east[l] +
+	    west[l]
+	    - 6.0 * in[l] / (fac*fac)
+	    + MF_COUPLING * next[l];
+	continue;
+      }
+      for (l = lo; l < hi; l++) {
+	out[l] =
+	  in[l + sz] +
+	  in[l - sz] +
+	  in[l + sy] +
+	  in[l - sy] +
+	  east[l] +
+	  west[l]
+	  - 6.0 * in[l] / (fac*fac)
+	  + MF_COUPLING * next[l];
+      }
+    }
+  }
+}
+
+static void mf_row(const mf_grid *A, mf_grid *B, int j, int k, int i0, int i1, double fac) {
+  switch (A->layout) {
+  case MF_AOS:   row_aos(A, B, j, k, i0, i1, fac); break;
+  case MF_AOSOA: row_aosoa(A, B, j, k, i0, i1, fac); break;
+  default:       row_soa(A, B, j, k, i0, i1, fac); break;
+  }
+}
+
+void StencilProbe_mf_naive(mf_grid *A0, mf_grid *Anext, int tx, int ty, int tz,
+			   int timesteps) {
+  // Fool compiler so it doesn't insert a constant here
+  double fac = A0->data[0];
+  int nx = A0->nx, ny = A0->ny, nz = A0->nz;
+  mf_grid *temp_ptr;
+  int j, k, t;
+
+  for (t = 0; t < timesteps; t++) {
+    for (k = 1; k < nz - 1; k++)
+      for (j = 1; j < ny - 1; j++)
+	mf_row(A0, Anext, j, k, 1, nx - 1, fac);
+    temp_ptr = A0;
+    A0 = Anext;
+    Anext = temp_ptr;
+  }
+}
+
+void StencilProbe_mf_blocked(mf_grid *A0, mf_grid *Anext, int tx, int ty, int tz,
+			     int timesteps) {
+  // Fool compiler so it doesn't insert a constant here
+  double fac = A0->data[0];
+  int nx = A0->nx, ny = A0->ny, nz = A0->nz;
+  mf_grid *temp_ptr;
+  int ii, jj, j, k, t;
+
+  for (t = 0; t < timesteps; t++) {
+    for (jj = 1; jj < ny - 1; jj += ty) {
+      for (ii = 1; ii < nx - 1; ii += tx) {
+	for (k = 1; k < nz - 1; k++)
+	  for (j = jj; j < MIN(jj + ty, ny - 1); j++)
+	    mf_row(A0, Anext, j, k, ii, MIN(ii + tx, nx - 1), fac);
+      }
+    }
+    temp_ptr = A0;
+    A0 = Anext;
+    Anext = temp_ptr;
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef _MULTIFIELD_H_
+#define _MULTIFIELD_H_
+
+#include "common.h"
+
+/*
+  Multi-component grids (e.g. u, v, w, T per cell) in three layouts:
+
+    MF_SOA    one nx*ny*nz grid per component, back to back
+    MF_AOS    the components of a cell interleaved:  [(i,j,k)][c]
+    MF_AOSOA  rows cut into blocks of MF_VLEN cells, each block storing
+              MF_VLEN values of component 0, then of component 1, ...:
+              [k][j][i / MF_VLEN][c][i % MF_VLEN], nx padded to MF_VLEN
+
+  Every component gets the 7-point update of probe_heat.c plus a
+  coupling to the next component of the same cell,
+
+    Anext_c = sum of the 6 neighbors of A_c - 6 A_c / fac^2
+              + MF_COUPLING A_(c+1 mod ncomp)
+
+  so no layout can be split into independent scalar sweeps.
+*/
+
+#define MF_SOA   0
+#define MF_AOS   1
+#define MF_AOSOA 2
+
+/* AoSoA block width in doubles; 4 matches AVX2, 8 matches AVX-512 */
+#ifndef MF_VLEN
+#define MF_VLEN 4
+#endif
+
+#define MF_MAX_COMP 16
+#define MF_COUPLING 0.25
+
+typedef struct {
+  double *data;
+  int layout, ncomp;
+  int nx, ny, nz;
+  int nbx;		/* MF_AOSOA: blocks per row */
+} mf_grid;
+
+void MfAlloc(mf_grid *g, int layout, int ncomp, int nx, int ny, int nz);
+void MfFree(mf_grid *g);
+
+/* bytes allocated, including the AoSoA padding */
+long mf_bytes(const mf_grid *g);
+
+/* copies from / to ncomp consecutive nx*ny*nz grids (the SoA order) */
+void MfFromSoA(mf_grid *g, const double *soa);
+void MfToSoA(const mf_grid *g, double *soa);
+
+/*
+  The naive (k, j, i) and Rivera-blocked (tx x ty tiles) sweeps over a
+  multi-component grid of any layout.  As with the scalar kernels the
+  grids are swapped after every step, so the result is in A0 for an even
+  number of timesteps and in Anext otherwise.
+ */
+void StencilProbe_mf_naive(mf_grid *A0, mf_grid *Anext, int tx, int ty, int tz,
+			   int timesteps);
+void StencilProbe_mf_blocked(mf_grid *A0, mf_grid *Anext, int tx, int ty, int tz,
+			     int timesteps);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef _NORM_H_
+#define _NORM_H_
+
+/*
+  Norms of the change made by the last timestep, (Anext - A0) over the
+  interior, as returned by the residual-norm kernels in probe_heat_norm.c.
+  The sums are formed per z-plane and then added in plane order, so the
+  result does not depend on the number of threads.
+*/
+typedef struct {
+  double l2;
+  double max;
+} stencil_norm;
+
+/* stencil sweep and norm in one pass over the grid */
+void StencilProbe_norm(double* A0, double* Anext, int nx, int ny, int nz,
+		       int tx, int ty, int tz, int timesteps, stencil_norm *norm);
+
+/* the same sweep followed by a separate norm pass, for comparison */
+void StencilProbe_norm_unfused(double* A0, double* Anext, int nx, int ny, int nz,
+			       int tx, int ty, int tz, int timesteps, stencil_norm *norm);
+
+#endif
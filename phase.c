@@ -0,0 +1,105 @@
+/*
+	Stencil Probe phase timers
+	Per-thread accumulators for the kernel instrumentation in phase.h.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "phase.h"
+
+#ifdef PROBE_PHASES
+
+/* time stamps taken to estimate the cost of one lap */
+#define LAP_SAMPLES 100000
+
+static const char *phase_names[PHASE_N] = { "copy", "compute", "swap", "recursion" };
+
+static phase_slot slots[PHASE_MAX_THREADS];
+static int nslots = 0;
+__thread phase_slot *phase_mine = NULL;
+
+phase_slot *phase_claim() {
+  int id = __atomic_fetch_add(&nslots, 1, __ATOMIC_RELAXED);
+
+  if (id >= PHASE_MAX_THREADS) {
+    printf("Error: more than %d threads entered instrumented regions.\n", PHASE_MAX_THREADS);
+    exit(EXIT_FAILURE);
+  }
+  phase_mine = &slots[id];
+  return phase_mine;
+}
+
+void PhaseReset() {
+  int n = nslots < PHASE_MAX_THREADS ? nslots : PHASE_MAX_THREADS;
+
+  memset(slots, 0, n * sizeof(phase_slot));
+}
+
+/* ticks per lap: one time stamp and one accumulate */
+static double lap_cost() {
+  volatile double sink = 0;
+  phase_tsc t0, t1, prev, now;
+  int i;
+
+  t0 = prev = phase_now();
+  for (i = 0; i < LAP_SAMPLES; i++) {
+    now = phase_now();
+    sink += (double) (now - prev);
+    prev = now;
+  }
+  t1 = phase_now();
+  return (double) (t1 - t0) / LAP_SAMPLES;
+}
+
+void PhaseReport(double spt, double wall) {
+  double sum[PHASE_N], total = 0, busiest = 0, t, cost;
+  long laps = 0;
+  int n = nslots < PHASE_MAX_THREADS ? nslots : PHASE_MAX_THREADS;
+  int used = 0, s, p;
+
+  for (p = 0; p < PHASE_N; p++)
+    sum[p] = 0;
+  for (s = 0; s < n; s++) {
+    if (slots[s].laps == 0)
+      continue;
+    used++;
+    laps += slots[s].laps;
+    t = 0;
+    for (p = 0; p < PHASE_N; p++) {
+      sum[p] += slots[s].ticks[p];
+      t += slots[s].ticks[p];
+    }
+    total += t;
+    if (t > busiest)
+      busiest = t;
+  }
+  if (used == 0) {
+    printf("phases: no instrumented regions\n");
+    return;
+  }
+
+  printf("phases:");
+  for (p = 0; p < PHASE_N; p++)
+    if (sum[p] > 0)
+      printf("  %s %.4g s (%.1f%%)", phase_names[p], spt * sum[p], 100.0 * sum[p] / total);
+  printf("\n");
+  if (used > 1)
+    printf("  %d threads, busiest %.4g s, mean %.4g s\n", used,
+	   spt * busiest, spt * total / used);
+  if (wall > 0) {
+    cost = 100.0 * laps / used * lap_cost() * spt / wall;
+    printf("  instrumentation: %ld laps, est. %.2f%% of the call%s\n", laps, cost,
+	   cost > PHASE_MAX_OVERHEAD ? " -- over the 1% budget, phase shares are skewed;"
+	   " use a larger grid or blocks" : "");
+  }
+}
+
+#else
+
+void PhaseReset() {
+}
+
+void PhaseReport(double spt __attribute__((unused)), double wall __attribute__((unused))) {
+}
+
+#endif
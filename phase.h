@@ -0,0 +1,98 @@
+#ifndef _PHASE_H_
+#define _PHASE_H_
+
+/*
+  Per-phase timers inside the kernels, compiled in with -DPROBE_PHASES
+  (make PHASES=-DPROBE_PHASES <target>) and compiled out otherwise.
+
+  A kernel declares PHASE_VARS, calls PHASE_START() once and then
+  PHASE_LAP(phase) at the end of every region: the ticks since the previous
+  lap are charged to that phase, so back-to-back regions cost one time
+  stamp each.  Laps accumulate in locals of the running thread, which
+  PHASE_FLUSH() adds to that thread's slot before the kernel returns;
+  PhaseReport() adds the slots up.  Ticks are TSC cycles (the getticks()
+  unit of cycle.h on x86).
+
+    PHASE_COPY       ghost / halo / window copies
+    PHASE_COMPUTE    stencil updates
+    PHASE_SWAP       buffer and queue rotation
+    PHASE_RECURSION  space-time decomposition (cache-oblivious kernels)
+*/
+
+#define PHASE_COPY      0
+#define PHASE_COMPUTE   1
+#define PHASE_SWAP      2
+#define PHASE_RECURSION 3
+#define PHASE_N         4
+
+#ifdef PROBE_PHASES
+
+#include <string.h>
+#include <time.h>
+
+#define PHASE_MAX_THREADS 256
+
+/* instrumentation cost, in percent of the call, above which PhaseReport warns */
+#define PHASE_MAX_OVERHEAD 1.0
+
+typedef unsigned long long phase_tsc;
+
+typedef struct {
+  double ticks[PHASE_N];
+  long laps;
+} __attribute__((aligned(64))) phase_slot;
+
+extern __thread phase_slot *phase_mine;
+phase_slot *phase_claim();
+
+static inline phase_tsc phase_now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (phase_tsc) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/* adds a kernel's local accumulators to the calling thread's slot */
+static inline void phase_flush(const double *acc, long laps) {
+  phase_slot *s = phase_mine ? phase_mine : phase_claim();
+  int p;
+
+  for (p = 0; p < PHASE_N; p++)
+    s->ticks[p] += acc[p];
+  s->laps += laps;
+}
+
+#define PHASE_VARS phase_tsc _phase_t; double _phase_acc[PHASE_N] = { 0 }; long _phase_laps = 0
+#define PHASE_START() (_phase_t = phase_now())
+#define PHASE_LAP(_p) do { phase_tsc _now = phase_now();		\
+    _phase_acc[_p] += (double) (_now - _phase_t);			\
+    _phase_t = _now;							\
+    _phase_laps++; } while (0)
+#define PHASE_FLUSH() (phase_flush(_phase_acc, _phase_laps),		\
+		       memset(_phase_acc, 0, sizeof(_phase_acc)), _phase_laps = 0)
+
+#else
+
+#define PHASE_VARS int _phase_unused __attribute__((unused))
+#define PHASE_START()
+#define PHASE_LAP(_p)
+#define PHASE_FLUSH()
+
+#endif
+
+/* clears the accumulators of every thread */
+void PhaseReset();
+
+/*
+  Prints the seconds charged to each phase (summed over threads and as a
+  share of the thread total), the busiest thread's share, and the estimated
+  cost of the time stamps themselves relative to wall, the seconds the
+  instrumented call took, flagged when it exceeds PHASE_MAX_OVERHEAD.
+  Prints nothing without PROBE_PHASES.
+ */
+void PhaseReport(double spt, double wall);
+
+#endif
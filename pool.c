@@ -0,0 +1,278 @@
+/*
+	Stencil Probe thread pool
+	Slab-parallel time loop with spin barriers and neighbor
+	synchronization.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "pool.h"
+#include "boundary.h"
+
+typedef unsigned long long pool_tsc;
+
+/* one cache line per flag, so spinning threads do not share lines */
+typedef struct {
+  volatile long v;
+  char pad[64 - sizeof(long)];
+} __attribute__((aligned(64))) pool_flag;
+
+static const char *names[SYNC_MODES] = { "serial", "fork", "omp", "sense", "tree", "neighbor" };
+
+static int override = -1;
+
+/* sense barrier */
+static pool_flag bar_count, bar_sense;
+/* tree barrier: arrival episode per thread, release episode */
+static pool_flag tree_arrive[POOL_MAX_THREADS], tree_release;
+/* neighbor sync: steps finished per slab */
+static pool_flag progress[POOL_MAX_THREADS];
+
+static struct {
+  int mode, threads;
+  long steps;
+  double wait, maxwait;
+} stats;
+
+static inline pool_tsc pool_now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static inline void pool_relax(int *spins) {
+  if (++*spins < POOL_SPINS) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+  else {
+    *spins = 0;
+    sched_yield();
+  }
+}
+
+const char *sync_name(int mode) {
+  return mode >= 0 && mode < SYNC_MODES ? names[mode] : "?";
+}
+
+void PoolSetSync(int mode) {
+  override = mode;
+}
+
+int sync_mode() {
+  const char *s = getenv("STENCILPROBE_SYNC");
+  int m;
+
+  if (override >= 0)
+    return override;
+  if (s != NULL)
+    for (m = 0; m < SYNC_MODES; m++)
+      if (strcmp(s, names[m]) == 0)
+	return m;
+  return SYNC_SERIAL;
+}
+
+void PoolThreaded() {
+  if (getenv("STENCILPROBE_SYNC") == NULL)
+    override = SYNC_NEIGHBOR;
+}
+
+void PoolReset() {
+  memset(&stats, 0, sizeof(stats));
+}
+
+void PoolReport(double spt) {
+  if (stats.mode == SYNC_SERIAL || stats.steps == 0)
+    return;
+  printf("sync %s: %d threads, %ld steps, wait per step %.3g us per thread (mean), "
+	 "busiest waiter %.3g us per step\n", sync_name(stats.mode), stats.threads, stats.steps,
+	 1e6 * spt * stats.wait / stats.threads / stats.steps, 1e6 * spt * stats.maxwait / stats.steps);
+}
+
+/* centralized sense-reversing barrier; *sense is the caller's local sense */
+static void sense_barrier(int n, long *sense) {
+  int spins = 0;
+
+  *sense = !*sense;
+  if (__atomic_add_fetch(&bar_count.v, 1, __ATOMIC_ACQ_REL) == n) {
+    bar_count.v = 0;
+    __atomic_store_n(&bar_sense.v, *sense, __ATOMIC_RELEASE);
+  }
+  else
+    while (__atomic_load_n(&bar_sense.v, __ATOMIC_ACQUIRE) != *sense)
+      pool_relax(&spins);
+}
+
+/*
+  Arrival climbs a 4-ary tree (thread i waits for threads 4i+1..4i+4), so
+  no counter is shared by more than five threads; the root then releases
+  everyone through one flag.  *episode is the caller's barrier count.
+*/
+static void tree_barrier(int tid, int n, long *episode) {
+  int c, spins = 0;
+
+  (*episode)++;
+  for (c = 4 * tid + 1; c <= 4 * tid + 4 && c < n; c++)
+    while (__atomic_load_n(&tree_arrive[c].v, __ATOMIC_ACQUIRE) != *episode)
+      pool_relax(&spins);
+  if (tid == 0)
+    __atomic_store_n(&tree_release.v, *episode, __ATOMIC_RELEASE);
+  else {
+    __atomic_store_n(&tree_arrive[tid].v, *episode, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&tree_release.v, __ATOMIC_ACQUIRE) != *episode)
+      pool_relax(&spins);
+  }
+}
+
+/*
+  Before step t, the slabs on either side must have finished step t-1.
+  With ring set the first and last slab are neighbors too (periodic z
+  ghosts are written by the slab at the other end).
+*/
+static void neighbor_wait(int tid, int n, long t, int ring) {
+  int lo = tid > 0 ? tid - 1 : ring ? n - 1 : -1;
+  int hi = tid < n - 1 ? tid + 1 : ring ? 0 : -1;
+  int spins = 0;
+
+  if (lo >= 0)
+    while (__atomic_load_n(&progress[lo].v, __ATOMIC_ACQUIRE) < t)
+      pool_relax(&spins);
+  if (hi >= 0)
+    while (__atomic_load_n(&progress[hi].v, __ATOMIC_ACQUIRE) < t)
+      pool_relax(&spins);
+}
+
+static void add_wait(double wait) {
+#ifdef _OPENMP
+#pragma omp critical (pool_stats)
+#endif
+  {
+    stats.wait += wait;
+    if (wait > stats.maxwait)
+      stats.maxwait = wait;
+  }
+}
+
+void PoolTimeLoop(double *A0, double *Anext, int nx, int ny, int nz, int timesteps,
+		  slab_fn body, void *arg) {
+  int mode = sync_mode(), bc = bc_kind(), nthreads = 1, t;
+  double *temp_ptr;
+
+#ifdef _OPENMP
+  nthreads = omp_get_max_threads();
+  if (omp_in_parallel())
+    nthreads = 1;
+#endif
+  if (nthreads > nz - 2)
+    nthreads = nz - 2;
+  if (nthreads > POOL_MAX_THREADS)
+    nthreads = POOL_MAX_THREADS;
+  if (nthreads < 2)
+    mode = SYNC_SERIAL;
+
+  // the first step reads the ghosts of A0
+  BoundaryApply(A0, nx, ny, nz, bc);
+
+  if (mode == SYNC_SERIAL) {
+    for (t = 0; t < timesteps; t++) {
+      body(A0, Anext, nx, ny, nz, 1, nz - 1, t, arg);
+      temp_ptr = A0;
+      A0 = Anext;
+      Anext = temp_ptr;
+    }
+    return;
+  }
+
+  stats.mode = mode;
+  stats.threads = nthreads;
+  stats.steps += timesteps;
+
+  if (mode == SYNC_FORK) {
+    pool_tsc t0, mine = 0, wait = 0;
+
+    for (t = 0; t < timesteps; t++) {
+      t0 = pool_now();
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+      {
+	int tid = 0, n = 1;
+	int k0, k1;
+	pool_tsc b0;
+#ifdef _OPENMP
+	tid = omp_get_thread_num();
+	n = omp_get_num_threads();
+#endif
+	pool_slab(tid, n, nz, &k0, &k1);
+	b0 = pool_now();
+	body(A0, Anext, nx, ny, nz, k0, k1, t, arg);
+	if (tid == 0)
+	  mine = pool_now() - b0;
+      }
+      wait += pool_now() - t0 - mine;
+      temp_ptr = A0;
+      A0 = Anext;
+      Anext = temp_ptr;
+    }
+    // the master's view stands for every thread: all of them fork and join
+    stats.wait += (double) wait * nthreads;
+    if (wait > stats.maxwait)
+      stats.maxwait = wait;
+    return;
+  }
+
+  bar_count.v = 0;
+  bar_sense.v = 0;
+  tree_release.v = 0;
+  for (t = 0; t < nthreads; t++)
+    tree_arrive[t].v = progress[t].v = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+  {
+    double *a = A0, *b = Anext, *tmp;
+    long sense = 0, episode = 0;
+    pool_tsc w0, wait = 0;
+    int tid = 0, n = 1, k0, k1, s;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+    n = omp_get_num_threads();
+#endif
+    pool_slab(tid, n, nz, &k0, &k1);
+
+    for (s = 0; s < timesteps; s++) {
+      if (mode == SYNC_NEIGHBOR && s > 0) {
+	w0 = pool_now();
+	neighbor_wait(tid, n, s, bc == BC_PERIODIC);
+	wait += pool_now() - w0;
+      }
+      body(a, b, nx, ny, nz, k0, k1, s, arg);
+
+      w0 = pool_now();
+      if (mode == SYNC_NEIGHBOR)
+	__atomic_store_n(&progress[tid].v, s + 1, __ATOMIC_RELEASE);
+      else if (mode == SYNC_SENSE)
+	sense_barrier(n, &sense);
+      else if (mode == SYNC_TREE)
+	tree_barrier(tid, n, &episode);
+      else {
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+      }
+      wait += pool_now() - w0;
+      tmp = a;
+      a = b;
+      b = tmp;
+    }
+    add_wait(wait);
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef _POOL_H_
+#define _POOL_H_
+
+/*
+  Threaded time loop for the single-sweep kernels.  The grid's interior
+  planes are split into one z-slab per thread and every timestep each
+  thread updates its slab; the kernel only supplies the slab update.  How
+  the threads are kept in step is chosen with STENCILPROBE_SYNC:
+
+    serial    no threads, the original loop (the default)
+    fork      a parallel region per timestep (fork/join every step)
+    omp       one parallel region for the whole run, omp barrier per step
+    sense     one region, centralized sense-reversing spin barrier
+    tree      one region, 4-ary arrival tree with a broadcast release
+    neighbor  one region, no barrier: before step t a slab only waits for
+              its two neighbors to finish step t-1
+
+  One region for the whole run keeps the workers alive and spinning
+  between steps instead of parking them in the OpenMP runtime.  Spinning
+  threads yield the cpu after POOL_SPINS polls, so oversubscribed runs
+  still make progress.  Runs inside another parallel region, with one
+  thread, or with fewer interior planes than threads fall back to serial.
+  Threading is opt-in, so the plain probes stay comparable with earlier
+  single-threaded results; the drivers that sweep thread counts (scaling,
+  bench, energy) pick neighbor unless STENCILPROBE_SYNC says otherwise.
+*/
+
+#define SYNC_SERIAL   0
+#define SYNC_FORK     1
+#define SYNC_OMP      2
+#define SYNC_SENSE    3
+#define SYNC_TREE     4
+#define SYNC_NEIGHBOR 5
+#define SYNC_MODES    6
+
+#define POOL_MAX_THREADS 256
+#define POOL_SPINS 1024
+
+/* updates planes k0..k1-1 of Anext from A0 in timestep step (0-based) */
+typedef void (*slab_fn)(double *A0, double *Anext, int nx, int ny, int nz,
+			int k0, int k1, int step, void *arg);
+
+/* the interior planes k0..k1-1 that thread tid of n updates */
+static inline void pool_slab(int tid, int n, int nz, int *k0, int *k1) {
+  *k0 = 1 + tid * (nz - 2) / n;
+  *k1 = 1 + (tid + 1) * (nz - 2) / n;
+}
+
+/*
+  Runs timesteps steps of body over the interior planes, swapping A0 and
+  Anext after each, as the kernels' own time loops do.  The ghosts of A0
+  are set to the boundary condition (boundary.h) first; body fills the
+  ghosts its planes feed in Anext.
+ */
+void PoolTimeLoop(double *A0, double *Anext, int nx, int ny, int nz, int timesteps,
+		  slab_fn body, void *arg);
+
+/* the mode from STENCILPROBE_SYNC, unless PoolSetSync(mode >= 0) overrides it */
+int sync_mode();
+void PoolSetSync(int mode);
+
+/* for thread-count sweeps: neighbor sync unless STENCILPROBE_SYNC is set */
+void PoolThreaded();
+const char *sync_name(int mode);
+
+/*
+  Synchronization cost.  Each thread times its waits (for fork, the
+  master times the region minus its own slab); PoolReport prints the mean
+  wait per step per thread and the largest per-thread total since the
+  last PoolReset.
+ */
+void PoolReset();
+void PoolReport(double spt);
+
+#endif
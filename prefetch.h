@@ -0,0 +1,79 @@
+#ifndef _PREFETCH_H_
+#define _PREFETCH_H_
+
+/*
+  Software prefetch control shared by the kernels.
+
+  Each kernel reads its settings once per call with prefetch_init().  The
+  distance (in rows, or in planes for the plane-streaming kernel) and the
+  locality hint come from the environment, so a search script can sweep
+  them without recompiling:
+
+    STENCILPROBE_<KERNEL>_PF_DIST / STENCILPROBE_<KERNEL>_PF_HINT
+    STENCILPROBE_PF_DIST          / STENCILPROBE_PF_HINT   (all kernels)
+
+  A distance of 0 disables the prefetches.  The hint is the
+  __builtin_prefetch locality, 0 (no temporal locality) to 3 (keep in all
+  levels).
+*/
+
+/* doubles per 64-byte cache line */
+#define PREFETCH_STRIDE 8
+
+typedef struct {
+  int dist;
+  int hint;
+} prefetch_t;
+
+void prefetch_init(prefetch_t *pf, const char *kernel, int dflt_dist);
+
+/* __builtin_prefetch needs compile-time constant arguments */
+#ifdef __GNUC__
+#define PREFETCH_HINTED(_addr, _rw, _hint)				\
+  switch (_hint) {							\
+  case 0: __builtin_prefetch((_addr), (_rw), 0); break;			\
+  case 1: __builtin_prefetch((_addr), (_rw), 1); break;			\
+  case 2: __builtin_prefetch((_addr), (_rw), 2); break;			\
+  default: __builtin_prefetch((_addr), (_rw), 3); break;		\
+  }
+#else
+#define PREFETCH_HINTED(_addr, _rw, _hint)
+#endif
+
+/* Prefetches n doubles starting at p for reading. */
+static inline void prefetch_read(const double *p, int n, int hint) {
+  int i;
+
+  for (i = 0; i < n; i += PREFETCH_STRIDE) { PREFETCH_HINTED(&p[i], 0, hint); }
+}
+
+/* Prefetches n doubles starting at p for writing. */
+static inline void prefetch_write(double *p, int n, int hint) {
+  int i;
+
+  for (i = 0; i < n; i += PREFETCH_STRIDE) { PREFETCH_HINTED(&p[i], 1, hint); }
+}
+
+/*
+  Row-level prefetch used inside the j loops: given the start of the row
+  about to be swept in a stream that ends at end, prefetches the row
+  pf->dist rows of length nx further along (which rolls over into the next
+  plane at the end of a plane).
+*/
+static inline void prefetch_row_ahead(const double *row, const double *end,
+				      int nx, int n, const prefetch_t *pf) {
+  const double *p = row + (long) pf->dist * nx;
+
+  if (p + n <= end)
+    prefetch_read(p, n, pf->hint);
+}
+
+static inline void prefetch_row_ahead_write(double *row, const double *end,
+					    int nx, int n, const prefetch_t *pf) {
+  double *p = row + (long) pf->dist * nx;
+
+  if (p + n <= end)
+    prefetch_write(p, n, pf->hint);
+}
+
+#endif
@@ -4,6 +4,49 @@
 */
 #include <stdio.h>
 #include "common.h"
+#include "prefetch.h"
+#include "phase.h"
+#include "pool.h"
+#include "boundary.h"
+
+typedef struct {
+  double fac;
+  prefetch_t pf;
+  int bc;
+} naive_arg;
+
+/* one timestep over planes k0..k1-1, each plane's ghosts filled while it is in cache */
+static void naive_slab(double *A0, double *Anext, int nx, int ny, int nz,
+		       int k0, int k1, int step, void *arg) {
+  const naive_arg *a = (const naive_arg *) arg;
+  double fac = a->fac;
+  long last = (long) nx * ny * nz;
+  int i, j, k;
+  PHASE_VARS;
+
+  PHASE_START();
+  for (k = k0; k < k1; k++) {
+    for (j = 1; j < ny - 1; j++) {
+      if (a->pf.dist) {
+	prefetch_row_ahead(&A0[Index3D (nx, ny, 0, j, k + 1)], A0 + last, nx, nx, &a->pf);
+	prefetch_row_ahead_write(&Anext[Index3D (nx, ny, 0, j, k)], Anext + last, nx, nx, &a->pf);
+      }
+      for (i = 1; i < nx - 1; i++) {
+	Anext[Index3D (nx, ny, i, j, k)] = 
+	  A0[Index3D (nx, ny, i, j, k + 1)] +
+	  A0[Index3D (nx, ny, i, j, k - 1)] +
+	  A0[Index3D (nx, ny, i, j + 1, k)] +
+	  A0[Index3D (nx, ny, i, j - 1, k)] +
+	  A0[Index3D (nx, ny, i + 1, j, k)] +
+	  A0[Index3D (nx, ny, i - 1, j, k)]
+	  - 6.0 * A0[Index3D (nx, ny, i, j, k)] / (fac*fac);
+      }
+    }
+    boundary_plane(Anext, nx, ny, nz, k, a->bc);
+  }
+  PHASE_LAP(PHASE_COMPUTE);
+  PHASE_FLUSH();
+}
 
 #ifdef STENCILTEST
 void StencilProbe_naive(double* A0, double* Anext, int nx, int ny, int nz,
@@ -12,28 +55,11 @@ void StencilProbe_naive(double* A0, double* Anext, int nx, int ny, int nz,
 void StencilProbe(double *A0, double *Anext, int nx, int ny, int nz,
                   int tx, int ty, int tz, int timesteps) {
 #endif
+  naive_arg a;
+
   // Fool compiler so it doesn't insert a constant here
-  double fac = A0[0];
-  double *temp_ptr;
-  int i, j, k, t;
-  
-  for (t = 0; t < timesteps; t++) {
-    for (k = 1; k < nz - 1; k++) {
-      for (j = 1; j < ny - 1; j++) {
-	for (i = 1; i < nx - 1; i++) {
-	  Anext[Index3D (nx, ny, i, j, k)] = 
-	    A0[Index3D (nx, ny, i, j, k + 1)] +
-	    A0[Index3D (nx, ny, i, j, k - 1)] +
-	    A0[Index3D (nx, ny, i, j + 1, k)] +
-	    A0[Index3D (nx, ny, i, j - 1, k)] +
-	    A0[Index3D (nx, ny, i + 1, j, k)] +
-	    A0[Index3D (nx, ny, i - 1, j, k)]
-	    - 6.0 * A0[Index3D (nx, ny, i, j, k)] / (fac*fac);
-	}
-      }
-    }
-    temp_ptr = A0;
-    A0 = Anext;
-    Anext = temp_ptr;
-  }
+  a.fac = A0[0];
+  a.bc = bc_kind();
+  prefetch_init(&a.pf, "NAIVE", 0);
+  PoolTimeLoop(A0, Anext, nx, ny, nz, timesteps, naive_slab, &a);
 }
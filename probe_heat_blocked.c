@@ -3,10 +3,81 @@
 	Implements 7pt stencil from Chombo's heattut example with cache blocking.
 */
 #include "common.h"
+#include "prefetch.h"
+#include "phase.h"
+#include "pool.h"
+#include "boundary.h"
+#include "active.h"
 #define MIN(x,y) (x < y ? x : y)
-#define TI tx
-#define TJ ty
-#define TK tz
+#define TI a->tx
+#define TJ a->ty
+
+typedef struct {
+  double fac;
+  prefetch_t pf;
+  int tx, ty, bc;
+  active_map active;		/* this call's changed tiles */
+} blocked_arg;
+
+/*
+  one timestep over planes k0..k1-1, in TI x TJ columns; a plane is only
+  complete after the last column, so the ghosts follow the whole slab.
+  With active tiles (active.h) a tile whose inputs did not change last
+  step is skipped, and a computed one records whether its values moved.
+*/
+static void blocked_slab(double *A0, double *Anext, int nx, int ny, int nz,
+			 int k0, int k1, int step, void *arg) {
+  const blocked_arg *a = (const blocked_arg *) arg;
+  double fac = a->fac;
+  long last = (long) nx * ny * nz, computed = 0, skipped = 0;
+  int i, ii, j, jj, k, changed;
+  PHASE_VARS;
+
+  PHASE_START();
+  for (jj = 1; jj < ny-1; jj+=TJ) {
+    for (ii = 1; ii < nx - 1; ii+=TI) {
+      for (k = k0; k < k1; k++) {
+	if (a->active.on) {
+	  if (!active_needed(&a->active, k, (ii - 1) / TI, (jj - 1) / TJ, step)) {
+	    skipped++;
+	    continue;
+	  }
+	  computed++;
+	}
+	changed = 0;
+	for (j = jj; j < MIN(jj+TJ,ny - 1); j++) {
+	  if (a->pf.dist) {
+	    prefetch_row_ahead(&A0[Index3D (nx, ny, ii, j, k + 1)], A0 + last,
+			       nx, MIN(ii+TI,nx - 1) - ii, &a->pf);
+	    prefetch_row_ahead_write(&Anext[Index3D (nx, ny, ii, j, k)], Anext + last,
+				     nx, MIN(ii+TI,nx - 1) - ii, &a->pf);
+	  }
+	  for (i = ii; i < MIN(ii+TI,nx - 1); i++) {
+	    Anext[Index3D (nx, ny, i, j, k)] = 
+	      A0[Index3D (nx, ny, i, j, k + 1)] +
+	      A0[Index3D (nx, ny, i, j, k - 1)] +
+	      A0[Index3D (nx, ny, i, j + 1, k)] +
+	      A0[Index3D (nx, ny, i, j - 1, k)] +
+	      A0[Index3D (nx, ny, i + 1, j, k)] +
+	      A0[Index3D (nx, ny, i - 1, j, k)]
+	      - 6.0 * A0[Index3D (nx, ny, i, j, k)] / (fac*fac);
+	  }
+	  // the row is still in L1; kept out of the update loop above
+	  if (a->active.on)
+	    for (i = ii; i < MIN(ii+TI,nx - 1); i++)
+	      changed |= Anext[Index3D (nx, ny, i, j, k)] != A0[Index3D (nx, ny, i, j, k)];
+	}
+	if (changed)
+	  *active_stamp(&a->active, k, (ii - 1) / TI, (jj - 1) / TJ) = step;
+      }
+    }
+  }
+  if (a->active.on)
+    ActiveCount(computed, skipped);
+  boundary_slab(Anext, nx, ny, nz, k0, k1, a->bc);
+  PHASE_LAP(PHASE_COMPUTE);
+  PHASE_FLUSH();
+}
 
 #ifdef STENCILTEST
 void StencilProbe_rivera(double* A0, double* Anext, int nx, int ny, int nz,
@@ -15,33 +86,15 @@ void StencilProbe_rivera(double* A0, double* Anext, int nx, int ny, int nz,
 void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
                   int tx, int ty, int tz, int timesteps) {
 #endif
-  // Fool compiler so it doesn't insert a constant here
-  double fac = A0[0];
-  double *temp_ptr;
-  int t, i, ii, j, jj, k;
+  blocked_arg a;
 
-  for (t = 0; t < timesteps; t++) {
-    for (jj = 1; jj < ny-1; jj+=TJ) {
-      for (ii = 1; ii < nx - 1; ii+=TI) {
-	for (k = 1; k < nz - 1; k++) {
-	  for (j = jj; j < MIN(jj+TJ,ny - 1); j++) {
-	    for (i = ii; i < MIN(ii+TI,nx - 1); i++) {
-	      Anext[Index3D (nx, ny, i, j, k)] = 
-		A0[Index3D (nx, ny, i, j, k + 1)] +
-		A0[Index3D (nx, ny, i, j, k - 1)] +
-		A0[Index3D (nx, ny, i, j + 1, k)] +
-		A0[Index3D (nx, ny, i, j - 1, k)] +
-		A0[Index3D (nx, ny, i + 1, j, k)] +
-		A0[Index3D (nx, ny, i - 1, j, k)]
-		- 6.0 * A0[Index3D (nx, ny, i, j, k)] / (fac*fac);
-	    }
-	  }
-	}
-      }
-    }
-    temp_ptr = A0;
-    A0 = Anext;
-    Anext = temp_ptr;
-  }
+  // Fool compiler so it doesn't insert a constant here
+  a.fac = A0[0];
+  a.tx = tx;
+  a.ty = ty;
+  a.bc = bc_kind();
+  prefetch_init(&a.pf, "BLOCKED", 0);
+  ActiveInit(&a.active, A0, Anext, nx, ny, nz, tx, ty, a.bc);
+  PoolTimeLoop(A0, Anext, nx, ny, nz, timesteps, blocked_slab, &a);
+  ActiveFree(&a.active);
 }
-    
@@ -16,44 +16,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "common.h"
+#include "prefetch.h"
+#include "circqueue.h"
+#include "phase.h"
 #define MAX(x,y) (x > y ? x : y)
 
-double *queuePlanes, *queuePlane0, *queuePlane1, *queuePlane2;
-int *queuePlanesIndices;
-
-/* This method creates the circular queues that will be needed for the
-   circular_queue() method.  It is only called when more than one iteration
-   is being performed. */
-void CircularQueueInit(int nx, int ty, int timesteps) {
-  int numPointsInQueuePlane, t;
-  
-  queuePlanesIndices = (int *) malloc((timesteps-1) * sizeof(int));
-  
-  if (queuePlanesIndices==NULL) {
-    printf("Error on array queuePlanesIndices malloc.\n");
-    exit(EXIT_FAILURE);
-  }
-  
-  int queuePlanesIndexPtr = 0;
-  
-  for (t=1; t < timesteps; t++) {
-    queuePlanesIndices[t-1] = queuePlanesIndexPtr;
-    numPointsInQueuePlane = (ty+2*(timesteps-t)) * nx;
-    queuePlanesIndexPtr += numPointsInQueuePlane;
-  }
-
-  queuePlanes = (double *) malloc(3 * queuePlanesIndexPtr * sizeof(double));
-  
-  if (queuePlanes==NULL) {
-    printf("Error on array queuePlanes malloc.\n");
-    exit(EXIT_FAILURE);
-  }
-  
-  queuePlane0 = queuePlanes;
-  queuePlane1 = &queuePlanes[queuePlanesIndexPtr];
-  queuePlane2 = &queuePlanes[2 * queuePlanesIndexPtr];
-}
-
 /* This method traverses each slab and uses the circular queues to perform the
    specified number of iterations.  The circular queue at a given timestep is
    shrunken in the y-dimension from the circular queue at the previous timestep. */
@@ -71,10 +38,15 @@ void StencilProbe(double *A0, double *Anext, int nx, int ny, int nz,
   int readBlockUnitStride_y, writeBlockUnitStride_y;
   int readOffset, writeOffset;
   int i, j, k, s, t;
+  prefetch_t pf;
+  PHASE_VARS;
   
   double fac = A0[0];
   int numBlocks_y = (ny-2)/ty;
 
+  prefetch_init(&pf, "CIRCQUEUE", 0);
+  PHASE_START();
+
   for (s=0; s < numBlocks_y; s++) {
     for (k=1; k < (nz+timesteps-2); k++) {
       for (t=0; t < timesteps; t++) {
@@ -150,6 +122,12 @@ void StencilProbe(double *A0, double *Anext, int nx, int ny, int nz,
 
 	  // actual calculations
 	  for (j=writeBlockRealMin_y; j < writeBlockRealMax_y; j++) {
+	    // prefetch within the current slab; queue planes stay cache resident
+	    if (pf.dist && j + pf.dist < writeBlockRealMax_y) {
+	      prefetch_read(&readQueuePlane2[Index3D(nx, ny, 0, j + pf.dist, k-t) - readOffset], nx, pf.hint);
+	      if (writeQueuePlane == Anext)
+		prefetch_write(&Anext[Index3D(nx, ny, 0, j + pf.dist, k-t)], nx, pf.hint);
+	    }
 	    for (i=1; i < (nx-1); i++) {
 	      writeQueuePlane[Index3D(nx, ny, i, j, k-t) - writeOffset] = 
 		readQueuePlane0[Index3D(nx, ny, i, j, k-t) - readOffset] +
@@ -169,6 +147,10 @@ void StencilProbe(double *A0, double *Anext, int nx, int ny, int nz,
 	queuePlane1 = queuePlane2;
 	queuePlane2 = tempQueuePlane;
       }
+      // one lap per plane: a plane and timestep is only ty rows, too short
+      // to time the ghost copies and the queue rotation apart
+      PHASE_LAP(PHASE_COMPUTE);
     }
   }
+  PHASE_FLUSH();
 }
@@ -0,0 +1,124 @@
+/*
+	StencilProbe Heat Equation (fused residual norm version)
+	Implements 7pt stencil from Chombo's heattut example and, every
+	timestep, the L2 and max norms of the update (Anext - A0) that a solver
+	would use for its convergence check.  The fused kernel accumulates the
+	norms while the points are still in registers; the unfused kernel makes
+	a second pass over both grids like a separate norm routine would.
+	z-planes are distributed over OpenMP threads.
+*/
+#include <math.h>
+#include "common.h"
+#include "norm.h"
+#include "scratch.h"
+
+/* adds the per-plane partial sums in plane order */
+static void reduce_planes(const double *plane_sq, const double *plane_max,
+			  int nz, stencil_norm *norm) {
+  double sq = 0, mx = 0;
+  int k;
+
+  for (k = 1; k < nz - 1; k++) {
+    sq += plane_sq[k];
+    if (plane_max[k] > mx)
+      mx = plane_max[k];
+  }
+  norm->l2 = sqrt(sq);
+  norm->max = mx;
+}
+
+static void probe_norm(double* A0, double* Anext, int nx, int ny, int nz,
+		       int timesteps, stencil_norm *norm, int fused) {
+  // Fool compiler so it doesn't insert a constant here
+  double fac = A0[0];
+  double *plane_sq, *plane_max;
+  size_t mark = scratch_mark();
+
+  // shared by the team, so taken from the arena of the thread starting it
+  plane_sq = (double *) scratch_alloc(2 * nz * sizeof(double));
+  plane_max = plane_sq + nz;
+  norm->l2 = norm->max = 0;
+
+#pragma omp parallel
+  {
+    double *myA0 = A0, *myAnext = Anext, *temp_ptr;
+    double sq, mx, v, d;
+    int i, j, k, t;
+
+    for (t = 0; t < timesteps; t++) {
+#pragma omp for schedule(static)
+      for (k = 1; k < nz - 1; k++) {
+	sq = mx = 0;
+	for (j = 1; j < ny - 1; j++) {
+	  const double *in = &myA0[Index3D (nx, ny, 0, j, k)];
+	  double *out = &myAnext[Index3D (nx, ny, 0, j, k)];
+	  for (i = 1; i < nx - 1; i++) {
+	    v =
+	      in[i + nx*ny] +
+	      in[i - nx*ny] +
+	      in[i + nx] +
+	      in[i - nx] +
+	      in[i + 1] +
+	      in[i - 1]
+	      - 6.0 * in[i] / (fac*fac);
+	    out[i] = v;
+	    if (fused) {
+	      d = fabs(v - in[i]);
+	      sq += d * d;
+	      mx = d > mx ? d : mx;
+	    }
+	  }
+	}
+	plane_sq[k] = sq;
+	plane_max[k] = mx;
+      }
+
+      if (!fused) {
+#pragma omp for schedule(static)
+	for (k = 1; k < nz - 1; k++) {
+	  sq = mx = 0;
+	  for (j = 1; j < ny - 1; j++) {
+	    const double *in = &myA0[Index3D (nx, ny, 0, j, k)];
+	    const double *out = &myAnext[Index3D (nx, ny, 0, j, k)];
+	    for (i = 1; i < nx - 1; i++) {
+	      d = fabs(out[i] - in[i]);
+	      sq += d * d;
+	      mx = d > mx ? d : mx;
+	    }
+	  }
+	  plane_sq[k] = sq;
+	  plane_max[k] = mx;
+	}
+      }
+
+#pragma omp single
+      reduce_planes(plane_sq, plane_max, nz, norm);
+
+      temp_ptr = myA0;
+      myA0 = myAnext;
+      myAnext = temp_ptr;
+    }
+  }
+
+  scratch_release(mark);
+}
+
+void StencilProbe_norm(double* A0, double* Anext, int nx, int ny, int nz,
+		       int tx, int ty, int tz, int timesteps, stencil_norm *norm) {
+  probe_norm(A0, Anext, nx, ny, nz, timesteps, norm, 1);
+}
+
+void StencilProbe_norm_unfused(double* A0, double* Anext, int nx, int ny, int nz,
+			       int tx, int ty, int tz, int timesteps, stencil_norm *norm) {
+  probe_norm(A0, Anext, nx, ny, nz, timesteps, norm, 0);
+}
+
+#ifndef STENCILTEST
+/* plain probe entry point: runs the fused kernel and discards the norm */
+void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
+                  int tx, int ty, int tz, int timesteps) {
+  stencil_norm norm;
+
+  StencilProbe_norm(A0, Anext, nx, ny, nz, tx, ty, tz, timesteps, &norm);
+}
+#endif
@@ -1,9 +1,28 @@
 #define ds 1
 #include "run.h"
 #include "common.h"
+#include "prefetch.h"
+#include "phase.h"
+#include "trace.h"
 
 #define idx(_i,_j,_k,_nx,_ny,_nz) ((_i)+(_nx)*((_j)+(_ny)*(_k)))
 
+/*
+  State of the running call, shared by the levels of its recursion.
+  Thread-local, since batch and scaling runs call the kernel from
+  several threads at once.
+*/
+static __thread prefetch_t pf_oblivious;
+/* base cases run so far in this call, for the trace */
+static __thread int base_cases;
+
+#ifdef PROBE_PHASES
+/* time between base cases is charged to the recursion */
+static __thread phase_tsc _phase_t;
+static __thread double _phase_acc[PHASE_N];
+static __thread long _phase_laps;
+#endif
+
 void walk3(double* A[], int nx, int ny, int nz,
            int t0, int t1, int x0, int dx0, int x1, int dx1,
            int y0, int dy0, int y1, int dy1,
@@ -13,10 +32,20 @@ void walk3(double* A[], int nx, int ny, int nz,
   if (dt == 1 || (x1-x0)*(y1-y0)*(z1-z0) < CUTOFF) {
     int x,y,z,t;
     double fac = A[0][0];
+    trace_tsc tt;
     
+    PHASE_LAP(PHASE_RECURSION);
+    TRACE_START(tt);
     for (t=t0;t<t1;t++) {
       for (z=z0+(t-t0)*dz0;z<z1+(t-t0)*dz1;z++) {
 	for (y=y0+(t-t0)*dy0;y<y1+(t-t0)*dy1;y++) {
+	  if (pf_oblivious.dist) {
+	    int xs = x0+(t-t0)*dx0;
+	    prefetch_row_ahead(&A[t%2][Index3D (nx,ny,xs,y,z+1)], A[t%2] + (long) nx*ny*nz,
+			       nx, x1+(t-t0)*dx1 - xs, &pf_oblivious);
+	    prefetch_row_ahead_write(&A[(t+1)%2][Index3D (nx,ny,xs,y,z)], A[(t+1)%2] + (long) nx*ny*nz,
+				     nx, x1+(t-t0)*dx1 - xs, &pf_oblivious);
+	  }
 	  for (x=x0+(t-t0)*dx0;x<x1+(t-t0)*dx1;x++) {
 	    A[(t+1)%2][Index3D (nx,ny,x,y,z)] =
 	      (A[t%2][Index3D (nx,ny,x+1,y,z)]
@@ -30,6 +59,8 @@ void walk3(double* A[], int nx, int ny, int nz,
 	}
       }
     }
+    TRACE_TILE("oblivious", base_cases++, t0, tt);
+    PHASE_LAP(PHASE_COMPUTE);
   }
   else if (dt > 1) {
     if (2* (z1-z0) + (dz1-dz0) * dt >= 4 * ds * dt) {
@@ -61,9 +92,14 @@ void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
   double* A[2] = {A0, Anext};
   int i;
   
+  prefetch_init(&pf_oblivious, "OBLIVIOUS", 0);
+  base_cases = 0;
+  PHASE_START();
   walk3(A, nx, ny, nz,
 	0, timesteps,
 	1, 0, nx-1, 0,
 	1, 0, ny-1, 0,
 	1, 0, nz-1, 0);
+  PHASE_LAP(PHASE_RECURSION);
+  PHASE_FLUSH();
 }
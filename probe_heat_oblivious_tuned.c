@@ -0,0 +1,164 @@
+/*
+	StencilProbe Heat Equation (Tuned Cache-Oblivious version)
+	Same space-time trapezoid decomposition as probe_heat_oblivious.c, but:
+	  - the recursion is driven by an explicit stack instead of walk3()
+	  - the source/target buffers and the trapezoid bounds are computed
+	    once per timestep of a base case, not per point
+	  - the base-case cutoff is derived from the detected cache size
+	    (or STENCILPROBE_CUTOFF) instead of the fixed CUTOFF in run.h
+	A trapezoid whose children would not fit on the stack (MAX_DEPTH) is
+	computed as a base case however large it is; the first time that
+	happens the kernel says so, since the run then stops being cache
+	oblivious below that depth.
+*/
+#include <stdio.h>
+#include "run.h"
+#include "common.h"
+#include "util.h"
+#include "prefetch.h"
+#include "phase.h"
+#include "trace.h"
+
+#define ds 1
+/* the stack never holds more than (recursion depth + 1) trapezoids */
+#define MAX_DEPTH 256
+
+/* set once the MAX_DEPTH fallback has been reported */
+static int depth_warned = 0;
+
+typedef struct {
+  int t0, t1;
+  int x0, dx0, x1, dx1;
+  int y0, dy0, y1, dy1;
+  int z0, dz0, z1, dz1;
+} trapezoid;
+
+/* Picks the number of points below which a trapezoid is computed directly.
+   A base case reads one array and writes the other, so aim for half of L2. */
+static int oblivious_cutoff() {
+  long size;
+  int cutoff = probe_param("CUTOFF", 0);
+
+  if (cutoff > 0)
+    return cutoff;
+  if ((size = cache_size(2)) > 0)
+    return size / (2 * 2 * sizeof(double));
+  if ((size = cache_size(1)) > 0)
+    return size / (2 * sizeof(double));
+  return CUTOFF;
+}
+
+static void base_case(double* A[], int nx, int ny, int nz, double fac,
+		      const trapezoid* tr, const prefetch_t* pf) {
+  const int plane = nx*ny;
+  const long last = (long) plane * nz;
+  int x, y, z, t, s;
+  int xlo, xhi, ylo, yhi, zlo, zhi;
+
+  for (t = tr->t0; t < tr->t1; t++) {
+    const double *src = A[t & 1];
+    double *dst = A[(t+1) & 1];
+
+    s = t - tr->t0;
+    xlo = tr->x0 + s*tr->dx0;  xhi = tr->x1 + s*tr->dx1;
+    ylo = tr->y0 + s*tr->dy0;  yhi = tr->y1 + s*tr->dy1;
+    zlo = tr->z0 + s*tr->dz0;  zhi = tr->z1 + s*tr->dz1;
+
+    for (z = zlo; z < zhi; z++) {
+      for (y = ylo; y < yhi; y++) {
+	const double *in = &src[Index3D (nx, ny, 0, y, z)];
+	double *out = &dst[Index3D (nx, ny, 0, y, z)];
+	if (pf->dist) {
+	  prefetch_row_ahead(&in[plane + xlo], src + last, nx, xhi - xlo, pf);
+	  prefetch_row_ahead_write(&out[xlo], dst + last, nx, xhi - xlo, pf);
+	}
+	for (x = xlo; x < xhi; x++) {
+	  out[x] =
+	    in[x + plane] +
+	    in[x - plane] +
+	    in[x + nx] +
+	    in[x - nx] +
+	    in[x + 1] +
+	    in[x - 1]
+	    - 6.0 * in[x] / (fac*fac);
+	}
+      }
+    }
+  }
+}
+
+#ifdef STENCILTEST
+void StencilProbe_oblivious_tuned(double* A0, double* Anext, int nx, int ny, int nz,
+				  int tx, int ty, int tz, int timesteps) {
+#else
+void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
+                  int tx, int ty, int tz, int timesteps) {
+#endif
+  double* A[2] = {A0, Anext};
+  double fac = A0[0];
+  trapezoid stack[MAX_DEPTH];
+  trapezoid tr, *lo, *hi;
+  int top, dt, s, m;
+  int cutoff = oblivious_cutoff();
+  prefetch_t pf;
+  int base_cases = 0;
+  trace_tsc tt;
+  PHASE_VARS;
+
+  prefetch_init(&pf, "OBLIVIOUS_TUNED", 0);
+  PHASE_START();
+
+  tr.t0 = 0;  tr.t1 = timesteps;
+  tr.x0 = 1;  tr.dx0 = 0;  tr.x1 = nx-1;  tr.dx1 = 0;
+  tr.y0 = 1;  tr.dy0 = 0;  tr.y1 = ny-1;  tr.dy1 = 0;
+  tr.z0 = 1;  tr.dz0 = 0;  tr.z1 = nz-1;  tr.dz1 = 0;
+  stack[0] = tr;
+  top = 1;
+
+  /* Children are pushed second-half first so that the first half (and all
+     of its descendants) is completed before the second half is started,
+     which is the order walk3() visits them in. */
+  while (top > 0) {
+    tr = stack[--top];
+    dt = tr.t1 - tr.t0;
+
+    if (dt <= 1 || (tr.x1-tr.x0)*(tr.y1-tr.y0)*(tr.z1-tr.z0) < cutoff
+	|| top + 2 > MAX_DEPTH) {
+      if (top + 2 > MAX_DEPTH && dt > 1 && (tr.x1-tr.x0)*(tr.y1-tr.y0)*(tr.z1-tr.z0) >= cutoff
+	  && !__atomic_exchange_n(&depth_warned, 1, __ATOMIC_RELAXED))
+	printf("oblivious_tuned: recursion deeper than %d, larger trapezoids computed directly\n",
+	       MAX_DEPTH);
+      PHASE_LAP(PHASE_RECURSION);
+      TRACE_START(tt);
+      base_case(A, nx, ny, nz, fac, &tr, &pf);
+      TRACE_TILE("oblivious_tuned", base_cases++, tr.t0, tt);
+      PHASE_LAP(PHASE_COMPUTE);
+      continue;
+    }
+
+    hi = &stack[top++];
+    lo = &stack[top++];
+    *hi = tr;
+    *lo = tr;
+    if (2*(tr.z1-tr.z0) + (tr.dz1-tr.dz0)*dt >= 4*ds*dt) {
+      m = (2*(tr.z0+tr.z1) + (2*ds+tr.dz0+tr.dz1)*dt) / 4;
+      lo->z1 = m;  lo->dz1 = -ds;
+      hi->z0 = m;  hi->dz0 = -ds;
+    }
+    else if (2*(tr.y1-tr.y0) + (tr.dy1-tr.dy0)*dt >= 4*ds*dt) {
+      m = (2*(tr.y0+tr.y1) + (2*ds+tr.dy0+tr.dy1)*dt) / 4;
+      lo->y1 = m;  lo->dy1 = -ds;
+      hi->y0 = m;  hi->dy0 = -ds;
+    }
+    else {
+      s = dt/2;
+      lo->t1 = tr.t0 + s;
+      hi->t0 = tr.t0 + s;
+      hi->x0 += tr.dx0*s;  hi->x1 += tr.dx1*s;
+      hi->y0 += tr.dy0*s;  hi->y1 += tr.dy1*s;
+      hi->z0 += tr.dz0*s;  hi->z1 += tr.dz1*s;
+    }
+  }
+  PHASE_LAP(PHASE_RECURSION);
+  PHASE_FLUSH();
+}
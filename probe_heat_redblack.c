@@ -0,0 +1,31 @@
+/*
+	StencilProbe Heat Equation (red-black Gauss-Seidel version)
+	Implements 7pt stencil from Chombo's heattut example as an in-place
+	red-black smoother.  Each timestep is one sweep (red then black
+	half-sweep) over A0; Anext is not touched and the result is always
+	left in A0.
+*/
+#include "common.h"
+#include "redblack.h"
+
+#ifdef STENCILTEST
+void StencilProbe_redblack(double* A0, double* Anext, int nx, int ny, int nz,
+			   int tx, int ty, int tz, int timesteps) {
+#else
+void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
+                  int tx, int ty, int tz, int timesteps) {
+#endif
+  // Fool compiler so it doesn't insert a constant here
+  double fac = A0[0];
+  int color, j, k, t;
+
+  for (t = 0; t < timesteps; t++) {
+    for (color = 0; color < 2; color++) {
+      for (k = 1; k < nz - 1; k++) {
+	for (j = 1; j < ny - 1; j++) {
+	  redblack_row(A0, nx, ny, j, k, 1, nx - 1, color, fac);
+	}
+      }
+    }
+  }
+}
@@ -0,0 +1,46 @@
+/*
+	StencilProbe Heat Equation (tiled red-black Gauss-Seidel version)
+	In-place red-black smoother with Rivera-style i/j tiling.  The points
+	of one color are independent, so the tiles of each half-sweep are
+	distributed over OpenMP threads.  The result is always left in A0.
+*/
+#include "common.h"
+#include "redblack.h"
+#include "trace.h"
+#define MIN(x,y) (x < y ? x : y)
+
+#ifdef STENCILTEST
+void StencilProbe_redblack_blocked(double* A0, double* Anext, int nx, int ny, int nz,
+				   int tx, int ty, int tz, int timesteps) {
+#else
+void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
+                  int tx, int ty, int tz, int timesteps) {
+#endif
+  // Fool compiler so it doesn't insert a constant here
+  double fac = A0[0];
+  int ntiles_x = (nx - 2 + tx - 1) / tx;
+  int ntiles_y = (ny - 2 + ty - 1) / ty;
+  int ntiles = ntiles_x * ntiles_y;
+  int color, t, tile;
+
+#pragma omp parallel private(color, t, tile)
+  for (t = 0; t < timesteps; t++) {
+    for (color = 0; color < 2; color++) {
+#pragma omp for schedule(static)
+      for (tile = 0; tile < ntiles; tile++) {
+	int ii = 1 + (tile % ntiles_x) * tx;
+	int jj = 1 + (tile / ntiles_x) * ty;
+	int j, k;
+	trace_tsc tt;
+
+	TRACE_START(tt);
+	for (k = 1; k < nz - 1; k++) {
+	  for (j = jj; j < MIN(jj + ty, ny - 1); j++) {
+	    redblack_row(A0, nx, ny, j, k, ii, MIN(ii + tx, nx - 1), color, fac);
+	  }
+	}
+	TRACE_TILE("redblack", tile, 2*t + color, tt);
+      }
+    }
+  }
+}
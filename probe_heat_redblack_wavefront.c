@@ -0,0 +1,47 @@
+/*
+	StencilProbe Heat Equation (temporally blocked red-black version)
+	In-place red-black smoother that pipelines all 2*timesteps half-sweeps
+	through the grid in one pass over k.  Half-sweep h works on plane
+	kk - 2*h, so the planes in flight at one wavefront position kk are two
+	apart: each one's neighbors were finished by half-sweep h-1 at an
+	earlier kk and are not overwritten until a later one.  The half-sweeps
+	of one wavefront position are therefore independent and their rows
+	are distributed over OpenMP threads.  Only about 4*timesteps planes
+	are live at a time, so the grid is streamed from memory once per call
+	instead of once per half-sweep.  The result is always left in A0.
+*/
+#include "common.h"
+#include "redblack.h"
+#include "trace.h"
+
+#ifdef STENCILTEST
+void StencilProbe_redblack_wavefront(double* A0, double* Anext, int nx, int ny, int nz,
+				     int tx, int ty, int tz, int timesteps) {
+#else
+void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
+                  int tx, int ty, int tz, int timesteps) {
+#endif
+  // Fool compiler so it doesn't insert a constant here
+  double fac = A0[0];
+  int halfsweeps = 2 * timesteps;
+  int rows = ny - 2;
+  int kk, n;
+  trace_tsc tt;
+
+#pragma omp parallel private(kk, n, tt)
+  for (kk = 1; kk < nz - 1 + 2 * (halfsweeps - 1); kk++) {
+    // each thread's share of a wavefront position is one trace event
+    TRACE_START(tt);
+#pragma omp for schedule(static) nowait
+    for (n = 0; n < halfsweeps * rows; n++) {
+      int h = n / rows;
+      int j = 1 + n % rows;
+      int k = kk - 2 * h;
+
+      if (k >= 1 && k < nz - 1)
+	redblack_row(A0, nx, ny, j, k, 1, nx - 1, h & 1, fac);
+    }
+    TRACE_TILE("wavefront", kk, 0, tt);
+#pragma omp barrier
+  }
+}
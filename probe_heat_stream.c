@@ -0,0 +1,139 @@
+/*
+	StencilProbe Heat Equation (2.5D plane-streaming version)
+	Implements 7pt stencil from Chombo's heattut example.  The grid is tiled
+	in i/j like the Rivera blocking, but each tile is swept in k through a
+	rolling window of three contiguous z-planes (tile plus a one point halo)
+	so every input point is read from the grid once per sweep.  Plane
+	k+1+STENCILPROBE_STREAM_PF_DIST (default k+2) is prefetched while plane k
+	is being computed, and tiles are distributed over OpenMP threads.
+*/
+#include "common.h"
+#include "prefetch.h"
+#include "scratch.h"
+#include "phase.h"
+#include "trace.h"
+#include "boundary.h"
+#define MIN(x,y) (x < y ? x : y)
+
+/* copies the (tile + halo) part of plane k of A into buf */
+static void load_plane(double *buf, const double *A, int nx, int ny,
+		       int i0, int j0, int wx, int wy, int k) {
+  int i, j;
+
+  for (j = 0; j < wy; j++) {
+    const double *src = &A[Index3D (nx, ny, i0, j0 + j, k)];
+    double *dst = &buf[j * wx];
+    for (i = 0; i < wx; i++)
+      dst[i] = src[i];
+  }
+}
+
+/* touches plane k of the tile so it is on its way while the window is busy */
+static void prefetch_plane(const double *A, int nx, int ny,
+			   int i0, int j0, int wx, int wy, int k, int hint) {
+  int j;
+
+  for (j = 0; j < wy; j++)
+    prefetch_read(&A[Index3D (nx, ny, i0, j0 + j, k)], wx, hint);
+}
+
+#ifdef STENCILTEST
+void StencilProbe_stream(double* A0, double* Anext, int nx, int ny, int nz,
+			 int tx, int ty, int tz, int timesteps) {
+#else
+void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
+                  int tx, int ty, int tz, int timesteps) {
+#endif
+  // Fool compiler so it doesn't insert a constant here
+  double fac = A0[0];
+  int ntiles_x = (nx - 2 + tx - 1) / tx;
+  int ntiles_y = (ny - 2 + ty - 1) / ty;
+  int ntiles = ntiles_x * ntiles_y;
+  prefetch_t pf;
+  int bc = bc_kind();
+
+  prefetch_init(&pf, "STREAM", 1);
+  // the first step reads the ghosts of A0
+  BoundaryApply(A0, nx, ny, nz, bc);
+
+#pragma omp parallel
+  {
+    double *myA0 = A0, *myAnext = Anext, *temp_ptr;
+    double *window, *below, *center, *above;
+    int wx = tx + 2, wy = ty + 2;
+    int t, tile, i, j, k, ii, jj, ni, nj;
+    trace_tsc tt;
+    PHASE_VARS;
+
+    size_t mark = scratch_mark();
+
+    window = (double *) scratch_alloc(3 * wx * wy * sizeof(double));
+    PHASE_START();
+
+    for (t = 0; t < timesteps; t++) {
+#pragma omp for schedule(static)
+      for (tile = 0; tile < ntiles; tile++) {
+	TRACE_START(tt);
+	ii = 1 + (tile % ntiles_x) * tx;
+	jj = 1 + (tile / ntiles_x) * ty;
+	ni = MIN(tx, nx - 1 - ii);
+	nj = MIN(ty, ny - 1 - jj);
+
+	below = window;
+	center = window + wx * wy;
+	above = window + 2 * wx * wy;
+	load_plane(below, myA0, nx, ny, ii - 1, jj - 1, ni + 2, nj + 2, 0);
+	load_plane(center, myA0, nx, ny, ii - 1, jj - 1, ni + 2, nj + 2, 1);
+	PHASE_LAP(PHASE_COPY);
+
+	for (k = 1; k < nz - 1; k++) {
+	  load_plane(above, myA0, nx, ny, ii - 1, jj - 1, ni + 2, nj + 2, k + 1);
+	  if (pf.dist && k + 1 + pf.dist < nz)
+	    prefetch_plane(myA0, nx, ny, ii - 1, jj - 1, ni + 2, nj + 2,
+			   k + 1 + pf.dist, pf.hint);
+	  PHASE_LAP(PHASE_COPY);
+
+	  for (j = 1; j <= nj; j++) {
+	    const double *b = &below[j * (ni + 2)];
+	    const double *c = &center[j * (ni + 2)];
+	    const double *a = &above[j * (ni + 2)];
+	    double *out = &myAnext[Index3D (nx, ny, ii - 1, jj - 1 + j, k)];
+	    for (i = 1; i <= ni; i++) {
+	      out[i] =
+		a[i] +
+		b[i] +
+		c[i + (ni + 2)] +
+		c[i - (ni + 2)] +
+		c[i + 1] +
+		c[i - 1]
+		- 6.0 * c[i] / (fac*fac);
+	    }
+	  }
+
+	  PHASE_LAP(PHASE_COMPUTE);
+
+	  // rotate the window: the oldest plane becomes the next load target
+	  temp_ptr = below;
+	  below = center;
+	  center = above;
+	  above = temp_ptr;
+	}
+	TRACE_TILE("stream", tile, t, tt);
+      }
+      // tiles span the planes, so the ghosts are a pass of their own
+      if (bc != BC_DIRICHLET) {
+#pragma omp for schedule(static)
+	for (k = 1; k < nz - 1; k++)
+	  boundary_plane(myAnext, nx, ny, nz, k, bc);
+	PHASE_LAP(PHASE_COPY);
+      }
+      temp_ptr = myA0;
+      myA0 = myAnext;
+      myAnext = temp_ptr;
+      PHASE_LAP(PHASE_SWAP);
+    }
+    PHASE_FLUSH();
+
+    scratch_release(mark);
+  }
+}
@@ -13,6 +13,9 @@
  *        conforms to the above rule.
  */
 #include "common.h"
+#include "prefetch.h"
+#include "phase.h"
+#include "trace.h"
 #define MAX(x,y) (x > y ? x : y)
 
 /* This method traverses all of the cache blocks in a specific order to preserve
@@ -35,6 +38,14 @@ void StencilProbe(double *A0, double *Anext, int nx, int ny, int nz,
   int blockMin_x, blockMin_y, blockMin_z;
   int blockMax_x, blockMax_y, blockMax_z;
   int ii, jj, kk, i, j, k, t;
+  long last = (long) nx * ny * nz;
+  prefetch_t pf;
+  int block = 0;
+  trace_tsc tt;
+  PHASE_VARS;
+
+  prefetch_init(&pf, "TIMESKEW", 0);
+  PHASE_START();
 
   for (kk=1; kk < nz-1; kk+=tz) {
     neg_z_slope = 1;
@@ -71,6 +82,7 @@ void StencilProbe(double *A0, double *Anext, int nx, int ny, int nz,
 	myAnext = Anext;
 	
 	for (t=0; t < timesteps; t++) {
+	  TRACE_START(tt);
 	  blockMin_x = MAX(1, ii - t * neg_x_slope);
 	  blockMin_y = MAX(1, jj - t * neg_y_slope);
 	  blockMin_z = MAX(1, kk - t * neg_z_slope);
@@ -81,6 +93,12 @@ void StencilProbe(double *A0, double *Anext, int nx, int ny, int nz,
 	  
 	  for (k=blockMin_z; k < blockMax_z; k++) {
 	    for (j=blockMin_y; j < blockMax_y; j++) {
+	      if (pf.dist) {
+		prefetch_row_ahead(&myA0[Index3D (nx, ny, blockMin_x, j, k+1)], myA0 + last,
+				   nx, blockMax_x - blockMin_x, &pf);
+		prefetch_row_ahead_write(&myAnext[Index3D (nx, ny, blockMin_x, j, k)], myAnext + last,
+					 nx, blockMax_x - blockMin_x, &pf);
+	      }
 	      for (i=blockMin_x; i < blockMax_x; i++) {
 		myAnext[Index3D (nx, ny, i, j, k)] = 
 		  myA0[Index3D (nx, ny, i, j, k+1)] +
@@ -93,11 +111,16 @@ void StencilProbe(double *A0, double *Anext, int nx, int ny, int nz,
 	      }
 	    }
 	  }
+	  TRACE_TILE("timeskew", block, t, tt);
 	  temp_ptr = myA0;
 	  myA0 = myAnext;
 	  myAnext = temp_ptr;
 	}
+	// one lap per block: the pointer swaps are too short to time apart
+	PHASE_LAP(PHASE_COMPUTE);
+	block++;
       }
     }
   }
+  PHASE_FLUSH();
 }
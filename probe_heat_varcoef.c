@@ -0,0 +1,34 @@
+/*
+	StencilProbe Heat Equation (variable coefficient version)
+	7pt stencil with per-cell coefficient grids streamed alongside the
+	solution (see coef.h).  The coefficients come from stencil_coefs,
+	which must be set up with CoefInit() first.
+*/
+#include "common.h"
+#include "coef.h"
+
+#ifdef STENCILTEST
+void StencilProbe_varcoef(double* A0, double* Anext, int nx, int ny, int nz,
+			  int tx, int ty, int tz, int timesteps) {
+#else
+void StencilProbe(double* A0, double* Anext, int nx, int ny, int nz,
+                  int tx, int ty, int tz, int timesteps) {
+#endif
+  const coef_set *cs = &stencil_coefs;
+  const int plane = nx*ny;
+  double *temp_ptr;
+  int j, k, t;
+  
+  for (t = 0; t < timesteps; t++) {
+    for (k = 1; k < nz - 1; k++) {
+      for (j = 1; j < ny - 1; j++) {
+	long p = Index3D (nx, ny, 1, j, k);
+	varcoef_row(&Anext[p], &A0[p - plane], &A0[p], &A0[p + plane],
+		    nx, cs, p, nx - 2);
+      }
+    }
+    temp_ptr = A0;
+    A0 = Anext;
+    Anext = temp_ptr;
+  }
+}
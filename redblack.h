@@ -0,0 +1,33 @@
+#ifndef _REDBLACK_H_
+#define _REDBLACK_H_
+
+#include "common.h"
+
+/*
+  In-place red-black Gauss-Seidel update shared by the probe_heat_redblack*
+  kernels.  A point is red (color 0) when i+j+k is even and black (color 1)
+  otherwise.  Every neighbor of a point has the other color, so all points
+  of one color can be updated in any order, and one sweep is a red
+  half-sweep followed by a black half-sweep.
+*/
+
+/* updates the points of the given color in [ilo,ihi) of row (j,k) */
+static inline void redblack_row(double *A, int nx, int ny, int j, int k,
+				int ilo, int ihi, int color, double fac) {
+  double *p = &A[Index3D (nx, ny, 0, j, k)];
+  const int plane = nx*ny;
+  int i = ilo + ((ilo + j + k + color) & 1);
+
+  for (; i < ihi; i += 2) {
+    p[i] =
+      p[i + plane] +
+      p[i - plane] +
+      p[i + nx] +
+      p[i - nx] +
+      p[i + 1] +
+      p[i - 1]
+      - 6.0 * p[i] / (fac*fac);
+  }
+}
+
+#endif
@@ -0,0 +1,98 @@
+/*
+	Stencil Probe scratch memory
+	Per-thread arenas for kernel temporaries.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "scratch.h"
+#include "topology.h"
+
+#define SCRATCH_MAX_THREADS 256
+
+static arena thread_arenas[SCRATCH_MAX_THREADS];
+static size_t thread_bytes = 0;
+
+/*
+  The caller's thread number in the outermost parallel region: the pool
+  places threads by number, so arena t stays on the node of thread t's
+  cpu even if the runtime replaces the thread behind that number.  The
+  kernels' own regions nested inside another one run inactive, one
+  thread each, on the arena of the thread that entered them.
+*/
+static int thread_id() {
+#ifdef _OPENMP
+  if (omp_get_level() > 0)
+    return omp_get_ancestor_thread_num(1);
+#endif
+  return 0;
+}
+
+arena *scratch_arena() {
+  int id = thread_id();
+
+  if (id >= SCRATCH_MAX_THREADS || thread_arenas[id].base == NULL) {
+    printf("Error: thread %d has no scratch memory; ScratchInit() must be called "
+	   "with the thread count the kernels use.\n", id);
+    exit(EXIT_FAILURE);
+  }
+  return &thread_arenas[id];
+}
+
+void ScratchInit(int nx, int ny, int nz, int tx, int ty, int timesteps) {
+  size_t bytes = 0, queue = 0;
+  int t;
+
+  // circular queues: timesteps-1 queues of three (ty+2*(timesteps-t))*nx planes
+  if (timesteps > 1) {
+    for (t = 1; t < timesteps; t++)
+      queue += (size_t) (ty + 2*(timesteps-t)) * nx;
+    bytes += ARENA_SIZE(3 * queue * sizeof(double))
+      + ARENA_SIZE((timesteps-1) * sizeof(int));
+  }
+  // plane-streaming window: three (tile + halo) planes
+  bytes += ARENA_SIZE(3 * (size_t) (tx+2) * (ty+2) * sizeof(double));
+  // residual norm partials: two doubles per z-plane
+  bytes += ARENA_SIZE(2 * (size_t) nz * sizeof(double));
+  // active-tile map: one stamp per tile column per plane
+  bytes += ARENA_SIZE((size_t) nz * ((nx - 2 + tx - 1) / tx) * ((ny - 2 + ty - 1) / ty) * sizeof(int));
+
+  // arenas are never resized: the circular queues keep theirs across calls
+  if (thread_bytes == 0)
+    thread_bytes = bytes;
+  else if (bytes > thread_bytes) {
+    printf("Error: scratch arenas hold %lu bytes per thread, this run needs %lu; "
+	   "ScratchInit() must be called for the largest run first.\n",
+	   (unsigned long) thread_bytes, (unsigned long) bytes);
+    exit(EXIT_FAILURE);
+  }
+
+  /*
+    The threads the pool runs, pinned as TopoPin places them, each
+    allocate and touch their own arena, so first-touch puts it on the
+    node of the cpu the thread will run the kernels on.
+  */
+  TopoPin();
+  t = 1;
+#ifdef _OPENMP
+  t = omp_get_max_threads();
+#endif
+  if (t > SCRATCH_MAX_THREADS) {
+    printf("Error: more than %d threads asked for scratch memory.\n", SCRATCH_MAX_THREADS);
+    exit(EXIT_FAILURE);
+  }
+#ifdef _OPENMP
+#pragma omp parallel num_threads(t)
+#endif
+  {
+    arena *a = &thread_arenas[thread_id()];
+
+    if (a->base == NULL) {
+      arena_init(a, thread_bytes);
+      memset(a->base, 0, a->size);
+    }
+  }
+}
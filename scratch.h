@@ -0,0 +1,43 @@
+#ifndef _SCRATCH_H_
+#define _SCRATCH_H_
+
+#include <stddef.h>
+#include "arena.h"
+
+/*
+  Per-thread scratch memory for the kernels (queue planes, plane windows,
+  reduction partials, active-tile maps).  Every thread of the pool has its own arena,
+  allocated and first-touched by that thread, so the timed kernel calls
+  never malloc or page-fault.  Buffers shared by an OpenMP team are
+  taken from the arena of the thread that starts the team.
+
+  Kernels use the arenas stack-style:
+
+    size_t mark = scratch_mark();
+    buf = scratch_alloc(bytes);
+    ...
+    scratch_release(mark);
+*/
+
+/*
+  Sizes the arenas for the given run parameters (enough for any of the
+  probe kernels; none needs scratch that grows with tz) and gives every thread of the pool (omp_get_max_threads,
+  pinned by TopoPin) its own, allocated and first-touched by that thread.
+  Must be called outside of kernels.  The arenas are sized once: a later
+  call may add arenas for threads that have none, but exits if its run
+  needs more bytes, so drivers that sweep sizes call it for the largest
+  run first.
+ */
+void ScratchInit(int nx, int ny, int nz, int tx, int ty, int timesteps);
+
+/*
+  The calling thread's arena.  Exits if the thread has none; a request
+  the arena cannot hold exits in arena_alloc.  Neither ever allocates.
+*/
+arena *scratch_arena();
+
+#define scratch_alloc(_bytes) arena_alloc(scratch_arena(), (_bytes))
+#define scratch_mark() arena_mark(scratch_arena())
+#define scratch_release(_mark) arena_release(scratch_arena(), (_mark))
+
+#endif
@@ -0,0 +1,381 @@
+/*
+	Stencil Probe topology
+	Cpu/NUMA discovery from sysfs, thread pinning and page placement.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "topology.h"
+#include "pool.h"
+
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1<<1)
+#endif
+
+/* triad repetitions for the bandwidth calibration; the best one counts */
+#define TOPO_TRIALS 5
+
+topology stencil_topo;
+
+static const char *policy_names[] = { "none", "compact", "scatter", "core", "smt" };
+
+static int initialized = 0;
+static cpu_set_t allowed;
+
+static int read_int(const char *path, int dflt) {
+  FILE *f;
+  int v;
+
+  if ((f = fopen(path, "r")) == NULL)
+    return dflt;
+  if (fscanf(f, "%d", &v) != 1)
+    v = dflt;
+  fclose(f);
+  return v;
+}
+
+/* marks the cpus of a sysfs cpu list ("0-3,8,10-11"); returns 0 if unreadable */
+static int read_cpulist(const char *path, char *mark) {
+  FILE *f;
+  int lo, hi, c;
+  char sep;
+
+  if ((f = fopen(path, "r")) == NULL)
+    return 0;
+  while (fscanf(f, "%d", &lo) == 1) {
+    hi = lo;
+    sep = (char) fgetc(f);
+    if (sep == '-') {
+      if (fscanf(f, "%d", &hi) != 1)
+	break;
+      sep = (char) fgetc(f);
+    }
+    for (c = lo; c <= hi && c < TOPO_MAX_CPUS; c++)
+      mark[c] = 1;
+    if (sep != ',')
+      break;
+  }
+  fclose(f);
+  return 1;
+}
+
+void TopoInit() {
+  topology *tp = &stencil_topo;
+  char path[128], mark[TOPO_MAX_CPUS];
+  int core_pkg[TOPO_MAX_CPUS], core_id[TOPO_MAX_CPUS], core_node[TOPO_MAX_CPUS];
+  int c, n, i, id, pkg;
+
+  if (initialized)
+    return;
+  initialized = 1;
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+    CPU_ZERO(&allowed);
+    for (c = 0; c < nproc && c < CPU_SETSIZE; c++)
+      CPU_SET(c, &allowed);
+  }
+
+  tp->ncpus = tp->ncores = tp->nnodes = 0;
+  for (c = 0; c < TOPO_MAX_CPUS && c < CPU_SETSIZE; c++) {
+    topo_cpu *cpu;
+
+    if (!CPU_ISSET(c, &allowed))
+      continue;
+    cpu = &tp->cpus[tp->ncpus++];
+    cpu->cpu = c;
+    cpu->node = 0;
+    sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", c);
+    pkg = read_int(path, 0);
+    sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/core_id", c);
+    id = read_int(path, c);
+    cpu->package = pkg;
+
+    for (i = 0; i < tp->ncores; i++)
+      if (core_pkg[i] == pkg && core_id[i] == id)
+	break;
+    if (i == tp->ncores) {
+      core_pkg[i] = pkg;
+      core_id[i] = id;
+      tp->ncores++;
+    }
+    cpu->core = i;
+  }
+
+  for (n = 0; n < TOPO_MAX_NODES; n++) {
+    memset(mark, 0, sizeof(mark));
+    sprintf(path, "/sys/devices/system/node/node%d/cpulist", n);
+    if (!read_cpulist(path, mark))
+      continue;
+    for (i = 0; i < tp->ncpus; i++)
+      if (mark[tp->cpus[i].cpu])
+	tp->cpus[i].node = n;
+  }
+
+  /* ranks of siblings within a core and of cores within a node */
+  for (i = 0; i < tp->ncores; i++)
+    core_node[i] = -1;
+  for (i = 0; i < tp->ncpus; i++) {
+    topo_cpu *cpu = &tp->cpus[i];
+
+    cpu->smt = 0;
+    for (c = 0; c < i; c++)
+      if (tp->cpus[c].core == cpu->core)
+	cpu->smt++;
+    core_node[cpu->core] = cpu->node;
+    if (cpu->node + 1 > tp->nnodes)
+      tp->nnodes = cpu->node + 1;
+  }
+  for (i = 0; i < tp->ncpus; i++) {
+    topo_cpu *cpu = &tp->cpus[i];
+
+    cpu->core_rank = 0;
+    for (c = 0; c < cpu->core; c++)
+      if (core_node[c] == cpu->node)
+	cpu->core_rank++;
+  }
+
+  tp->policy = TOPO_NONE;
+  tp->nthreads = 1;
+}
+
+/* sort key of a cpu under the current policy, most significant first */
+static void policy_key(const topo_cpu *c, int key[3]) {
+  switch (stencil_topo.policy) {
+  case TOPO_SCATTER:
+    key[0] = c->smt; key[1] = c->core_rank; key[2] = c->node; break;
+  case TOPO_CORE:
+    key[0] = c->smt; key[1] = c->node; key[2] = c->core; break;
+  case TOPO_SMT:
+    key[0] = c->core_rank; key[1] = c->node; key[2] = c->smt; break;
+  default:
+    key[0] = c->node; key[1] = c->core; key[2] = c->smt; break;
+  }
+}
+
+static int compare_cpus(const void *a, const void *b) {
+  int ka[3], kb[3], i;
+
+  policy_key(&stencil_topo.cpus[*(const int *) a], ka);
+  policy_key(&stencil_topo.cpus[*(const int *) b], kb);
+  for (i = 0; i < 3; i++)
+    if (ka[i] != kb[i])
+      return ka[i] - kb[i];
+  return 0;
+}
+
+static void pin_self(int cpu) {
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  sched_setaffinity(0, sizeof(set), &set);
+}
+
+/* pins every pool thread to its place, or releases it under TOPO_NONE */
+static void pin_pool() {
+  topology *tp = &stencil_topo;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    int t = 0;
+#ifdef _OPENMP
+    t = omp_get_thread_num();
+#endif
+    if (tp->policy == TOPO_NONE)
+      sched_setaffinity(0, sizeof(allowed), &allowed);
+    else
+      pin_self(tp->cpus[tp->place[t]].cpu);
+  }
+}
+
+void TopoPin() {
+  topology *tp = &stencil_topo;
+  int order[TOPO_MAX_CPUS];
+  char *val;
+  int p, t;
+
+  TopoInit();
+
+  tp->policy = TOPO_NONE;
+  val = getenv("STENCILPROBE_AFFINITY");
+  if (val != NULL) {
+    for (p = 0; p < (int) (sizeof(policy_names)/sizeof(policy_names[0])); p++)
+      if (strcmp(val, policy_names[p]) == 0)
+	tp->policy = p;
+  }
+
+  tp->nthreads = 1;
+#ifdef _OPENMP
+  tp->nthreads = omp_get_max_threads();
+#endif
+  if (tp->nthreads > TOPO_MAX_CPUS)
+    tp->nthreads = TOPO_MAX_CPUS;
+
+  for (p = 0; p < tp->ncpus; p++)
+    order[p] = p;
+  qsort(order, tp->ncpus, sizeof(int), compare_cpus);
+  for (t = 0; t < tp->nthreads; t++)
+    tp->place[t] = order[t % tp->ncpus];
+
+  if (tp->policy != TOPO_NONE)
+    pin_pool();
+}
+
+/* binds [lo, hi) to node, moving pages that are already there */
+static void bind_range(char *lo, char *hi, int node) {
+#ifdef SYS_mbind
+  unsigned long mask[TOPO_MAX_NODES/(8*sizeof(unsigned long)) + 1];
+
+  if (hi <= lo)
+    return;
+  memset(mask, 0, sizeof(mask));
+  mask[node / (8*sizeof(unsigned long))] |= 1UL << (node % (8*sizeof(unsigned long)));
+  syscall(SYS_mbind, lo, (unsigned long) (hi - lo), MPOL_BIND, mask,
+	  (unsigned long) (8*sizeof(mask)), MPOL_MF_MOVE);
+#endif
+}
+
+void TopoBindGrid(double *A, int nx, int ny, int nz) {
+  topology *tp = &stencil_topo;
+  size_t plane = (size_t) nx * ny * sizeof(double);
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  size_t first = ((size_t) A + page - 1) / page * page;
+  size_t last = ((size_t) A + nz * plane) / page * page;
+  int n = tp->nthreads, t, k0, k1;
+
+  if (tp->policy == TOPO_NONE || tp->nnodes < 2 || nz < 3)
+    return;
+
+  /*
+    The pool's slabs (pool.h), the ghost planes going with the first and
+    last.  Slab edges are rounded down to a page; the partly filled pages
+    at either end of the array are left alone, since they may hold other
+    allocations.
+  */
+  if (n > nz - 2)
+    n = nz - 2;
+  for (t = 0; t < n; t++) {
+    size_t lo, hi;
+
+    pool_slab(t, n, nz, &k0, &k1);
+    lo = ((size_t) A + k0 * plane) / page * page;
+    hi = ((size_t) A + k1 * plane) / page * page;
+    if (t == 0 || lo < first)
+      lo = first;
+    if (t == n - 1 || hi > last)
+      hi = last;
+    bind_range((char *) lo, (char *) hi, tp->cpus[tp->place[t]].node);
+  }
+}
+
+void TopoReport() {
+  topology *tp = &stencil_topo;
+  int t;
+
+  TopoInit();
+  printf("topology: %d cpus, %d cores, %d nodes\n", tp->ncpus, tp->ncores, tp->nnodes);
+  printf("affinity: %s, %d threads\n", policy_names[tp->policy], tp->nthreads);
+  if (tp->policy == TOPO_NONE)
+    return;
+  for (t = 0; t < tp->nthreads; t++) {
+    const topo_cpu *c = &tp->cpus[tp->place[t]];
+    printf("  thread %d: cpu %d (core %d, smt %d, node %d)\n",
+	   t, c->cpu, c->core, c->smt, c->node);
+  }
+}
+
+static double now() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+double TopoNodeBandwidth(int node, size_t bytes) {
+  topology *tp = &stencil_topo;
+  int cpus[TOPO_MAX_CPUS];
+  double *a, *b, *c, best = 0;
+  long n = (long) (bytes / (3 * sizeof(double)));
+  int ncpus = 0, i;
+
+  TopoInit();
+  for (i = 0; i < tp->ncpus; i++)
+    if (tp->cpus[i].node == node)
+      cpus[ncpus++] = tp->cpus[i].cpu;
+  if (ncpus == 0 || n == 0)
+    return 0;
+
+  if (posix_memalign((void **) &a, 4096, n * sizeof(double)) != 0
+      || posix_memalign((void **) &b, 4096, n * sizeof(double)) != 0
+      || posix_memalign((void **) &c, 4096, n * sizeof(double)) != 0) {
+    printf("Error on calibration array malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (tp->nnodes > 1) {
+    bind_range((char *) a, (char *) (a + n), node);
+    bind_range((char *) b, (char *) (b + n), node);
+    bind_range((char *) c, (char *) (c + n), node);
+  }
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(ncpus)
+#endif
+  {
+    long j;
+    int r;
+    double t0 = 0;
+#ifdef _OPENMP
+    pin_self(cpus[omp_get_thread_num()]);
+#else
+    pin_self(cpus[0]);
+#endif
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (j = 0; j < n; j++) {
+      a[j] = 0.0;
+      b[j] = 1.0;
+      c[j] = 2.0;
+    }
+    for (r = 0; r < TOPO_TRIALS; r++) {
+#ifdef _OPENMP
+#pragma omp master
+#endif
+      t0 = now();
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (j = 0; j < n; j++)
+	a[j] = b[j] + 3.0 * c[j];
+#ifdef _OPENMP
+#pragma omp master
+#endif
+      {
+	double dt = now() - t0;
+	if (best == 0 || dt < best)
+	  best = dt;
+      }
+    }
+  }
+
+  free(a);
+  free(b);
+  free(c);
+  pin_pool();
+  return best > 0 ? 3.0 * sizeof(double) * n / best : 0;
+}
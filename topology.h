@@ -0,0 +1,82 @@
+#ifndef _TOPOLOGY_H_
+#define _TOPOLOGY_H_
+
+#include <stddef.h>
+
+/*
+  Processor and NUMA topology, thread pinning and page placement.
+
+  The topology is read from /sys/devices/system/cpu and
+  /sys/devices/system/node, restricted to the cpus the process may run on.
+  Without sysfs every allowed cpu is its own core on node 0.
+
+  STENCILPROBE_AFFINITY selects how OpenMP thread t is placed:
+
+    none     leave placement to the OS (default)
+    compact  fill a core's SMT siblings, then the next core, then the next node
+    scatter  round-robin over nodes, one thread per core before any sibling
+    core     one thread per physical core, nodes in order; siblings only
+             once every core has a thread
+    smt      SMT siblings of a core get consecutive threads, cores
+             round-robin over nodes
+
+  With a policy set, TopoBindGrid also binds each thread's share of the
+  z-planes of a grid to that thread's node.
+*/
+
+#define TOPO_MAX_CPUS  1024
+#define TOPO_MAX_NODES 64
+
+#define TOPO_NONE    0
+#define TOPO_COMPACT 1
+#define TOPO_SCATTER 2
+#define TOPO_CORE    3
+#define TOPO_SMT     4
+
+typedef struct {
+  int cpu;		/* OS cpu number */
+  int package, core;	/* core is numbered across packages */
+  int node;
+  int smt;		/* rank among the allowed siblings of the core */
+  int core_rank;	/* rank of the core within its node */
+} topo_cpu;
+
+typedef struct {
+  int ncpus, ncores, nnodes;
+  topo_cpu cpus[TOPO_MAX_CPUS];
+  int policy;
+  int nthreads;
+  int place[TOPO_MAX_CPUS];	/* thread t runs on cpus[place[t]] */
+} topology;
+
+extern topology stencil_topo;
+
+/* reads the topology into stencil_topo; cheap to call more than once */
+void TopoInit();
+
+/*
+  Computes the placement for the current OpenMP thread count from
+  STENCILPROBE_AFFINITY and pins every thread of the pool to its cpu.
+  Does nothing under TOPO_NONE.
+ */
+void TopoPin();
+
+/*
+  Binds the pages of an nx*ny*nz grid to the nodes of the threads whose
+  pool slabs (pool.h) hold them; pages the grid shares with other memory
+  are left alone.  Call before the grid is first touched; does nothing on
+  one node or under TOPO_NONE.
+ */
+void TopoBindGrid(double *A, int nx, int ny, int nz);
+
+/* prints the topology and the placement of each thread */
+void TopoReport();
+
+/*
+  Triad bandwidth (bytes/s, three streams per element) of node's memory
+  driven by all of node's cpus, with arrays of bytes in total.  Leaves the
+  threads pinned as TopoPin() does.
+ */
+double TopoNodeBandwidth(int node, size_t bytes);
+
+#endif
@@ -0,0 +1,136 @@
+/*
+	Stencil Probe tile trace
+	Per-thread event rings and the Chrome trace JSON writer.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "util.h"
+#include "trace.h"
+
+#define TRACE_MAX_THREADS 256
+
+int trace_on = 0;
+unsigned long trace_mask = 0;
+__thread trace_ring *trace_mine = NULL;
+
+static trace_ring rings[TRACE_MAX_THREADS];
+static int nrings = 0;
+static unsigned long capacity = 0;
+static const char *trace_path = NULL;
+static double trace_spt = 0;
+static trace_tsc trace_base = 0;
+
+trace_ring *trace_claim() {
+  int id = __atomic_fetch_add(&nrings, 1, __ATOMIC_RELAXED);
+  trace_ring *r;
+
+  if (id >= TRACE_MAX_THREADS) {
+    printf("Error: more than %d threads recorded trace events.\n", TRACE_MAX_THREADS);
+    exit(EXIT_FAILURE);
+  }
+  r = &rings[id];
+  r->ev = (trace_event *) malloc(capacity * sizeof(trace_event));
+  if (r->ev == NULL) {
+    printf("Error on trace ring malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  r->head = 0;
+  r->tid = id;
+  trace_mine = r;
+  return r;
+}
+
+static double to_us(trace_tsc t) {
+  return (double) t * trace_spt * 1e6;
+}
+
+static void trace_dump() {
+  int n = nrings < TRACE_MAX_THREADS ? nrings : TRACE_MAX_THREADS;
+  trace_tsc first = 0, last = 0;
+  unsigned long total = 0, dropped = 0, i, lo;
+  const char *sep = "";
+  double busy, maxbusy = 0, thread_busy[TRACE_MAX_THREADS];
+  FILE *f;
+  int r;
+
+  if ((f = fopen(trace_path, "w")) == NULL) {
+    printf("Error opening trace file %s.\n", trace_path);
+    return;
+  }
+
+  fprintf(f, "{\"traceEvents\":[\n");
+  for (r = 0; r < n; r++) {
+    const trace_ring *ring = &rings[r];
+
+    fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+	    "\"args\":{\"name\":\"thread %d\"}}", sep, ring->tid, ring->tid);
+    sep = ",\n";
+    lo = ring->head > capacity ? ring->head - capacity : 0;
+    dropped += lo;
+    for (i = lo; i < ring->head; i++) {
+      const trace_event *e = &ring->ev[i & trace_mask];
+
+      fprintf(f, ",\n{\"name\":\"%s %d\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+	      "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"tile\":%d,\"step\":%d}}",
+	      e->name, e->tile, e->name, ring->tid, to_us(e->start - trace_base),
+	      to_us(e->end - e->start), e->tile, e->step);
+      if (total == 0 || e->start < first)
+	first = e->start;
+      if (e->end > last)
+	last = e->end;
+      total++;
+    }
+  }
+  fprintf(f, "\n],\"displayTimeUnit\":\"ns\"}\n");
+  fclose(f);
+
+  printf("trace: %lu events from %d threads written to %s", total, n, trace_path);
+  if (dropped > 0)
+    printf(" (%lu older events overwritten)", dropped);
+  printf("\n");
+  if (total == 0)
+    return;
+  // idle time of each thread relative to the busiest one
+  for (r = 0; r < n; r++) {
+    busy = 0;
+    lo = rings[r].head > capacity ? rings[r].head - capacity : 0;
+    for (i = lo; i < rings[r].head; i++)
+      busy += rings[r].ev[i & trace_mask].end - rings[r].ev[i & trace_mask].start;
+    thread_busy[r] = busy;
+    if (busy > maxbusy)
+      maxbusy = busy;
+  }
+  printf("  events span %.4g s\n", (last - first) * trace_spt);
+  for (r = 0; r < n; r++)
+    printf("  thread %d: %lu events, busy %.4g s, idle %.4g s vs. the busiest thread\n",
+	   rings[r].tid, rings[r].head - (rings[r].head > capacity ? rings[r].head - capacity : 0),
+	   thread_busy[r] * trace_spt, (maxbusy - thread_busy[r]) * trace_spt);
+}
+
+void TraceInit(double spt) {
+  int events;
+
+  if (trace_path != NULL)
+    return;
+  trace_path = getenv("STENCILPROBE_TRACE");
+  if (trace_path == NULL || *trace_path == '\0') {
+    trace_path = NULL;
+    return;
+  }
+
+  events = probe_param("TRACE_EVENTS", 65536);
+  for (capacity = 1; capacity < (unsigned long) events; capacity <<= 1)
+    ;
+  trace_mask = capacity - 1;
+  trace_spt = spt;
+  trace_base = trace_now();
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  if (trace_mine == NULL)
+    trace_claim();
+
+  atexit(trace_dump);
+  trace_on = 1;
+}
@@ -0,0 +1,72 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+/*
+  Tile scheduling timelines.  When STENCILPROBE_TRACE names an output file,
+  the threaded and blocked kernels record one event per tile (or block,
+  base case, bundle, wavefront chunk) into a ring buffer owned by the
+  thread that ran it, and the rings are written as Chrome trace JSON
+  (chrome://tracing, ui.perfetto.dev) when the probe exits.  Each ring
+  keeps the last STENCILPROBE_TRACE_EVENTS events (default 65536).
+
+  Kernels use
+
+    trace_tsc t0;
+    TRACE_START(t0);
+    ... one tile ...
+    TRACE_TILE("kernel", tile, step, t0);
+
+  With tracing off both macros are a single predictable branch.
+*/
+
+typedef unsigned long long trace_tsc;
+
+typedef struct {
+  const char *name;	/* kernel, a string literal */
+  int tile, step;
+  trace_tsc start, end;
+} trace_event;
+
+typedef struct {
+  trace_event *ev;
+  unsigned long head;	/* events ever recorded; only the owner writes it */
+  int tid;
+} __attribute__((aligned(64))) trace_ring;
+
+extern int trace_on;
+extern unsigned long trace_mask;
+extern __thread trace_ring *trace_mine;
+trace_ring *trace_claim();
+
+static inline trace_tsc trace_now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static inline void trace_record(const char *name, int tile, int step, trace_tsc start) {
+  trace_ring *r = trace_mine ? trace_mine : trace_claim();
+  trace_event *e = &r->ev[r->head & trace_mask];
+
+  e->name = name;
+  e->tile = tile;
+  e->step = step;
+  e->start = start;
+  e->end = trace_now();
+  r->head++;
+}
+
+#define TRACE_START(_t) ((_t) = trace_on ? trace_now() : 0)
+#define TRACE_TILE(_name,_tile,_step,_t) \
+  do { if (trace_on) trace_record((_name), (_tile), (_step), (_t)); } while (0)
+
+/*
+  Turns tracing on if STENCILPROBE_TRACE is set, sets up one ring per
+  OpenMP thread and registers the JSON dump for exit.  spt converts ticks
+  to seconds (see seconds_per_tick()).
+ */
+void TraceInit(double spt);
+
+#endif
@@ -0,0 +1,266 @@
+/*
+	Stencil Probe autotuner model
+	Machine calibration, the footprint / traffic model of the circular
+	queue and time skewing kernels, and candidate enumeration.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "util.h"
+#include "tune.h"
+#include "topology.h"
+#include "cycle.h"
+
+/* smallest block edge tried for time skewing, unless the interior is smaller */
+#define TUNE_MIN_BLOCK 4
+/* interior row lengths of the calibration grids */
+#define TUNE_LONG_ROW 128
+#define TUNE_SHORT_ROW 8
+
+const char *tune_kernel_name(int kernel) {
+  return kernel == TUNE_TIMESKEW ? "timeskew" : "circqueue";
+}
+
+int tune_kernel(const char *name) {
+  if (strcmp(name, "circqueue") == 0)
+    return TUNE_CIRCQUEUE;
+  if (strcmp(name, "timeskew") == 0)
+    return TUNE_TIMESKEW;
+  return -1;
+}
+
+double tune_queue_bytes(int nx, int ty, int steps) {
+  double points = 0;
+  int t;
+
+  for (t = 1; t < steps; t++)
+    points += (double) (ty + 2 * (steps - t)) * nx;
+  return 3 * points * sizeof(double);
+}
+
+/* best seconds per update of naive on an nx*ny*nz grid */
+static double time_naive(stencil_fn naive, int nx, int ny, int nz, double spt) {
+  double *A0, *Anext, best = -1;
+  double interior = (double) (nx-2) * (ny-2) * (nz-2);
+  int steps = (int) (1e6 / interior) + 1, i;
+  ticks t1, t2;
+
+  A0 = (double *) malloc(sizeof(double) * nx * ny * nz);
+  Anext = (double *) malloc(sizeof(double) * nx * ny * nz);
+  if (A0 == NULL || Anext == NULL) {
+    printf("Error on calibration grid malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < 3; i++) {
+    StencilInit(nx, ny, nz, A0);
+    StencilInit(nx, ny, nz, Anext);
+    t1 = getticks();
+    naive(A0, Anext, nx, ny, nz, 0, 0, 0, steps);
+    t2 = getticks();
+    if (best < 0 || elapsed(t2, t1) < best)
+      best = elapsed(t2, t1);
+  }
+  free(A0);
+  free(Anext);
+  return spt * best / (interior * steps);
+}
+
+/* the y and z edge of a grid with rows of nx whose two arrays fill half of size */
+static int square_edge(long size, int nx) {
+  int n = (int) sqrt(size / 2.0 / (2 * sizeof(double) * nx));
+
+  return n < 6 ? 6 : n;
+}
+
+void TuneCalibrate(tune_machine *m, stencil_fn naive) {
+  double spt = seconds_per_tick(), shortrows;
+  size_t bytes;
+  long size;
+  int l, n;
+
+  m->fill = probe_param("TUNE_FILL", 50) / 100.0;
+  m->latency = probe_param("TUNE_LATENCY_NS", 90) * 1e-9;
+  for (l = 1; l <= TUNE_LEVELS; l++) {
+    m->cache[l] = cache_size(l);
+    // rows of TUNE_LONG_ROW interior points (or a guess at the size if unknown)
+    size = m->cache[l] > 0 ? m->cache[l] : (32L * 1024) << (5 * (l - 1));
+    n = square_edge(size, TUNE_LONG_ROW + 2);
+    m->compute[l] = time_naive(naive, TUNE_LONG_ROW + 2, n, n, spt);
+  }
+  // the same L2 footprint in rows of TUNE_SHORT_ROW points gives the per-row cost
+  size = m->cache[2] > 0 ? m->cache[2] : 256L * 1024;
+  n = square_edge(size, TUNE_SHORT_ROW + 2);
+  shortrows = time_naive(naive, TUNE_SHORT_ROW + 2, n, n, spt);
+  m->row_overhead = shortrows > m->compute[2] ?
+    TUNE_SHORT_ROW * (shortrows / m->compute[2] - 1) : 0;
+
+  bytes = (size_t) 64 << 20;
+  if (4 * (size_t) m->cache[3] > bytes)
+    bytes = 4 * (size_t) m->cache[3];
+  if (probe_param("TUNE_BW_MB", 0) > 0)
+    bytes = (size_t) probe_param("TUNE_BW_MB", 0) << 20;
+  m->bandwidth = TopoNodeBandwidth(0, bytes);
+}
+
+void TuneModel(int kernel, int nx, int ny, int nz, const tune_machine *m, tune_config *c) {
+  double T = c->steps, reuse, grid, compute, exposed, memory;
+  int row, l;
+
+  // the circular queue sweeps whole rows, time skewing rows of the block
+  row = kernel == TUNE_CIRCQUEUE ? nx - 2 : c->tx;
+
+  if (kernel == TUNE_CIRCQUEUE) {
+    c->bytes = tune_queue_bytes(nx, c->ty, c->steps)
+      + (3.0 * (c->ty + 2 * c->steps) + c->ty) * nx * sizeof(double);
+    // every queue level recomputes the rows the next level's halo needs
+    c->redundancy = 1 + (T - 1) / c->ty;
+  }
+  else {
+    c->bytes = 2.0 * (c->tx + T) * (c->ty + T) * (c->tz + T) * sizeof(double);
+    c->redundancy = 1;
+  }
+  // the rows prefetched ahead, of both arrays
+  c->bytes += 2.0 * c->pf_dist * (row + 2) * sizeof(double);
+
+  // a grid whose two arrays fit a cache stays there whatever the blocking
+  grid = 2.0 * nx * ny * nz * sizeof(double);
+  c->level = TUNE_MEMORY;
+  for (l = 1; l <= TUNE_LEVELS; l++)
+    if (m->cache[l] > 0 && (c->bytes <= m->fill * m->cache[l] || grid <= m->fill * m->cache[l])) {
+      c->level = l;
+      break;
+    }
+
+  if (m->cache[TUNE_LEVELS] > 0 && grid <= m->fill * m->cache[TUNE_LEVELS])
+    c->traffic = 0;
+  else if (c->level == TUNE_MEMORY)
+    // no reuse between the fused steps: a read and a write-allocated write each
+    c->traffic = 3 * sizeof(double) * c->redundancy;
+  else if (kernel == TUNE_CIRCQUEUE)
+    // A0 once per pass, including the slab halo, and Anext once
+    c->traffic = (sizeof(double) * (c->ty + 2 * T) / c->ty + 2 * sizeof(double)) / T;
+  else {
+    // both arrays read and written once per pass over the skewed block
+    reuse = (c->tx + T) * (c->ty + T) * (c->tz + T) / ((double) c->tx * c->ty * c->tz);
+    c->traffic = 4 * sizeof(double) * reuse / T;
+  }
+
+  compute = m->compute[c->level < TUNE_LEVELS ? c->level : TUNE_LEVELS];
+  c->predicted = c->redundancy * compute * (1 + m->row_overhead / row);
+  // the latency a row from DRAM waits out beyond what the prefetch covered
+  exposed = m->latency - c->pf_dist * row * compute;
+  if (exposed < 0)
+    exposed = 0;
+  if (m->bandwidth > 0) {
+    // traffic / 3 doubles: the updates whose rows stream from DRAM
+    memory = c->traffic / m->bandwidth + exposed / row * c->traffic / (3 * sizeof(double));
+    if (memory > c->predicted)
+      c->predicted = memory;
+  }
+}
+
+static int by_prediction(const void *a, const void *b) {
+  const tune_config *x = a, *y = b;
+
+  if (x->predicted != y->predicted)
+    return x->predicted < y->predicted ? -1 : 1;
+  if (x->traffic != y->traffic)
+    return x->traffic < y->traffic ? -1 : 1;
+  return x->bytes < y->bytes ? -1 : x->bytes > y->bytes;
+}
+
+/* the block edges tried for an interior of n: its divisors, at least TUNE_MIN_BLOCK */
+static int edges(int n, int *e) {
+  int d, count = 0;
+
+  for (d = 1; d <= n; d++)
+    if (n % d == 0 && (d >= TUNE_MIN_BLOCK || d == n))
+      e[count++] = d;
+  return count;
+}
+
+int TuneCandidates(int kernel, int nx, int ny, int nz, int maxsteps,
+		   const tune_machine *m, tune_config **out) {
+  static const int dists[] = TUNE_PF_DISTS;
+  int *ex, *ey, *ez, nex, ney, nez, a, b, d, s, p, n = 0, cap = 64;
+  tune_config *c = (tune_config *) malloc(cap * sizeof(tune_config));
+
+  ex = (int *) malloc(nx * sizeof(int));
+  ey = (int *) malloc(ny * sizeof(int));
+  ez = (int *) malloc(nz * sizeof(int));
+  if (c == NULL || ex == NULL || ey == NULL || ez == NULL) {
+    printf("Error on tuning candidate malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  nex = edges(nx - 2, ex);
+  ney = edges(ny - 2, ey);
+  nez = edges(nz - 2, ez);
+
+  // the circular queue only blocks y; tx and tz are reported as the interior
+  if (kernel == TUNE_CIRCQUEUE) {
+    nex = nez = 1;
+    ex[0] = nx - 2;
+    ez[0] = nz - 2;
+  }
+  for (a = 0; a < nex; a++)
+    for (b = 0; b < ney; b++)
+      for (d = 0; d < nez; d++)
+	for (s = 1; s <= maxsteps; s++) {
+	  // time skewing takes at most one step more than the smallest block edge
+	  if (kernel == TUNE_TIMESKEW &&
+	      (s > ex[a] + 1 || s > ey[b] + 1 || s > ez[d] + 1))
+	    break;
+	  for (p = 0; p < (int) (sizeof(dists) / sizeof(dists[0])); p++) {
+	    if (n == cap) {
+	      cap *= 2;
+	      c = (tune_config *) realloc(c, cap * sizeof(tune_config));
+	      if (c == NULL) {
+		printf("Error on tuning candidate malloc.\n");
+		exit(EXIT_FAILURE);
+	      }
+	    }
+	    c[n].tx = ex[a];
+	    c[n].ty = ey[b];
+	    c[n].tz = ez[d];
+	    c[n].steps = s;
+	    c[n].pf_dist = dists[p];
+	    TuneModel(kernel, nx, ny, nz, m, &c[n]);
+	    n++;
+	  }
+	}
+
+  free(ex);
+  free(ey);
+  free(ez);
+  qsort(c, n, sizeof(tune_config), by_prediction);
+  *out = c;
+  return n;
+}
+
+void tune_ranks(const double *x, int n, double *r) {
+  int i, j;
+
+  for (i=0;i<n;i++) {
+    r[i] = 0;
+    for (j=0;j<n;j++)
+      if (x[j] < x[i] || (x[j] == x[i] && j < i))
+	r[i]++;
+  }
+}
+
+double tune_spearman(const double *x, const double *y, int n) {
+  double *rx = (double *) malloc(2 * n * sizeof(double)), *ry = rx + n, d2 = 0;
+  int i;
+
+  if (rx == NULL) {
+    printf("Error on rank malloc.\n");
+    exit(EXIT_FAILURE);
+  }
+  tune_ranks(x, n, rx);
+  tune_ranks(y, n, ry);
+  for (i=0;i<n;i++)
+    d2 += (rx[i] - ry[i]) * (rx[i] - ry[i]);
+  free(rx);
+  return 1 - 6 * d2 / ((double) n * ((double) n * n - 1));
+}
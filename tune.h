@@ -0,0 +1,104 @@
+#ifndef _TUNE_H_
+#define _TUNE_H_
+
+#include "common.h"
+
+/*
+  Analytical cache-footprint model for the temporally blocked kernels.
+  A configuration is a block plus the number of timesteps fused into one
+  pass over the grid; the model estimates the working set of one block
+  (time skewing) or one slab with its queues (circular queue), finds the
+  innermost cache level it fits in, and predicts the time per useful
+  point update as the larger of the compute time at that level and the
+  DRAM traffic at the measured bandwidth plus the latency the software
+  prefetch (prefetch.h) leaves exposed:
+
+    predicted = max(redundancy * compute[level] * (1 + row_overhead / row),
+                    traffic / bandwidth + stall)
+    stall     = max(0, latency - pf_dist * row * compute[level]) / row
+                * traffic / (3 * sizeof(double))
+
+  where row is the length of the innermost loop (the interior for the
+  circular queue, tx for time skewing).  A row streamed from DRAM stalls
+  for the memory latency unless the prefetch pf_dist rows ahead was issued
+  at least that long before; traffic / 3 doubles is the rows per update
+  that come from DRAM.  The locality hint is not modeled.
+
+  Working sets (doubles):
+    circular queue  3 * sum_{t=1}^{T-1} (ty+2(T-t)) * nx   queues, as in
+                                                          CircularQueueInit
+                    + 3 * (ty+2T) * nx                    input planes
+                    + ty * nx                             output rows
+    time skewing    2 * (tx+T) * (ty+T) * (tz+T)          both arrays over
+                                                          the skewed block
+    prefetch        + 2 * pf_dist * (row+2)               rows read and
+                                                          written ahead
+  A working set "fits" a level when it is at most fill * its size; a grid
+  that fits the LLC as a whole has no DRAM traffic.
+*/
+
+#define TUNE_CIRCQUEUE 0
+#define TUNE_TIMESKEW  1
+
+/* the prefetch distances tried, in rows */
+#define TUNE_PF_DISTS { 0, 1, 2, 4, 8 }
+
+/* the levels a working set can live in; TUNE_MEMORY means none of the caches */
+#define TUNE_LEVELS 3
+#define TUNE_MEMORY 4
+
+typedef struct {
+  long cache[TUNE_LEVELS + 1];		/* bytes, levels 1..3; 0 if unknown */
+  double compute[TUNE_LEVELS + 1];	/* seconds per update in cache level 1..3 */
+  double row_overhead;			/* fixed cost of a row, in updates */
+  double bandwidth;			/* bytes/s */
+  double latency;			/* DRAM latency, seconds */
+  double fill;				/* usable fraction of a cache */
+} tune_machine;
+
+typedef struct {
+  int tx, ty, tz, steps;	/* block and timesteps per pass */
+  int pf_dist;			/* prefetch distance in rows, 0 for none */
+  double bytes;			/* modeled working set */
+  int level;			/* 1..3, or TUNE_MEMORY */
+  double redundancy;		/* updates computed per useful update */
+  double traffic;		/* DRAM bytes per useful update */
+  double predicted;		/* seconds per useful update */
+} tune_config;
+
+/* name of a TUNE_* kernel, and its number from a name (-1 if unknown) */
+const char *tune_kernel_name(int kernel);
+int tune_kernel(const char *name);
+
+/* bytes of the circular queues CircularQueueInit allocates */
+double tune_queue_bytes(int nx, int ty, int steps);
+
+/*
+  Fills m: cache sizes from cache_size(), compute rates from runs of the
+  naive kernel on grids sized for each level, the per-row cost from a run
+  with short rows, and single-thread bandwidth
+  over STENCILPROBE_TUNE_BW_MB (default 4x the LLC, at least 64 MB).
+  STENCILPROBE_TUNE_FILL is the fill percentage (default 50) and
+  STENCILPROBE_TUNE_LATENCY_NS the DRAM latency (default 90).
+ */
+void TuneCalibrate(tune_machine *m, stencil_fn naive);
+
+/* fills in the modeled fields of c for an nx*ny*nz grid */
+void TuneModel(int kernel, int nx, int ny, int nz, const tune_machine *m, tune_config *c);
+
+/*
+  Every legal configuration of kernel on an nx*ny*nz grid with at most
+  maxsteps timesteps per pass, each with every prefetch distance of
+  TUNE_PF_DISTS, modeled and sorted best first.  Returns the count; *out
+  is malloc'ed.
+ */
+int TuneCandidates(int kernel, int nx, int ny, int nz, int maxsteps,
+		   const tune_machine *m, tune_config **out);
+
+/* ranks of x[0..n-1] into r (not x itself), ties broken by position */
+void tune_ranks(const double *x, int n, double *r);
+
+/* Spearman rank correlation of x and y (n > 1) */
+double tune_spearman(const double *x, const double *y, int n);
+
+#endif
@@ -4,27 +4,29 @@
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "util.h"
+#include "init.h"
+#include "prefetch.h"
 #include "cycle.h"
 
 
 
 /*
-  This initializes the array A to be all 1's.  
-  This is nearly superfluous (could use memset), but
-  provides convenience and consistency nonetheless...
+  Initializes A with the field chosen by STENCILPROBE_INIT (see init.h):
+  random values with RANDOMVALUES, all 1's otherwise.
  */
 void StencilInit(int nx,int ny,int nz, /* size of the array */
-		 double *A){ /* the array to initialize to 1s */
-  long last = nx*ny*nz;
-  long i;
+		 double *A){ /* the array to initialize */
+  init_field f;
 
-  for(i=0;i<last;i++) 
 #ifdef RANDOMVALUES
-	A[i]=(float)rand()/RAND_MAX;
+  InitFromEnv(&f, INIT_RANDOM);
 #else
-	A[i]=1.0;
+  InitFromEnv(&f, INIT_CONSTANT);
 #endif
+  InitField(nx, ny, nz, A, &f);
 }
 
 /*
@@ -65,3 +67,94 @@ void clear_cache()
     tarray[i] = 1.0;
 
 }
+
+/*
+  Cache size lookup.  Tries sysconf first, then falls back to the
+  sysfs cache description of cpu0.
+*/
+long cache_size(int level)
+{
+  long size = 0;
+  char path[128], type[32];
+  int idx, lvl;
+  FILE *f;
+
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+  switch (level) {
+  case 1: size = sysconf(_SC_LEVEL1_DCACHE_SIZE); break;
+  case 2: size = sysconf(_SC_LEVEL2_CACHE_SIZE); break;
+  case 3: size = sysconf(_SC_LEVEL3_CACHE_SIZE); break;
+  }
+  if (size > 0)
+    return size;
+#endif
+
+  for (idx = 0; idx < 8; idx++) {
+    sprintf(path, "/sys/devices/system/cpu/cpu0/cache/index%d/level", idx);
+    if ((f = fopen(path, "r")) == NULL)
+      break;
+    if (fscanf(f, "%d", &lvl) != 1)
+      lvl = -1;
+    fclose(f);
+    if (lvl != level)
+      continue;
+
+    sprintf(path, "/sys/devices/system/cpu/cpu0/cache/index%d/type", idx);
+    if ((f = fopen(path, "r")) == NULL)
+      continue;
+    if (fscanf(f, "%31s", type) != 1)
+      type[0] = '\0';
+    fclose(f);
+    if (strcmp(type, "Instruction") == 0)
+      continue;
+
+    sprintf(path, "/sys/devices/system/cpu/cpu0/cache/index%d/size", idx);
+    if ((f = fopen(path, "r")) == NULL)
+      continue;
+    type[0] = '\0';
+    if (fscanf(f, "%ld%31s", &size, type) >= 1) {
+      if (type[0] == 'K') size *= 1024;
+      else if (type[0] == 'M') size *= 1024*1024;
+    }
+    fclose(f);
+    return size > 0 ? size : 0;
+  }
+  return 0;
+}
+
+/*
+  Reads an integer tuning parameter from the environment.
+*/
+int probe_param(const char *name, int dflt)
+{
+  // room for the prefix and a name as long as prefetch_init's buffer
+  char var[sizeof("STENCILPROBE_") + 64];
+  char *val;
+
+  snprintf(var, sizeof(var), "STENCILPROBE_%s", name);
+  val = getenv(var);
+  if (val == NULL || *val == '\0')
+    return dflt;
+  return atoi(val);
+}
+
+/*
+  Reads the prefetch distance and locality hint for a kernel: the
+  kernel-specific variables override the global ones, which override
+  the kernel's default distance.
+*/
+void prefetch_init(prefetch_t *pf, const char *kernel, int dflt_dist)
+{
+  char name[64];
+
+  pf->dist = probe_param("PF_DIST", dflt_dist);
+  pf->hint = probe_param("PF_HINT", 3);
+  snprintf(name, sizeof(name), "%s_PF_DIST", kernel);
+  pf->dist = probe_param(name, pf->dist);
+  snprintf(name, sizeof(name), "%s_PF_HINT", kernel);
+  pf->hint = probe_param(name, pf->hint);
+
+  if (pf->dist < 0) pf->dist = 0;
+  if (pf->hint < 0) pf->hint = 0;
+  if (pf->hint > 3) pf->hint = 3;
+}
@@ -5,16 +5,28 @@
 
 
 /*
-  This initializes the array A to be all 1's.  
-  This is nearly superfluous (could use memset), but
-  provides convenience and consistency nonetheless...
+  Initializes A with the field chosen by STENCILPROBE_INIT (see init.h):
+  random values with RANDOMVALUES, all 1's otherwise.
  */
 void StencilInit(int nx,int ny,int nz, /* size of the array */
-		 double *A); /* the array to initialize to 1's */
+		 double *A); /* the array to initialize */
 
 
 void clear_cache();
 
 double seconds_per_tick();
 
+/*
+  Returns the size in bytes of the data (or unified) cache at the given
+  level (1, 2 or 3), or 0 if it cannot be determined.
+ */
+long cache_size(int level);
+
+/*
+  Returns the integer value of the environment variable STENCILPROBE_<name>,
+  or dflt if it is unset.  Used for tuning knobs that a search script can
+  sweep without recompiling the probe.
+ */
+int probe_param(const char *name, int dflt);
+
 #endif